@@ -0,0 +1,276 @@
+// This file is a part of Julia. License is MIT: https://julialang.org/license
+//
+// Benchmarks for the detection, lookup and flag generation paths
+//
+// Usage: bench_archspec [--filter=<substring>] [--min-time=<seconds>] [--json=<file|->]
+
+#include "bench_common.hpp"
+#include <archspec/archspec.hpp>
+#include <archspec/archspec_c.h>
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <filesystem>
+
+using namespace archspec;
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char* kJsonPath = "extern/archspec/archspec/json/cpu/microarchitectures.json";
+const char* kFixtureDir = "extern/archspec/archspec/json/tests/targets";
+
+std::string read_file_content(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open())
+        return "";
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+// Architecture a Linux cpuinfo fixture was captured on, or empty for non-cpuinfo fixtures
+std::string fixture_arch(const std::string& filename, const std::string& content) {
+    if (filename.find("linux-") != 0 && filename.find("bgq-") != 0)
+        return "";
+    if (content.find("vendor_id") != std::string::npos)
+        return std::string(ARCH_X86_64);
+    if (content.find("CPU implementer") != std::string::npos)
+        return std::string(ARCH_AARCH64);
+    if (content.find("POWER") != std::string::npos)
+        return filename.find("le") != std::string::npos ? "ppc64le" : "ppc64";
+    if (content.find("uarch") != std::string::npos)
+        return std::string(ARCH_RISCV64);
+    return "";
+}
+
+} // anonymous namespace
+
+// Must run first: the singleton parses its embedded data on first use
+BENCHMARK(database_first_use) {
+    run_once("database_first_use", [] { do_not_optimize(MicroarchitectureDatabase::instance()); });
+}
+
+BENCHMARK(json_parse) {
+    std::string json = read_file_content(kJsonPath);
+    if (json.empty())
+        return;
+    run_benchmark("json_parse", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            auto j = nlohmann::json::parse(json, nullptr, false);
+            do_not_optimize(j);
+        }
+    });
+}
+
+BENCHMARK(database_reload) {
+    std::string json = read_file_content(kJsonPath);
+    if (json.empty())
+        return;
+    auto& db = MicroarchitectureDatabase::instance();
+    // Existing targets are kept, so this measures the parse and an incremental refresh
+    run_benchmark("database_reload", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i)
+            do_not_optimize(db.load_from_string(json));
+    });
+}
+
+BENCHMARK(load_overlay) {
+    auto j = nlohmann::json::parse(read_file_content(kJsonPath), nullptr, false);
+    if (j.is_discarded() || !j["microarchitectures"].contains("sapphirerapids"))
+        return;
+    // Replace one leaf target with an identical copy, so later benchmarks see the same data
+    nlohmann::json overlay;
+    overlay["microarchitectures"]["sapphirerapids"] = j["microarchitectures"]["sapphirerapids"];
+    std::string json = overlay.dump();
+    auto& db = MicroarchitectureDatabase::instance();
+    run_benchmark("load_overlay/one_target", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i)
+            do_not_optimize(db.load_overlay(json));
+    });
+}
+
+BENCHMARK(detection) {
+    run_benchmark("detect_cpu_info", [](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i)
+            do_not_optimize(detect_cpu_info());
+    });
+    run_benchmark("host", [](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i)
+            do_not_optimize(host());
+    });
+    run_benchmark("host_cached", [](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i)
+            do_not_optimize(host_cached());
+    });
+    run_benchmark("detect_topology", [](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i)
+            do_not_optimize(detect_topology());
+    });
+}
+
+BENCHMARK(compatible_microarchitectures) {
+    std::error_code ec;
+    std::vector<fs::path> paths;
+    for (const auto& entry : fs::directory_iterator(kFixtureDir, ec))
+        paths.push_back(entry.path());
+    std::sort(paths.begin(), paths.end());
+
+    for (const auto& path : paths) {
+        std::string filename = path.filename().string();
+        std::string content = read_file_content(path.string());
+        std::string arch = fixture_arch(filename, content);
+        if (arch.empty())
+            continue;
+
+        DetectedCpuInfo info = parse_cpuinfo(content, arch);
+        run_benchmark("compatible_microarchitectures/" + filename, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i)
+                do_not_optimize(compatible_microarchitectures(info, arch));
+        });
+    }
+}
+
+// A fleet of 10000 x86_64 records drawn from the fixtures, resolved one by one and in batches
+BENCHMARK(resolve_batch) {
+    std::error_code ec;
+    std::vector<fs::path> paths;
+    for (const auto& entry : fs::directory_iterator(kFixtureDir, ec))
+        paths.push_back(entry.path());
+    std::sort(paths.begin(), paths.end());
+
+    std::vector<DetectedCpuInfo> distinct;
+    for (const auto& path : paths) {
+        std::string content = read_file_content(path.string());
+        if (fixture_arch(path.filename().string(), content) == ARCH_X86_64)
+            distinct.push_back(parse_cpuinfo(content, ARCH_X86_64));
+    }
+    if (distinct.empty())
+        return;
+
+    std::vector<DetectedCpuInfo> fleet;
+    for (size_t i = 0; i < 10000; ++i)
+        fleet.push_back(distinct[i % distinct.size()]);
+
+    run_benchmark("resolve_batch/best_match_loop", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            for (const auto& info : fleet)
+                do_not_optimize(best_match(info, ARCH_X86_64));
+        }
+    });
+    run_benchmark("resolve_batch/serial", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i)
+            do_not_optimize(resolve_batch(fleet, ARCH_X86_64));
+    });
+    run_benchmark("resolve_batch/threads", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i)
+            do_not_optimize(resolve_batch(fleet, ARCH_X86_64, 0));
+    });
+}
+
+// The kernels behind compatible_microarchitectures(), over every row of the target table
+BENCHMARK(subset_scan) {
+    const auto& table = MicroarchitectureDatabase::instance().target_table();
+    FeatureMask available = host_cpu_info_cached().feature_mask();
+    std::vector<uint8_t> out(table.size());
+
+    run_benchmark("subset_scan/scalar", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            subset_scan_scalar(table.masks.data(), table.size(), available, out.data());
+            do_not_optimize(out);
+        }
+    });
+    run_benchmark(std::string("subset_scan/") + subset_scan_kernel(), [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            subset_scan(table.masks.data(), table.size(), available, out.data());
+            do_not_optimize(out);
+        }
+    });
+}
+
+BENCHMARK(lineage) {
+    const auto& db = MicroarchitectureDatabase::instance();
+    std::vector<const Microarchitecture*> targets;
+    for (const auto& [name, target] : db.all())
+        targets.push_back(&target);
+
+    run_benchmark("ancestors/all_targets", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            for (const auto* t : targets)
+                do_not_optimize(t->ancestors());
+        }
+    });
+    run_benchmark("operator_less/all_pairs", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            for (const auto* a : targets) {
+                for (const auto* b : targets)
+                    do_not_optimize(*a < *b);
+            }
+        }
+    });
+}
+
+BENCHMARK(flags) {
+    const Microarchitecture& target = host_cached();
+    run_benchmark("optimization_flags/gcc", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i)
+            do_not_optimize(target.optimization_flags("gcc", "13.2.0"));
+    });
+    run_benchmark("optimization_flags/clang", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i)
+            do_not_optimize(target.optimization_flags("clang", "17.0.0"));
+    });
+    run_benchmark("get_llvm_features_string", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i)
+            do_not_optimize(get_llvm_features_string(target));
+    });
+    run_benchmark("get_llvm_cpu_name", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i)
+            do_not_optimize(get_llvm_cpu_name(target));
+    });
+}
+
+BENCHMARK(c_api) {
+    run_benchmark("c_api/archspec_host_name", [](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i)
+            do_not_optimize(archspec_host_name());
+    });
+    run_benchmark("c_api/archspec_get_features", [](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            char* features = archspec_get_features("haswell");
+            do_not_optimize(features);
+            archspec_free(features);
+        }
+    });
+    run_benchmark("c_api/archspec_get_features_static", [](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i)
+            do_not_optimize(archspec_get_features_static("haswell"));
+    });
+    run_benchmark("c_api/archspec_host_flags_into", [](uint64_t n) {
+        char buf[512];
+        for (uint64_t i = 0; i < n; ++i)
+            do_not_optimize(archspec_host_flags_into("gcc", buf, sizeof(buf), nullptr));
+    });
+    run_benchmark("c_api/archspec_has_feature", [](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i)
+            do_not_optimize(archspec_has_feature("haswell", "avx2"));
+    });
+}
+
+int main(int argc, char* argv[]) {
+    bench_init(argc, argv);
+
+    RUN_BENCHMARK(database_first_use);
+    RUN_BENCHMARK(json_parse);
+    RUN_BENCHMARK(database_reload);
+    RUN_BENCHMARK(load_overlay);
+    RUN_BENCHMARK(detection);
+    RUN_BENCHMARK(compatible_microarchitectures);
+    RUN_BENCHMARK(resolve_batch);
+    RUN_BENCHMARK(subset_scan);
+    RUN_BENCHMARK(lineage);
+    RUN_BENCHMARK(flags);
+    RUN_BENCHMARK(c_api);
+
+    return bench_finish(argv[0]);
+}
@@ -0,0 +1,178 @@
+// This file is a part of Julia. License is MIT: https://julialang.org/license
+//
+// Minimal benchmark harness with Google Benchmark compatible JSON output
+
+#ifndef ARCHSPEC_BENCH_COMMON_HPP
+#define ARCHSPEC_BENCH_COMMON_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Keep the compiler from discarding a value computed inside a benchmark loop
+template <typename T> inline void do_not_optimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+struct BenchResult {
+    std::string name;
+    uint64_t iterations = 0;
+    double real_time_ns = 0; // Per iteration
+    double cpu_time_ns = 0;  // Per iteration
+};
+
+struct BenchOptions {
+    double min_time_s = 0.1; // Keep doubling iterations until a run lasts this long
+    std::string filter;      // Only run benchmarks whose name contains this
+    std::string json_path;   // Write JSON here ("-" for stdout)
+};
+
+inline std::vector<BenchResult> g_bench_results;
+inline BenchOptions g_bench_options;
+
+inline bool bench_selected(const std::string& name) {
+    return g_bench_options.filter.empty() || name.find(g_bench_options.filter) != std::string::npos;
+}
+
+inline void bench_report(const BenchResult& r) {
+    g_bench_results.push_back(r);
+    char line[256];
+    std::snprintf(line, sizeof(line), "%-64s %14.1f ns %14.1f ns %12llu", r.name.c_str(),
+                  r.real_time_ns, r.cpu_time_ns, static_cast<unsigned long long>(r.iterations));
+    std::cerr << line << std::endl;
+}
+
+// Run body(iterations) with growing iteration counts until it takes min_time_s
+inline void run_benchmark(const std::string& name, const std::function<void(uint64_t)>& body) {
+    if (!bench_selected(name))
+        return;
+
+    body(1); // Warm up caches and lazy initialization
+    for (uint64_t iterations = 1;; iterations *= 2) {
+        auto wall_start = std::chrono::steady_clock::now();
+        std::clock_t cpu_start = std::clock();
+        body(iterations);
+        std::clock_t cpu_end = std::clock();
+        auto wall_end = std::chrono::steady_clock::now();
+
+        double wall = std::chrono::duration<double>(wall_end - wall_start).count();
+        if (wall >= g_bench_options.min_time_s || iterations >= (uint64_t(1) << 40)) {
+            double cpu = double(cpu_end - cpu_start) / CLOCKS_PER_SEC;
+            BenchResult r;
+            r.name = name;
+            r.iterations = iterations;
+            r.real_time_ns = wall * 1e9 / double(iterations);
+            r.cpu_time_ns = cpu * 1e9 / double(iterations);
+            bench_report(r);
+            return;
+        }
+    }
+}
+
+// Time a single call that can only happen once per process (e.g. first use of a singleton)
+inline void run_once(const std::string& name, const std::function<void()>& body) {
+    if (!bench_selected(name))
+        return;
+
+    auto wall_start = std::chrono::steady_clock::now();
+    std::clock_t cpu_start = std::clock();
+    body();
+    std::clock_t cpu_end = std::clock();
+    auto wall_end = std::chrono::steady_clock::now();
+
+    BenchResult r;
+    r.name = name;
+    r.iterations = 1;
+    r.real_time_ns = std::chrono::duration<double, std::nano>(wall_end - wall_start).count();
+    r.cpu_time_ns = double(cpu_end - cpu_start) * 1e9 / CLOCKS_PER_SEC;
+    bench_report(r);
+}
+
+#define BENCHMARK(name) void bench_##name()
+#define RUN_BENCHMARK(name) bench_##name()
+
+// Parse --filter=, --min-time= and --json= (Google Benchmark flag spellings also accepted)
+inline void bench_init(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&](const char* prefix) -> const char* {
+            size_t n = std::char_traits<char>::length(prefix);
+            return arg.compare(0, n, prefix) == 0 ? argv[i] + n : nullptr;
+        };
+        if (const char* v = value("--filter="))
+            g_bench_options.filter = v;
+        else if (const char* v = value("--benchmark_filter="))
+            g_bench_options.filter = v;
+        else if (const char* v = value("--min-time="))
+            g_bench_options.min_time_s = std::atof(v);
+        else if (const char* v = value("--json="))
+            g_bench_options.json_path = v;
+        else if (const char* v = value("--benchmark_out="))
+            g_bench_options.json_path = v;
+    }
+
+    char header[256];
+    std::snprintf(header, sizeof(header), "%-64s %17s %17s %12s", "Benchmark", "Time", "CPU",
+                  "Iterations");
+    std::cerr << header << std::endl;
+    std::cerr << std::string(114, '-') << std::endl;
+}
+
+inline std::string bench_json_escape(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        out += c;
+    }
+    return out;
+}
+
+// Write the collected results; returns the process exit code
+inline int bench_finish(const char* executable) {
+    if (g_bench_options.json_path.empty())
+        return 0;
+
+    std::ostringstream json;
+    json << "{\n  \"context\": {\n";
+    json << "    \"executable\": \"" << bench_json_escape(executable) << "\",\n";
+    json << "    \"library\": \"archspec_cpp\",\n";
+    json << "    \"min_time\": " << g_bench_options.min_time_s << "\n";
+    json << "  },\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < g_bench_results.size(); ++i) {
+        const BenchResult& r = g_bench_results[i];
+        json << "    {\"name\": \"" << bench_json_escape(r.name) << "\""
+             << ", \"run_type\": \"iteration\", \"iterations\": " << r.iterations
+             << ", \"real_time\": " << r.real_time_ns << ", \"cpu_time\": " << r.cpu_time_ns
+             << ", \"time_unit\": \"ns\"}"
+             << (i + 1 < g_bench_results.size() ? "," : "") << "\n";
+    }
+    json << "  ]\n}\n";
+
+    if (g_bench_options.json_path == "-") {
+        std::cout << json.str();
+        return 0;
+    }
+    std::ofstream out(g_bench_options.json_path);
+    if (!out.is_open()) {
+        std::cerr << "Cannot write " << g_bench_options.json_path << std::endl;
+        return 1;
+    }
+    out << json.str();
+    return 0;
+}
+
+#endif // ARCHSPEC_BENCH_COMMON_HPP
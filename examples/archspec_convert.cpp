@@ -0,0 +1,32 @@
+// This file is a part of Julia. License is MIT: https://julialang.org/license
+//
+// Example: Convert the microarchitecture database to the binary format
+//
+// Usage: archspec_convert <output.bin> [input.json ...]
+// The output holds the embedded database merged with any JSON (or binary) inputs, so it can
+// be passed to MicroarchitectureDatabase::load_from_file() or load_binary() later.
+
+#include <archspec/archspec.hpp>
+#include <iostream>
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <output.bin> [input.json ...]" << std::endl;
+        return 1;
+    }
+
+    auto& db = archspec::MicroarchitectureDatabase::instance();
+    for (int i = 2; i < argc; ++i) {
+        if (!db.load_from_file(argv[i])) {
+            std::cerr << "Failed to load " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    if (!db.save_binary(argv[1])) {
+        std::cerr << "Failed to write " << argv[1] << std::endl;
+        return 1;
+    }
+    std::cout << "Wrote " << db.all().size() << " targets to " << argv[1] << std::endl;
+    return 0;
+}
@@ -42,6 +42,18 @@ int main(void) {
     printf("  Has AVX2:   %s\n", archspec_host_has_feature("avx2") ? "yes" : "no");
     printf("  Has NEON:   %s\n", archspec_host_has_feature("neon") ? "yes" : "no");
 
+    /* Topology, for sizing thread pools and tiles */
+    archspec_topology topo;
+    if (archspec_host_topology(&topo)) {
+        printf("\nTopology:\n");
+        printf("  %u logical CPUs, %u cores, %u packages, %u NUMA nodes\n", topo.logical_cpus,
+               topo.physical_cores, topo.packages, topo.numa_nodes);
+        printf("  L1d %llu KiB, L2 %llu KiB, L3 %llu KiB\n",
+               (unsigned long long)(archspec_host_cache_size(1) >> 10),
+               (unsigned long long)(archspec_host_cache_size(2) >> 10),
+               (unsigned long long)(archspec_host_cache_size(3) >> 10));
+    }
+
     /* Query a specific target */
     printf("\nHaswell features:\n");
     char* haswell_features = archspec_get_features("haswell");
@@ -58,6 +70,18 @@ int main(void) {
         archspec_free(haswell_flags);
     }
 
+    /* Allocation-free lookups: stable pointers, or copies into caller buffers */
+    const char* zen3_flags = archspec_get_flags_static("zen3", "gcc");
+    printf("\nZen3 GCC flags (static): %s\n", zen3_flags ? zen3_flags : "(none)");
+
+    char buf[64];
+    size_t needed = 0;
+    if (archspec_get_flags_into("skylake", "clang", buf, sizeof(buf), &needed)) {
+        printf("Skylake Clang flags (into): %s\n", buf);
+    } else if (needed > 0) {
+        printf("Skylake Clang flags need a %zu byte buffer\n", needed);
+    }
+
     /* List all targets */
     printf("\nKnown targets (%zu total):\n  ", archspec_target_count());
     size_t count = archspec_target_count();
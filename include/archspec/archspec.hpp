@@ -8,6 +8,11 @@
 
 #include "microarchitecture.hpp"
 #include "detect.hpp"
+#include "host_cache.hpp"
 #include "llvm_compat.hpp"
+#include "multiversion.hpp"
+#include "snapshot.hpp"
+#include "stats.hpp"
+#include "topology.hpp"
 
 #endif // ARCHSPEC_HPP
@@ -1,12 +1,17 @@
 /* This file is a part of Julia. License is MIT: https://julialang.org/license
  *
  * C API for archspec - CPU microarchitecture detection library
+ *
+ * Thread safety: every archspec_* function may be called concurrently from any thread.
+ * The first call performs one-time initialization (database load and host detection);
+ * later calls only read immutable state and take no locks.
  */
 
 #ifndef ARCHSPEC_C_H
 #define ARCHSPEC_C_H
 
 #include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -52,6 +57,32 @@ char* archspec_get_flags(const char* name, const char* compiler);
  */
 char* archspec_host_flags(const char* compiler);
 
+/* Allocation-free variants
+ *
+ * The *_static functions return the same strings as their allocating counterparts, but as
+ * pointers to storage precomputed on first use and again after each load into the database
+ * (such as an overlay). The pointers stay valid for the lifetime of the process and must
+ * NOT be freed; one obtained before a load keeps the value it had, so call again to see
+ * the update. Host strings reflect the host as first detected by the C API (see
+ * archspec_host_name).
+ */
+const char* archspec_host_features_static(void);
+const char* archspec_host_flags_static(const char* compiler);
+const char* archspec_get_features_static(const char* name);
+const char* archspec_get_flags_static(const char* name, const char* compiler);
+
+/* The *_into functions copy the result into a caller-provided buffer of len bytes.
+ * If needed is not NULL it receives the buffer size required for the full string,
+ * including the terminating NUL, or 0 if there is no result.
+ * Returns 1 if the complete string was written, 0 if there is no result or buf is too small
+ * (buf then holds a truncated, NUL-terminated prefix when len > 0).
+ */
+int archspec_host_features_into(char* buf, size_t len, size_t* needed);
+int archspec_host_flags_into(const char* compiler, char* buf, size_t len, size_t* needed);
+int archspec_get_features_into(const char* name, char* buf, size_t len, size_t* needed);
+int archspec_get_flags_into(const char* name, const char* compiler, char* buf, size_t len,
+                            size_t* needed);
+
 /* Check if a microarchitecture has a specific feature
  * Returns 1 if feature is present, 0 otherwise.
  */
@@ -76,6 +107,85 @@ const char* archspec_target_name(size_t index);
  */
 int archspec_target_exists(const char* name);
 
+/* Feature index queries
+ * features is a comma-separated list (empty entries are skipped); aliases resolve as in
+ * archspec_has_feature(). Target lists are comma-separated, in archspec_target_name() order.
+ * The returned strings must be freed with archspec_free(); NULL means an argument was NULL.
+ */
+
+/* Targets having every feature in features */
+char* archspec_targets_with(const char* features);
+
+/* Targets having none of the features in features */
+char* archspec_targets_without(const char* features);
+
+/* Least specific target of family (any family if NULL or "") having every feature
+ * Returns NULL if no target qualifies.
+ */
+char* archspec_minimal_target(const char* features, const char* family);
+
+/* Features of target a that target b lacks, comma-separated
+ * Returns NULL if either target is unknown.
+ */
+char* archspec_feature_diff(const char* a, const char* b);
+
+/* Values of archspec_cache.type */
+#define ARCHSPEC_CACHE_DATA 0
+#define ARCHSPEC_CACHE_INSTRUCTION 1
+#define ARCHSPEC_CACHE_UNIFIED 2
+
+#define ARCHSPEC_MAX_CACHES 8
+
+/* One kind of cache; hybrid CPUs may list a level more than once */
+typedef struct {
+    int level;
+    int type;           /* ARCHSPEC_CACHE_* */
+    uint64_t size;      /* Bytes per instance */
+    uint32_t line_size; /* Bytes */
+    uint32_t ways;      /* 0 if unknown */
+    uint32_t sharing;   /* Logical CPUs sharing one instance */
+    uint32_t instances; /* 0 if unknown */
+} archspec_cache;
+
+typedef struct {
+    uint32_t logical_cpus;
+    uint32_t physical_cores;
+    uint32_t packages;
+    uint32_t threads_per_core;
+    uint32_t numa_nodes;
+    uint32_t cache_count; /* Entries of caches in use, ordered by level then D/I/U */
+    archspec_cache caches[ARCHSPEC_MAX_CACHES];
+} archspec_topology;
+
+/* Fill *out with the host topology, detected once per process (no lscpu, no parsing on
+ * later calls). Returns 1 on success, 0 if out is NULL.
+ */
+int archspec_host_topology(archspec_topology* out);
+
+/* Returns the size in bytes of the host's level-N data or unified cache, or 0 if unknown */
+uint64_t archspec_host_cache_size(int level);
+
+/* Call count and latency of one instrumented function */
+typedef struct {
+    uint64_t calls;
+    uint64_t total_ns; /* Summed wall time of all calls */
+    uint64_t max_ns;   /* Slowest single call */
+} archspec_stat;
+
+typedef struct {
+    int enabled; /* 0 when the library was built without ARCHSPEC_TRACE */
+    archspec_stat load_embedded_data;
+    archspec_stat detect_cpu_info;
+    archspec_stat compatible_microarchitectures;
+    archspec_stat host;
+    archspec_stat optimization_flags;
+} archspec_stats;
+
+/* Fill *out with the instrumentation counters (all zero unless built with ARCHSPEC_TRACE)
+ * Does not trigger initialization, so it can be called before any other archspec_* function.
+ */
+void archspec_get_stats(archspec_stats* out);
+
 /* Free a string returned by archspec functions
  * Safe to call with NULL.
  */
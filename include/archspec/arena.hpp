@@ -0,0 +1,93 @@
+// This file is a part of Julia. License is MIT: https://julialang.org/license
+
+#ifndef ARCHSPEC_ARENA_HPP
+#define ARCHSPEC_ARENA_HPP
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace archspec {
+
+/**
+ * Read-only view of a contiguous array (a minimal std::span for C++17)
+ */
+template <typename T> class Span {
+  public:
+    Span() = default;
+    Span(const T* data, size_t size) : data_(data), size_(size) {}
+
+    const T* begin() const {
+        return data_;
+    }
+    const T* end() const {
+        return data_ + size_;
+    }
+    const T* data() const {
+        return data_;
+    }
+    size_t size() const {
+        return size_;
+    }
+    bool empty() const {
+        return size_ == 0;
+    }
+    const T& operator[](size_t i) const {
+        return data_[i];
+    }
+
+  private:
+    const T* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+/**
+ * Monotonic allocator for strings and flat arrays that live as long as their owner
+ * Memory is carved from large blocks and only released when the arena is destroyed, so views
+ * into it never dangle while the owner is alive. intern() stores each distinct string once.
+ * Not thread-safe; callers serialize access.
+ */
+class Arena {
+  public:
+    Arena() = default;
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // Stable copy of str, shared with every earlier intern() of the same contents
+    std::string_view intern(std::string_view str);
+
+    // Copy of items as a flat array; T must be trivially destructible
+    template <typename T> Span<T> copy(const std::vector<T>& items) {
+        if (items.empty())
+            return {};
+        T* out = static_cast<T*>(allocate(items.size() * sizeof(T), alignof(T)));
+        std::uninitialized_copy(items.begin(), items.end(), out);
+        return Span<T>(out, items.size());
+    }
+
+    // Bytes handed out so far, and bytes reserved from the system
+    size_t used() const {
+        return used_;
+    }
+    size_t reserved() const {
+        return reserved_;
+    }
+
+  private:
+    static constexpr size_t kBlockSize = 4 * 1024;
+
+    void* allocate(size_t size, size_t align);
+
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    char* cursor_ = nullptr;
+    size_t remaining_ = 0;
+    size_t used_ = 0;
+    size_t reserved_ = 0;
+    std::unordered_set<std::string_view> strings_;
+};
+
+} // namespace archspec
+
+#endif // ARCHSPEC_ARENA_HPP
@@ -19,6 +19,18 @@ struct CpuidRegisters {
     uint32_t edx = 0;
 };
 
+/**
+ * Extended register state the operating system has enabled for user code
+ * CPUID only says what the processor implements; AVX, AVX-512 and AMX instructions fault
+ * unless the OS also saves their registers on context switch (and, for AMX on Linux, the
+ * process has been granted the tile data state).
+ */
+struct OsXsaveState {
+    bool osxsave = false;       // CR4.OSXSAVE: XGETBV and the XSAVE family are usable
+    uint64_t xcr0 = 0;          // XCR0 as read by XGETBV (0 without OSXSAVE)
+    bool amx_permitted = false; // Tile data may be used (always true off Linux)
+};
+
 /**
  * CPUID wrapper class for x86/x86_64 processors
  */
@@ -27,7 +39,7 @@ class Cpuid {
     Cpuid();
 
     // Execute CPUID instruction with given inputs
-    CpuidRegisters query(uint32_t eax, uint32_t ecx = 0) const;
+    static CpuidRegisters query(uint32_t eax, uint32_t ecx = 0);
 
     // Get CPU vendor string (e.g., "GenuineIntel", "AuthenticAMD")
     std::string vendor() const {
@@ -44,17 +56,44 @@ class Cpuid {
         return highest_extended_;
     }
 
-    // Get all detected CPU features
+    // Get the detected CPU features the OS lets this process use
     const std::set<std::string>& features() const {
         return features_;
     }
 
+    // Get every feature CPUID reports, including those the OS has not enabled
+    const std::set<std::string>& raw_features() const {
+        return raw_features_;
+    }
+
+    // Get the OS state features() was masked with
+    const OsXsaveState& os_state() const {
+        return os_state_;
+    }
+
     // Get CPU brand string (e.g., "Intel(R) Core(TM) i7-...")
     std::string brand_string() const;
 
     // Check if CPUID is supported
     static bool is_supported();
 
+    // Every feature name features() can report, on any CPU
+    static const std::set<std::string>& known_features();
+
+    /**
+     * Get the OS state of this process, reading it only once
+     * On Linux, the first call asks the kernel for AMX tile data permission with
+     * arch_prctl(ARCH_REQ_XCOMP_PERM) when XCR0 enables tiles. The grant applies to the
+     * whole process and enlarges its signal frames.
+     */
+    static const OsXsaveState& host_os_state();
+
+    // Features in the given set that the OS state does not allow: the XSAVE family without
+    // OSXSAVE, AVX-encoded features without YMM state, AVX-512 without opmask and ZMM state,
+    // and AMX without tile state or permission
+    static std::set<std::string> os_disabled(const std::set<std::string>& features,
+                                             const OsXsaveState& state);
+
   private:
     void detect_features();
     bool is_bit_set(uint32_t reg, int bit) const;
@@ -63,6 +102,8 @@ class Cpuid {
     uint32_t highest_basic_ = 0;
     uint32_t highest_extended_ = 0;
     std::set<std::string> features_;
+    std::set<std::string> raw_features_;
+    OsXsaveState os_state_;
 };
 
 } // namespace archspec
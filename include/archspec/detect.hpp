@@ -24,9 +24,17 @@ constexpr std::string_view ARCH_RISCV64 = "riscv64";
 struct DetectedCpuInfo {
     std::string name;               // Detected CPU name (if available)
     std::string vendor;             // CPU vendor
-    std::set<std::string> features; // Detected CPU features
+    std::set<std::string> features; // Detected CPU features the OS lets this process use
     int generation = 0;             // Power generation (POWER CPUs only)
     std::string cpu_part;           // CPU part number (ARM only)
+
+    // Features the CPU reports but the OS has not enabled (x86 only; see OsXsaveState)
+    std::set<std::string> disabled_features;
+
+    // Interned form of features, comparable with the feature_mask() of instance()'s targets,
+    // or with those of targets owned by db
+    FeatureMask feature_mask() const;
+    FeatureMask feature_mask(const MicroarchitectureDatabase& db) const;
 };
 
 /**
@@ -35,18 +43,99 @@ struct DetectedCpuInfo {
  */
 std::string get_machine();
 
+/**
+ * Source of the information returned by detect_cpu_info()
+ */
+enum class DetectionMethod {
+    Auto,            // Platform default, see detect_cpu_info()
+    OperatingSystem, // /proc/cpuinfo on Linux, sysctl on macOS, CPUID on FreeBSD/Windows
+    Cpuid,           // CPUID instruction; falls back to OperatingSystem on non-x86 hosts
+    Hwcap,           // AT_HWCAP/AT_HWCAP2 and MIDR_EL1 (Linux AArch64); falls back elsewhere
+};
+
 /**
  * Detect CPU information from the host
- * Uses /proc/cpuinfo on Linux, sysctl on macOS/BSD, CPUID on Windows
+ * Uses /proc/cpuinfo on Linux, sysctl on macOS/BSD, CPUID on Windows. Linux AArch64 reads
+ * the auxiliary vector and MIDR_EL1 instead of /proc/cpuinfo, and Linux builds made with
+ * ARCHSPEC_CPUID_DETECTION=1 use CPUID on x86. On x86, features the OS has not enabled
+ * for this process are moved to disabled_features whichever source is used.
  */
 DetectedCpuInfo detect_cpu_info();
 
+/**
+ * Detect CPU information from the host using a specific method
+ */
+DetectedCpuInfo detect_cpu_info(DetectionMethod method);
+
 /**
  * Get the host microarchitecture
- * This is the main entry point for CPU detection
+ * This is the main entry point for CPU detection. Builds made with ARCHSPEC_HOST_CACHE=1
+ * answer from the on-disk cache of host_cache.hpp when it matches the boot, CPU and database.
  */
 Microarchitecture host();
 
+/**
+ * Get the host microarchitecture, detecting it only once per process
+ * Safe to call concurrently. The returned reference stays valid for the lifetime of the
+ * process, including across refresh_host().
+ */
+const Microarchitecture& host_cached();
+
+/**
+ * Get the CPU information that host_cached() was resolved from
+ * Same lifetime and thread-safety guarantees as host_cached().
+ */
+const DetectedCpuInfo& host_cpu_info_cached();
+
+/**
+ * Re-run host detection and replace the result returned by host_cached()
+ * References obtained before the refresh remain valid but keep the old values. Any on-disk
+ * cache is bypassed and rewritten.
+ */
+void refresh_host();
+
+/**
+ * SVE vector length of the calling thread in bits, or 0 when the host has no SVE
+ * Read with prctl(PR_SVE_GET_VL) on Linux AArch64, falling back to RDVL.
+ */
+uint32_t sve_vector_length();
+
+/**
+ * Tuning hints of host_cached(), with the SVE vector length measured at runtime
+ */
+TuningHints host_tuning();
+
+/**
+ * A group of logical CPUs that report identical information
+ * Hybrid parts (big.LITTLE, P-cores and E-cores) have one cluster per core type.
+ */
+struct CpuCluster {
+    std::vector<int> cpus;    // Logical CPU numbers, in the order the OS lists them
+    DetectedCpuInfo info;     // Information shared by every CPU in the cluster
+    Microarchitecture target; // Most specific target matching info
+};
+
+/**
+ * Parse every processor block of a /proc/cpuinfo file and group identical CPUs
+ * Clusters are ordered by the first CPU that belongs to them.
+ */
+std::vector<CpuCluster> parse_cpu_clusters(std::string_view content, std::string_view arch);
+
+/**
+ * Detect the clusters of the host CPU
+ * Uses every block of /proc/cpuinfo on Linux. Elsewhere all logical CPUs form one cluster
+ * described by detect_cpu_info().
+ */
+std::vector<CpuCluster> detect_cpu_clusters();
+
+/**
+ * Get the most specific target that every cluster can run
+ * Code built for it is safe to migrate between cores of any cluster.
+ */
+Microarchitecture common_microarchitecture(const std::vector<CpuCluster>& clusters);
+Microarchitecture common_microarchitecture(const std::vector<CpuCluster>& clusters,
+                                           std::string_view arch);
+
 /**
  * Get the CPU brand string (if available)
  */
@@ -65,23 +154,48 @@ std::vector<const Microarchitecture*> compatible_microarchitectures(const Detect
 std::vector<const Microarchitecture*> compatible_microarchitectures(const DetectedCpuInfo& info,
                                                                     std::string_view arch);
 
+/**
+ * Get the most specific target compatible with already-detected CPU information
+ * This is the selection host() applies to detect_cpu_info(). Returns nullptr when no target
+ * of the architecture is known.
+ */
+const Microarchitecture* best_match(const DetectedCpuInfo& info, std::string_view arch);
+
+/**
+ * Resolve many CPU records at once, as best_match() would resolve each of them
+ * Identical records are resolved once. threads > 1 spreads the distinct records over that many
+ * threads; 0 uses one per hardware thread. The result is parallel to infos.
+ */
+std::vector<const Microarchitecture*> resolve_batch(const DetectedCpuInfo* infos, size_t count,
+                                                    std::string_view arch, unsigned threads = 1);
+std::vector<const Microarchitecture*> resolve_batch(const std::vector<DetectedCpuInfo>& infos,
+                                                    std::string_view arch, unsigned threads = 1);
+
 /**
  * Compare microarchitectures for sorting: prefers more ancestors and more features
  * Returns true if a < b (a is less specific than b)
  */
 inline bool compare_microarch_specificity(const Microarchitecture* a, const Microarchitecture* b) {
-    size_t a_depth = a->ancestors().size();
-    size_t b_depth = b->ancestors().size();
+    size_t a_depth = a->depth();
+    size_t b_depth = b->depth();
     if (a_depth != b_depth)
         return a_depth < b_depth;
-    return a->features().size() < b->features().size();
+    return a->feature_views().size() < b->feature_views().size();
 }
 
+/**
+ * Parse the contents of a /proc/cpuinfo file as reported on the given architecture
+ * Only the first processor block is read. Available on every platform, so captured
+ * cpuinfo files can be inspected anywhere.
+ */
+DetectedCpuInfo parse_cpuinfo(std::string_view content, std::string_view arch);
+
 // Platform-specific detection functions
 
 #if defined(__linux__) || defined(__FreeBSD__)
 /**
  * Parse /proc/cpuinfo (Linux) or similar (FreeBSD)
+ * Features are reported as listed, without the OS state masking detect_cpu_info() applies.
  */
 DetectedCpuInfo detect_from_proc_cpuinfo();
 #endif
@@ -93,12 +207,17 @@ DetectedCpuInfo detect_from_proc_cpuinfo();
 DetectedCpuInfo detect_from_sysctl();
 #endif
 
-#if defined(_WIN32) || defined(_WIN64)
 /**
- * Detect CPU info using CPUID on Windows
+ * Detect CPU info using the CPUID instruction
+ * Returns an empty DetectedCpuInfo when the host is not x86.
  */
 DetectedCpuInfo detect_from_cpuid();
-#endif
+
+/**
+ * Detect CPU info from getauxval(AT_HWCAP/AT_HWCAP2) and the sysfs MIDR_EL1 register
+ * Returns an empty DetectedCpuInfo when not on Linux AArch64 or when either is unavailable.
+ */
+DetectedCpuInfo detect_from_hwcaps();
 
 // Compatibility check functions for different architectures
 namespace compatibility {
@@ -108,6 +227,15 @@ bool check_aarch64(const DetectedCpuInfo& info, const Microarchitecture& target)
 bool check_ppc64(const DetectedCpuInfo& info, const Microarchitecture& target);
 bool check_riscv64(const DetectedCpuInfo& info, const Microarchitecture& target);
 
+// Same checks with the detected features already converted by DetectedCpuInfo::feature_mask(),
+// so a scan over every target does not re-intern the feature set for each one. features is
+// interned against instance(); targets owned by another database (a snapshot) re-intern
+// info.features against it.
+bool check_x86_64(const DetectedCpuInfo& info, const FeatureMask& features,
+                  const Microarchitecture& target);
+bool check_aarch64(const DetectedCpuInfo& info, const FeatureMask& features,
+                   const Microarchitecture& target);
+
 } // namespace compatibility
 
 } // namespace archspec
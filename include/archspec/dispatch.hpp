@@ -0,0 +1,124 @@
+// This file is a part of Julia. License is MIT: https://julialang.org/license
+//
+// Runtime feature dispatch for hot kernels
+//
+// The host feature bitmask is computed once, on first use, and kept in its own cache line.
+// Feature ids are compile-time constants generated from the database JSON, so
+//
+//     if (archspec::host_has<archspec::feat::avx2>()) ...
+//
+// compiles to a load and a bit test once the mask is initialized.
+
+#ifndef ARCHSPEC_DISPATCH_HPP
+#define ARCHSPEC_DISPATCH_HPP
+
+#include "detect.hpp"
+#include "feature_mask.hpp"
+#include <cstddef>
+
+namespace archspec {
+
+namespace feat {
+
+// Ids of every target feature (see feature_ids.inc); names starting with a digit get a '_'
+enum Id : FeatureId {
+#define ARCHSPEC_FEATURE(identifier, name) identifier,
+#include "feature_ids.inc"
+#undef ARCHSPEC_FEATURE
+    kCount
+};
+
+static_assert(kCount <= FeatureMask::kCapacity, "generated feature ids must fit a FeatureMask");
+
+// Feature names indexed by Id, for diagnostics
+constexpr const char* kNames[] = {
+#define ARCHSPEC_FEATURE(identifier, name) name,
+#include "feature_ids.inc"
+#undef ARCHSPEC_FEATURE
+};
+
+} // namespace feat
+
+namespace detail {
+
+struct alignas(64) HostFeatures {
+    FeatureMask mask;
+};
+
+inline const HostFeatures& host_features() {
+    static const HostFeatures features{host_cpu_info_cached().feature_mask()};
+    return features;
+}
+
+} // namespace detail
+
+/**
+ * Features detected on the host, as a mask over the ids in feat
+ * Computed once per process; refresh_host() does not change it.
+ */
+inline const FeatureMask& host_feature_mask() {
+    return detail::host_features().mask;
+}
+
+/**
+ * Mask of a compile-time list of features
+ */
+template <FeatureId... Features> constexpr FeatureMask mask_of() {
+    FeatureMask mask;
+    (mask.set(Features), ...);
+    return mask;
+}
+
+/**
+ * True if the host has the feature (or all of the features)
+ */
+template <FeatureId Feature> inline bool host_has() {
+    static_assert(Feature < feat::kCount, "unknown feature id");
+    return host_feature_mask().test(Feature);
+}
+
+template <FeatureId... Features> inline bool host_has_all() {
+    return mask_of<Features...>().is_subset_of(host_feature_mask());
+}
+
+inline bool host_has(FeatureId feature) {
+    return host_feature_mask().test(feature);
+}
+
+/**
+ * One implementation of a function and the features it needs
+ */
+template <typename Fn> struct Variant {
+    FeatureMask required;
+    Fn fn;
+};
+
+/**
+ * Pick the first variant the host can run, in the style of a GCC/Clang ifunc resolver
+ * for target_clones: list variants from most to least specific and end with a baseline
+ * whose mask is empty. Returns nullptr if no variant matches.
+ *
+ *     using Kernel = void (*)(float*, size_t);
+ *     static const Variant<Kernel> kVariants[] = {
+ *         {mask_of<feat::avx512f, feat::avx512bw>(), kernel_avx512},
+ *         {mask_of<feat::avx2, feat::fma>(), kernel_avx2},
+ *         {FeatureMask(), kernel_generic},
+ *     };
+ *     static const Kernel kernel = select_variant(kVariants);
+ *
+ * This runs library code, so call it after static initialization (from a function-local
+ * static or a first-call trampoline) rather than from a real IFUNC resolver, which runs
+ * before relocations and constructors are complete.
+ */
+template <typename Fn, size_t N> Fn select_variant(const Variant<Fn> (&variants)[N]) {
+    const FeatureMask& host = host_feature_mask();
+    for (const auto& variant : variants) {
+        if (variant.required.is_subset_of(host))
+            return variant.fn;
+    }
+    return nullptr;
+}
+
+} // namespace archspec
+
+#endif // ARCHSPEC_DISPATCH_HPP
@@ -0,0 +1,143 @@
+// This file is a part of Julia. License is MIT: https://julialang.org/license
+
+#ifndef ARCHSPEC_FEATURE_MASK_HPP
+#define ARCHSPEC_FEATURE_MASK_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace archspec {
+
+/**
+ * Dense identifier of an interned feature name
+ * Assigned by MicroarchitectureDatabase at load time; see MicroarchitectureDatabase::feature_id()
+ */
+using FeatureId = uint32_t;
+
+/**
+ * Fixed-width bitset of interned features
+ * Bit i is set when the feature with FeatureId i is present.
+ */
+class FeatureMask {
+  public:
+    static constexpr size_t kWords = 4;
+    static constexpr size_t kCapacity = kWords * 64;
+
+    constexpr FeatureMask() = default;
+
+    constexpr void set(FeatureId id) {
+        if (id < kCapacity)
+            words_[id / 64] |= uint64_t(1) << (id % 64);
+    }
+
+    void reset(FeatureId id) {
+        if (id < kCapacity)
+            words_[id / 64] &= ~(uint64_t(1) << (id % 64));
+    }
+
+    constexpr bool test(FeatureId id) const {
+        return id < kCapacity && (words_[id / 64] >> (id % 64)) & 1;
+    }
+
+    bool none() const {
+        uint64_t bits = 0;
+        for (size_t i = 0; i < kWords; ++i)
+            bits |= words_[i];
+        return bits == 0;
+    }
+
+    bool any() const {
+        return !none();
+    }
+
+    size_t count() const {
+        size_t n = 0;
+        for (size_t i = 0; i < kWords; ++i) {
+            for (uint64_t w = words_[i]; w; w &= w - 1)
+                ++n;
+        }
+        return n;
+    }
+
+    // True if every feature in this mask is also in other
+    constexpr bool is_subset_of(const FeatureMask& other) const {
+        uint64_t missing = 0;
+        for (size_t i = 0; i < kWords; ++i)
+            missing |= words_[i] & ~other.words_[i];
+        return missing == 0;
+    }
+
+    // True if this mask and other share at least one feature
+    bool intersects(const FeatureMask& other) const {
+        uint64_t common = 0;
+        for (size_t i = 0; i < kWords; ++i)
+            common |= words_[i] & other.words_[i];
+        return common != 0;
+    }
+
+    FeatureMask& operator|=(const FeatureMask& other) {
+        for (size_t i = 0; i < kWords; ++i)
+            words_[i] |= other.words_[i];
+        return *this;
+    }
+
+    FeatureMask& operator&=(const FeatureMask& other) {
+        for (size_t i = 0; i < kWords; ++i)
+            words_[i] &= other.words_[i];
+        return *this;
+    }
+
+    // Features in this mask that are not in other
+    FeatureMask operator-(const FeatureMask& other) const {
+        FeatureMask result;
+        for (size_t i = 0; i < kWords; ++i)
+            result.words_[i] = words_[i] & ~other.words_[i];
+        return result;
+    }
+
+    friend FeatureMask operator|(FeatureMask a, const FeatureMask& b) {
+        return a |= b;
+    }
+
+    friend FeatureMask operator&(FeatureMask a, const FeatureMask& b) {
+        return a &= b;
+    }
+
+    bool operator==(const FeatureMask& other) const {
+        return words_ == other.words_;
+    }
+
+    bool operator!=(const FeatureMask& other) const {
+        return words_ != other.words_;
+    }
+
+    // Raw 64-bit words, least significant feature ids first
+    const std::array<uint64_t, kWords>& words() const {
+        return words_;
+    }
+
+  private:
+    std::array<uint64_t, kWords> words_{};
+};
+
+static_assert(sizeof(FeatureMask) == FeatureMask::kWords * sizeof(uint64_t),
+              "arrays of FeatureMask must be packed for subset_scan()");
+
+/**
+ * Check many masks against one: out[i] is 1 if masks[i].is_subset_of(available), else 0
+ * Dispatches at runtime to an AVX2 or NEON kernel when the host has one.
+ */
+void subset_scan(const FeatureMask* masks, size_t count, const FeatureMask& available,
+                 uint8_t* out);
+
+// Portable kernel behind subset_scan(), always available
+void subset_scan_scalar(const FeatureMask* masks, size_t count, const FeatureMask& available,
+                        uint8_t* out);
+
+// Kernel subset_scan() dispatches to: "avx2", "neon" or "scalar"
+const char* subset_scan_kernel();
+
+} // namespace archspec
+
+#endif // ARCHSPEC_FEATURE_MASK_HPP
@@ -0,0 +1,78 @@
+// This file is a part of Julia. License is MIT: https://julialang.org/license
+//
+// Host detection results persisted on disk, so short-lived processes skip detection
+
+#ifndef ARCHSPEC_HOST_CACHE_HPP
+#define ARCHSPEC_HOST_CACHE_HPP
+
+#include "detect.hpp"
+#include "microarchitecture.hpp"
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace archspec {
+
+/**
+ * Everything host_cached() and the host functions of the C API answer with
+ * Target features and flags are the strings archspec_host_features() and
+ * archspec_host_flags() return.
+ */
+struct HostCacheEntry {
+    std::string target;                                     // Name of host_cached()
+    DetectedCpuInfo info;                                   // host_cpu_info_cached()
+    std::string target_features;                            // Comma-separated
+    std::vector<std::pair<std::string, std::string>> flags; // Compiler -> default flags, sorted
+};
+
+/**
+ * Build the entry for a detection result, with the default flags of every compiler the
+ * database knows about
+ */
+HostCacheEntry make_host_cache_entry(const DetectedCpuInfo& info,
+                                     const Microarchitecture& target);
+
+/**
+ * Key that a cache entry must have been written under to be used
+ * Combines the boot ID (/proc/sys/kernel/random/boot_id on Linux, kern.bootsessionuuid on
+ * macOS), the CPU signature (CPUID leaves 1 and 7 and the OS state on x86, MIDR_EL1 and
+ * HWCAPs on Linux AArch64), MicroarchitectureDatabase::instance_content_hash() and the
+ * detection build options. Empty when the platform has no boot ID, which disables caching.
+ */
+std::string host_cache_key();
+
+/**
+ * Path of the cache file: $XDG_CACHE_HOME/archspec/host, else $HOME/.cache/archspec/host
+ * Empty when neither variable is set.
+ */
+std::string host_cache_path();
+
+/**
+ * Read an entry written under key, mapping the file with a single mmap
+ * Returns nullopt when the file is missing, malformed or has another key.
+ */
+std::optional<HostCacheEntry> read_host_cache(std::string_view path, std::string_view key);
+
+/**
+ * Write an entry under key, atomically replacing the file
+ * Creates the parent directory if needed. Returns false if the entry cannot be stored.
+ */
+bool write_host_cache(std::string_view path, std::string_view key, const HostCacheEntry& entry);
+
+/**
+ * Entry for the current boot, CPU and database read from host_cache_path(), or nullopt
+ * Always nullopt unless the library was built with ARCHSPEC_HOST_CACHE=1. host(),
+ * host_cached() and the host functions of the C API consult it before detecting.
+ */
+std::optional<HostCacheEntry> load_host_cache();
+
+/**
+ * Store an entry for the current boot, CPU and database; a no-op without ARCHSPEC_HOST_CACHE
+ */
+void store_host_cache(const HostCacheEntry& entry);
+
+} // namespace archspec
+
+#endif // ARCHSPEC_HOST_CACHE_HPP
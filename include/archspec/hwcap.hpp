@@ -0,0 +1,35 @@
+// This file is a part of Julia. License is MIT: https://julialang.org/license
+
+#ifndef ARCHSPEC_HWCAP_HPP
+#define ARCHSPEC_HWCAP_HPP
+
+#include <cstdint>
+#include <set>
+#include <string>
+
+namespace archspec {
+
+/**
+ * Decoding of Linux AArch64 hardware capabilities and the MIDR_EL1 register
+ * The functions are pure so captured values can be decoded on any host.
+ */
+namespace hwcap {
+
+// Feature names for the bits set in AT_HWCAP and AT_HWCAP2, spelled as on the
+// "Features" line of /proc/cpuinfo
+std::set<std::string> decode(uint64_t hwcap, uint64_t hwcap2);
+
+// Every feature name decode() can report
+const std::set<std::string>& known_features();
+
+// MIDR_EL1 implementer field formatted like /proc/cpuinfo "CPU implementer" (e.g. "0x41")
+std::string midr_implementer(uint64_t midr);
+
+// MIDR_EL1 part number field formatted like /proc/cpuinfo "CPU part" (e.g. "0xd0c")
+std::string midr_part(uint64_t midr);
+
+} // namespace hwcap
+
+} // namespace archspec
+
+#endif // ARCHSPEC_HWCAP_HPP
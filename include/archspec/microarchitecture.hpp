@@ -3,6 +3,8 @@
 #ifndef ARCHSPEC_MICROARCHITECTURE_HPP
 #define ARCHSPEC_MICROARCHITECTURE_HPP
 
+#include "arena.hpp"
+#include "feature_mask.hpp"
 #include <string>
 #include <string_view>
 #include <vector>
@@ -11,7 +13,11 @@
 #include <memory>
 #include <functional>
 #include <optional>
+#include <atomic>
 #include <cstdint>
+#include <deque>
+#include <shared_mutex>
+#include <unordered_map>
 
 namespace archspec {
 
@@ -29,6 +35,25 @@ struct CompilerEntry {
     std::string warnings; // Optional warning message
 };
 
+/**
+ * Throughput hints for code generation; 0 (or nullopt) means unknown
+ * Targets inherit every hint they do not set from their first parent that has it.
+ */
+struct TuningHints {
+    uint32_t vector_width = 0;      // Widest vectors (bits) executed at full width, not split
+    uint32_t fma_units = 0;         // FMA pipes per core at vector_width
+    uint32_t sve_vector_length = 0; // SVE vector length in bits, for SVE implementations
+    std::optional<bool> prefer_256; // AVX-512 code usually runs faster with 256-bit vectors
+
+    bool operator==(const TuningHints& other) const {
+        return vector_width == other.vector_width && fma_units == other.fma_units &&
+               sve_vector_length == other.sve_vector_length && prefer_256 == other.prefer_256;
+    }
+    bool operator!=(const TuningHints& other) const {
+        return !(*this == other);
+    }
+};
+
 /**
  * Represents a CPU microarchitecture
  */
@@ -36,10 +61,11 @@ class Microarchitecture {
   public:
     Microarchitecture() = default;
 
-    Microarchitecture(const std::string& name, const std::vector<std::string>& parents,
-                      const std::string& vendor, const std::set<std::string>& features,
-                      const std::map<std::string, std::vector<CompilerEntry>>& compilers,
-                      int generation = 0, const std::string& cpu_part = "");
+    // Arguments are taken by value and moved in, so callers can hand over temporaries
+    Microarchitecture(std::string name, std::vector<std::string> parents, std::string vendor,
+                      std::set<std::string> features,
+                      std::map<std::string, std::vector<CompilerEntry>> compilers,
+                      int generation = 0, std::string cpu_part = "", TuningHints tuning = {});
 
     // Accessors
     const std::string& name() const {
@@ -48,9 +74,8 @@ class Microarchitecture {
     const std::string& vendor() const {
         return vendor_;
     }
-    const std::set<std::string>& features() const {
-        return features_;
-    }
+    // Database-owned targets store only feature_views(); the set is built on first use
+    const std::set<std::string>& features() const;
     const std::vector<std::string>& parent_names() const {
         return parent_names_;
     }
@@ -64,17 +89,68 @@ class Microarchitecture {
         return cpu_part_;
     }
 
+    // Tuning hints: declared_tuning() as given in the data, tuning() with unset hints taken from
+    // the built-in table (src/microarchitectures_tuning.inc) and then from the parents
+    const TuningHints& declared_tuning() const {
+        return tuning_;
+    }
+    const TuningHints& tuning() const {
+        return lineage().tuning;
+    }
+
+    // Vector width (bits) to build kernels for: 256 when AVX-512 prefers 256-bit vectors,
+    // otherwise the widest vector extension in features() (the SVE length for SVE targets),
+    // falling back to tuning().vector_width
+    uint32_t preferred_vector_width() const;
+
+    // The same values as views into interned storage: the owning database's arena, or a
+    // process-wide arena for standalone targets. feature_views() is sorted like features().
+    std::string_view name_view() const {
+        return views().name;
+    }
+    std::string_view vendor_view() const {
+        return views().vendor;
+    }
+    std::string_view cpu_part_view() const {
+        return views().cpu_part;
+    }
+    Span<std::string_view> parent_views() const {
+        return views().parents;
+    }
+    Span<std::string_view> feature_views() const {
+        return views().features;
+    }
+
+    // Interned features (empty unless owned by a MicroarchitectureDatabase)
+    const FeatureMask& feature_mask() const {
+        return feature_mask_;
+    }
+
+    // Database that owns this target, or nullptr for standalone targets
+    const MicroarchitectureDatabase* database() const {
+        return db_;
+    }
+
     // Check if a feature is supported (includes aliases)
     bool has_feature(std::string_view feature) const;
 
     // Get all ancestors (parents and their parents recursively)
-    std::vector<std::string> ancestors() const;
+    // Database-owned targets return a view precomputed at load time
+    const std::vector<std::string>& ancestors() const;
+
+    // Number of ancestors (ancestors().size())
+    size_t depth() const {
+        return ancestors().size();
+    }
+
+    // Check whether name is this target or one of its ancestors
+    bool has_ancestor(std::string_view name) const;
 
     // Get the architecture family (root ancestor)
-    std::string family() const;
+    const std::string& family() const;
 
     // Get the best generic architecture compatible with this one
-    std::string generic() const;
+    const std::string& generic() const;
 
     // Comparison operators based on feature set hierarchy
     bool operator==(const Microarchitecture& other) const;
@@ -85,8 +161,18 @@ class Microarchitecture {
     bool operator>=(const Microarchitecture& other) const;
 
     // Get optimization flags for a compiler
+    // Results for database-owned targets are memoized per (target, compiler, version)
     std::string optimization_flags(std::string_view compiler, std::string_view version) const;
 
+    // Name of the target (this one or an ancestor) whose compiler entry supplies
+    // optimization_flags(compiler, version), or empty if none does
+    std::string optimization_flags_source(std::string_view compiler,
+                                          std::string_view version) const;
+
+    // LLVM target-features string and CPU name (see llvm_compat.hpp), computed once per target
+    const std::string& llvm_features() const;
+    const std::string& llvm_cpu_name() const;
+
     // Convert to/from string representation
     std::string to_string() const {
         return name_;
@@ -101,15 +187,187 @@ class Microarchitecture {
     std::string name_;
     std::vector<std::string> parent_names_;
     std::string vendor_;
-    std::set<std::string> features_;
     std::map<std::string, std::vector<CompilerEntry>> compilers_;
     int generation_ = 0;
     std::string cpu_part_;
+    TuningHints tuning_;
+
+    // compilers_ with version ranges parsed and {name} expanded, built at construction
+    struct FlagRule {
+        std::vector<int> min; // Empty when the range has no lower bound
+        std::vector<int> max; // Empty when the range has no upper bound
+        std::string exact;    // Constraint without a colon, compared literally
+        bool range = false;
+        std::string flags;
+    };
+    std::map<std::string, std::vector<FlagRule>, std::less<>> flag_rules_;
+
+    struct FlagsResult {
+        std::string flags;
+        std::string source; // Target whose entry matched
+    };
+    FlagsResult resolve_flags(std::string_view compiler, std::string_view version) const;
+    const FlagRule* match_flag_rule(std::string_view compiler, std::string_view version,
+                                    const std::vector<int>& parsed) const;
+
+    // Set by the owning database when it interns features
+    const MicroarchitectureDatabase* db_ = nullptr;
+    FeatureMask feature_mask_;
+
+    // Copies of a snapshot's targets still point into it through db_ and views_, so they keep
+    // it alive. Targets inside the snapshot hold it weakly, as a strong reference would be a
+    // cycle; copying one takes a strong reference.
+    struct SnapshotRef {
+        std::weak_ptr<const MicroarchitectureDatabase> weak;
+        std::shared_ptr<const MicroarchitectureDatabase> strong;
+
+        SnapshotRef() = default;
+        SnapshotRef(const SnapshotRef& other)
+            : weak(other.weak), strong(other.strong ? other.strong : other.weak.lock()) {}
+        SnapshotRef(SnapshotRef&&) = default;
+        SnapshotRef& operator=(const SnapshotRef& other) {
+            SnapshotRef copy(other);
+            return *this = std::move(copy);
+        }
+        SnapshotRef& operator=(SnapshotRef&&) = default;
+    };
+    SnapshotRef snapshot_;
+
+    // Data computed once and read-only afterwards. Readers that see ready() need no lock, and a
+    // copy takes the value only once it is ready, so copying never races with the computation.
+    template <typename T> class Published {
+      public:
+        Published() = default;
+        Published(const Published& other) {
+            *this = other;
+        }
+        Published& operator=(const Published& other) {
+            if (this != &other) {
+                bool ready = other.ready();
+                value_ = ready ? other.value_ : T();
+                ready_.store(ready, std::memory_order_release);
+            }
+            return *this;
+        }
+
+        bool ready() const {
+            return ready_.load(std::memory_order_acquire);
+        }
+        void publish() {
+            ready_.store(true, std::memory_order_release);
+        }
+        T& operator*() {
+            return value_;
+        }
+        const T& operator*() const {
+            return value_;
+        }
+        T* operator->() {
+            return &value_;
+        }
+        const T* operator->() const {
+            return &value_;
+        }
+
+      private:
+        T value_{};
+        std::atomic<bool> ready_{false};
+    };
+
+    // Ancestor closure, computed by the owning database at load time (or lazily, once, for
+    // standalone targets). bits holds this target and its ancestors as database indices,
+    // valid while epoch matches the database's (a full rebuild renumbers every target).
+    struct Lineage {
+        std::vector<std::string> ancestors;
+        std::string family;
+        std::string generic;
+        TuningHints tuning;
+        std::vector<uint64_t> bits;
+        uint64_t epoch = 0;
+    };
+    mutable Published<Lineage> lineage_;
+    uint32_t index_ = 0; // topological position in the owning database
+
+    // LLVM names, filled by the owning database at load time (or lazily for standalone targets)
+    struct LlvmNames {
+        std::string features;
+        std::string cpu_name;
+    };
+    mutable Published<LlvmNames> llvm_;
+    const LlvmNames& llvm_names() const;
+    void compute_llvm_names(LlvmNames& out) const;
+
+    // Interned copies behind the *_view() accessors, filled by the owning database at load time
+    // (or lazily for standalone targets)
+    struct Views {
+        std::string_view name;
+        std::string_view vendor;
+        std::string_view cpu_part;
+        Span<std::string_view> parents;
+        Span<std::string_view> features;
+    };
+    mutable Published<Views> views_;
+    const Views& views() const;
+    void intern_views(Arena& arena, Views& out) const;
+
+    // Declared features; the owning database drops them once views_ holds them
+    mutable Published<std::set<std::string>> features_;
+    bool declares(std::string_view feature) const;
+
+    const Lineage& lineage() const;
+    bool lineage_bits_current() const;
+    static void compute_lineage(const Microarchitecture& target,
+                                const MicroarchitectureDatabase& db, Lineage& out);
+
+    friend class MicroarchitectureDatabase;
+    friend bool load_json_into_database(MicroarchitectureDatabase& db, std::string_view json_data,
+                                        bool overlay);
 
     // Helper to get all names in ancestor chain (including self)
     std::set<std::string> to_set() const;
 };
 
+/**
+ * Columnar copy of MicroarchitectureDatabase::all() for compatibility scans
+ * Row i describes targets[i], in all() order. vendors and families index vendor_names and
+ * family_names; masks is packed so it can be handed to subset_scan() directly.
+ */
+struct TargetTable {
+    std::vector<FeatureMask> masks;
+    std::vector<uint16_t> vendors;
+    std::vector<uint16_t> families;
+    std::vector<int> generations;
+    std::vector<const Microarchitecture*> targets;
+    std::vector<std::string> vendor_names;
+    std::vector<std::string> family_names;
+
+    // Inverted index: for each interned feature id, a bitmap of the rows whose target declares
+    // it, bitmap_words words long (bit i of word w is row 64 * w + i)
+    std::vector<uint64_t> feature_rows;
+    size_t bitmap_words = 0;
+
+    size_t size() const {
+        return targets.size();
+    }
+
+    // Rows with feature id, or nullptr if the id is not interned
+    const uint64_t* feature_bitmap(FeatureId id) const {
+        size_t offset = size_t(id) * bitmap_words;
+        return offset < feature_rows.size() ? feature_rows.data() + offset : nullptr;
+    }
+
+    // Index of a vendor or family name, or -1 if no row has it
+    int vendor_id(std::string_view name) const;
+    int family_id(std::string_view name) const;
+};
+
+/**
+ * Immutable database that is not the singleton, safe to read from any number of threads
+ * Targets obtained from it resolve ancestors, aliases and flags against it, and stay valid for
+ * as long as the snapshot is held. See MicroarchitectureDatabase::make_snapshot().
+ */
+using DatabaseSnapshot = std::shared_ptr<const class MicroarchitectureDatabase>;
+
 /**
  * Database of all known microarchitectures
  * Singleton pattern with lazy initialization
@@ -119,6 +377,10 @@ class MicroarchitectureDatabase {
     // Get the singleton instance
     static MicroarchitectureDatabase& instance();
 
+    // Build a new database from the embedded data, then apply each overlay in order with
+    // load_overlay() semantics. Returns nullptr if an overlay fails to parse.
+    static DatabaseSnapshot make_snapshot(const std::vector<std::string>& overlays = {});
+
     // Get a microarchitecture by name (returns nullopt if not found)
     std::optional<std::reference_wrapper<const Microarchitecture>> get(std::string_view name) const;
 
@@ -133,10 +395,28 @@ class MicroarchitectureDatabase {
         return targets_;
     }
 
-    // Load from various formats
+    // Get all microarchitectures with every parent listed before its children
+    const std::vector<const Microarchitecture*>& topological_order() const {
+        return topo_order_;
+    }
+
+    // Load from various formats; targets that already exist are kept
     bool load_from_file(std::string_view path);
     bool load_from_string(std::string_view json_data);
 
+    // Load JSON whose targets replace existing ones of the same name (aliases and conversions
+    // are replaced by either loader). Only the changed targets and their descendants have
+    // their ancestors, masks, LLVM names and memoized flags recomputed.
+    bool load_overlay(std::string_view json_data);
+    bool load_overlay_file(std::string_view path);
+
+    // Compact binary form of the whole database (see src/binary_format.cpp); load_binary()
+    // maps the file read-only and merges it like load_from_string(). A file that supplied
+    // targets stays mapped for the database's lifetime, so replace it rather than rewrite it
+    // in place; save_binary() does so.
+    bool save_binary(std::string_view path) const;
+    bool load_binary(std::string_view path);
+
     // Get feature aliases
     const std::map<std::string, std::set<std::string>>& feature_aliases() const {
         return feature_aliases_;
@@ -157,6 +437,59 @@ class MicroarchitectureDatabase {
         return arm_vendors_;
     }
 
+    // Interned feature ids (stable for the lifetime of the process, never reused)
+    std::optional<FeatureId> feature_id(std::string_view name) const;
+    const std::string& feature_name(FeatureId id) const {
+        return feature_names_[id];
+    }
+    size_t feature_count() const {
+        return feature_names_.size();
+    }
+
+    // True while every interned feature fits in a FeatureMask (masks are authoritative)
+    bool masks_exact() const {
+        return feature_names_.size() <= FeatureMask::kCapacity;
+    }
+
+    // Build a mask from feature names; names that no target uses are ignored
+    FeatureMask feature_mask(const std::set<std::string>& features) const;
+
+    // Columnar view of all(), rebuilt on every load
+    const TargetTable& target_table() const {
+        return table_;
+    }
+
+    // Queries answered by intersecting target_table() bitmaps; features resolve aliases like
+    // has_feature(), and target lists are in all() order. targets_without() returns targets
+    // having none of the features.
+    std::vector<const Microarchitecture*>
+    targets_with(const std::vector<std::string_view>& features) const;
+    std::vector<const Microarchitecture*>
+    targets_without(const std::vector<std::string_view>& features) const;
+
+    // Least specific target of family (any family if empty) having every feature: fewest
+    // ancestors, then fewest features, then name. nullptr if there is none.
+    const Microarchitecture* minimal_target(const std::vector<std::string_view>& features,
+                                            std::string_view family = {}) const;
+
+    // Features of a that b lacks, sorted
+    std::vector<std::string> feature_diff(const Microarchitecture& a,
+                                          const Microarchitecture& b) const;
+
+    // Incremented by every load, so holders of derived data can tell when to rebuild it
+    uint64_t generation() const {
+        return generation_;
+    }
+
+    // Hash of the data loaded into this database, in load order; processes that load the
+    // same data compute the same value
+    uint64_t content_hash() const {
+        return content_hash_;
+    }
+
+    // content_hash() of instance(), or the value it will have, without building it
+    static uint64_t instance_content_hash();
+
   private:
     MicroarchitectureDatabase();
     ~MicroarchitectureDatabase() = default;
@@ -165,15 +498,63 @@ class MicroarchitectureDatabase {
 
     void load_embedded_data();
 
+    // Intern features, rebuild per-target masks and the topological ancestor index after a load
+    void finalize();
+    FeatureId intern_feature(std::string_view name);
+
+    // Incremental finalize() after a load into a populated database; changed lists the targets
+    // that were added or replaced
+    void refresh(const std::vector<std::string>& changed);
+    void prepare_target(Microarchitecture& target);
+    void rebuild_table_and_aliases();
+
+    struct AliasEntry {
+        FeatureMask any_of;
+        const std::set<std::string>* families = nullptr;
+        std::vector<uint64_t> rows; // Targets it holds for, as a TargetTable bitmap
+    };
+    const AliasEntry* find_alias(std::string_view name) const;
+
+    // Bitmap of the target_table() rows having every feature, or any of them
+    std::vector<uint64_t> rows_with(const std::vector<std::string_view>& features,
+                                    bool every) const;
+    std::vector<const Microarchitecture*> rows_to_targets(const std::vector<uint64_t>& rows) const;
+
+    // Backing store for every target's views; declared first so it outlives the targets
+    Arena arena_;
+    std::vector<std::shared_ptr<const void>> mappings_; // Files load_binary() took targets from
+
     std::map<std::string, Microarchitecture> targets_;
     std::map<std::string, std::set<std::string>> feature_aliases_;
     std::map<std::string, std::set<std::string>> family_features_;
     std::map<std::string, std::string> darwin_flags_;
     std::map<std::string, std::string> arm_vendors_;
     bool loaded_ = false;
-
-    // Allow JSON parsing helper access to private members
-    friend bool load_json_into_database(MicroarchitectureDatabase& db, std::string_view json_data);
+    uint64_t content_hash_ = 0;
+    uint64_t generation_ = 0;
+
+    // Interner storage: deque keeps names at stable addresses for the string_view keys
+    std::deque<std::string> feature_names_;
+    std::unordered_map<std::string_view, FeatureId> feature_ids_;
+    std::unordered_map<std::string_view, AliasEntry> aliases_;
+
+    // Targets in topological order (parents before children) and name -> position
+    std::vector<const Microarchitecture*> topo_order_;
+    std::unordered_map<std::string_view, uint32_t> target_index_;
+    uint64_t index_epoch_ = 0; // Bumped whenever finalize() renumbers targets_
+    TargetTable table_;
+
+    // Memoized optimization_flags results, keyed by "target\0compiler\0version"; cleared on load
+    static constexpr size_t kFlagsCacheLimit = 16384;
+    mutable std::shared_mutex flags_mutex_;
+    mutable std::unordered_map<std::string, Microarchitecture::FlagsResult> flags_cache_;
+
+    friend class Microarchitecture;
+
+    // Allow JSON parsing and static table helpers access to private members
+    friend bool load_json_into_database(MicroarchitectureDatabase& db, std::string_view json_data,
+                                        bool overlay);
+    friend void load_tables_into_database(MicroarchitectureDatabase& db);
 };
 
 // Convenience function to get a microarchitecture by name
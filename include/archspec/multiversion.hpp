@@ -0,0 +1,79 @@
+// This file is a part of Julia. License is MIT: https://julialang.org/license
+//
+// Function multiversioning planner: turns a list of desired targets into the clone set of a
+// fat binary or sysimage, and picks one of them at load time
+
+#ifndef ARCHSPEC_MULTIVERSION_HPP
+#define ARCHSPEC_MULTIVERSION_HPP
+
+#include "microarchitecture.hpp"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace archspec {
+
+/**
+ * One code clone of a multiversioned build
+ */
+struct Clone {
+    static constexpr uint32_t kNoBase = UINT32_MAX;
+
+    const Microarchitecture* target = nullptr;
+    uint32_t base = kNoBase;        // Index of the clone this one extends, if any
+    std::vector<std::string> added; // Features over the base (all features without one)
+    std::string flags;              // optimization_flags(compiler, version)
+    std::string llvm_cpu;           // llvm_cpu_name()
+    std::string llvm_features;      // llvm_features()
+    FeatureMask mask;               // Features the host needs to run this clone
+};
+
+/**
+ * Feature masks to test at load time, most specific clone first
+ */
+struct DispatchTable {
+    static constexpr uint32_t kNoClone = UINT32_MAX;
+
+    std::vector<FeatureMask> masks;
+    std::vector<uint32_t> clones; // clones[i] is the clone index for masks[i]
+
+    // First (most specific) clone whose features the host has, or kNoClone
+    uint32_t select(const FeatureMask& host) const {
+        for (size_t i = 0; i < masks.size(); ++i) {
+            if (masks[i].is_subset_of(host))
+                return clones[i];
+        }
+        return kNoClone;
+    }
+};
+
+/**
+ * Result of plan_clones()
+ */
+struct ClonePlan {
+    std::vector<Clone> clones; // Every base precedes the clones built on it
+    DispatchTable dispatch;
+    std::vector<std::string> skipped; // Unknown names, or targets the compiler cannot build
+};
+
+/**
+ * Plan the clones for a list of desired targets built with compiler at version
+ * Duplicates (by name or by feature set) are dropped, keeping the first occurrence. Clones are
+ * sorted so that each comes after every clone whose features it includes; each one records
+ * the closest such clone as its base.
+ */
+ClonePlan plan_clones(const std::vector<std::string>& targets, std::string_view compiler,
+                      std::string_view version);
+
+/**
+ * Clone to run on a host with the given features (see DetectedCpuInfo::feature_mask()),
+ * or DispatchTable::kNoClone if none of them can run there
+ */
+inline uint32_t select_clone(const ClonePlan& plan, const FeatureMask& host_mask) {
+    return plan.dispatch.select(host_mask);
+}
+
+} // namespace archspec
+
+#endif // ARCHSPEC_MULTIVERSION_HPP
@@ -0,0 +1,60 @@
+// This file is a part of Julia. License is MIT: https://julialang.org/license
+//
+// Publishing database snapshots to concurrent readers
+//
+// MicroarchitectureDatabase::make_snapshot() builds an immutable database, optionally with
+// overlays applied; AtomicSnapshot lets a long-running process swap the one its readers use
+// (for example after a config reload) without stopping them.
+
+#ifndef ARCHSPEC_SNAPSHOT_HPP
+#define ARCHSPEC_SNAPSHOT_HPP
+
+#include "microarchitecture.hpp"
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace archspec {
+
+/**
+ * Holder of the current snapshot, replaceable while readers use it
+ *
+ * load() never blocks: it pins the published slot with a reader count, copies the shared_ptr
+ * and unpins. store() publishes a new snapshot with one pointer swap, so a reader sees either
+ * the old snapshot or the new one, never a mix. Slots replaced by store() are freed once no
+ * reader is inside load() (checked on later stores, reclaim() and destruction); the snapshots
+ * themselves live until their last shared_ptr is released.
+ */
+class AtomicSnapshot {
+  public:
+    explicit AtomicSnapshot(DatabaseSnapshot initial);
+    ~AtomicSnapshot();
+
+    AtomicSnapshot(const AtomicSnapshot&) = delete;
+    AtomicSnapshot& operator=(const AtomicSnapshot&) = delete;
+
+    // Current snapshot (never nullptr unless one was stored)
+    DatabaseSnapshot load() const;
+
+    // Publish next; concurrent store() calls are serialized against each other
+    void store(DatabaseSnapshot next);
+
+    // Free retired slots if no reader is inside load(); returns how many are still retired
+    size_t reclaim();
+
+  private:
+    struct Slot {
+        DatabaseSnapshot snapshot;
+    };
+
+    size_t reclaim_locked();
+
+    std::atomic<Slot*> current_;
+    mutable std::atomic<uint32_t> readers_{0};
+    std::mutex writer_mutex_;
+    std::vector<Slot*> retired_;
+};
+
+} // namespace archspec
+
+#endif // ARCHSPEC_SNAPSHOT_HPP
@@ -0,0 +1,45 @@
+// This file is a part of Julia. License is MIT: https://julialang.org/license
+
+#ifndef ARCHSPEC_STATS_HPP
+#define ARCHSPEC_STATS_HPP
+
+#include <cstdint>
+
+namespace archspec {
+
+/**
+ * Call count and latency of one instrumented function
+ */
+struct StatCounter {
+    uint64_t calls = 0;
+    uint64_t total_ns = 0; // Summed wall time of all calls
+    uint64_t max_ns = 0;   // Slowest single call
+};
+
+/**
+ * Snapshot of the instrumentation counters
+ * Counters are only collected when the library is built with ARCHSPEC_TRACE=1; otherwise
+ * enabled is false and every counter stays zero.
+ */
+struct Stats {
+    bool enabled = false;
+    StatCounter load_embedded_data;
+    StatCounter detect_cpu_info;
+    StatCounter compatible_microarchitectures;
+    StatCounter host;
+    StatCounter optimization_flags;
+};
+
+/**
+ * Get the current counters; safe to call concurrently with instrumented functions
+ */
+Stats stats();
+
+/**
+ * Reset every counter to zero
+ */
+void reset_stats();
+
+} // namespace archspec
+
+#endif // ARCHSPEC_STATS_HPP
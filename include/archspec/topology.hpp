@@ -0,0 +1,100 @@
+// This file is a part of Julia. License is MIT: https://julialang.org/license
+//
+// CPU topology and cache hierarchy of the host, for sizing thread pools and tiles
+
+#ifndef ARCHSPEC_TOPOLOGY_HPP
+#define ARCHSPEC_TOPOLOGY_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace archspec {
+
+enum class CacheType : uint8_t { Data, Instruction, Unified };
+
+/**
+ * One kind of cache: every instance of a given level and type with the same geometry
+ * Hybrid parts list e.g. the L2 of their P-cores and of their E-cores separately.
+ */
+struct CacheInfo {
+    int level = 0;
+    CacheType type = CacheType::Unified;
+    uint64_t size = 0;      // Bytes per instance
+    uint32_t line_size = 0; // Coherency line size in bytes
+    uint32_t ways = 0;      // Associativity (0 if unknown, 1 for direct-mapped)
+    uint32_t sets = 0;
+    uint32_t sharing = 0;   // Logical CPUs sharing one instance
+    uint32_t instances = 0; // Instances in the system (0 if unknown)
+};
+
+/**
+ * Processor topology of the host
+ * Counts cover the CPUs that are online. Lists of CPUs use the OS logical CPU numbers.
+ * Systems that report no NUMA information have a single node holding every CPU; a
+ * topology read from CPUID alone has no cores or nodes.
+ */
+struct CpuTopology {
+    uint32_t logical_cpus = 0;
+    uint32_t physical_cores = 0;
+    uint32_t packages = 0;
+    uint32_t threads_per_core = 0;            // Largest number of SMT siblings of any core
+    std::vector<std::vector<int>> cores;      // Logical CPUs of each core (empty if unknown)
+    std::vector<std::vector<int>> numa_nodes; // Logical CPUs of each NUMA node (see below)
+    std::vector<CacheInfo> caches;            // By level, then D/I/U, then first CPU served
+
+    // First cache of the given level and type, or nullptr; a level-1 Data or Instruction
+    // lookup does not fall back to a Unified cache
+    const CacheInfo* cache(int level, CacheType type = CacheType::Unified) const;
+
+    // Size in bytes of the first cache of a level that holds data (Data or Unified), or 0
+    uint64_t data_cache_size(int level) const;
+};
+
+/**
+ * Parse a Linux CPU list such as "0-3,8,10-11" (the cpulist and *_list files in sysfs)
+ * Returns the CPUs in ascending order; malformed entries are skipped.
+ */
+std::vector<int> parse_cpu_list(std::string_view list);
+
+/**
+ * Detect the topology of the host
+ * Reads sysfs on Linux and sysctl on macOS; elsewhere, and for any cache information sysfs
+ * lacks, falls back to CPUID leaves 4/0x8000001D and 0xB/0x1F on x86 and
+ * std::thread::hardware_concurrency() for the CPU count.
+ */
+CpuTopology detect_topology();
+
+/**
+ * Get the host topology, detecting it only once per process
+ * Safe to call concurrently. The returned reference stays valid for the lifetime of the
+ * process, including across refresh_topology().
+ */
+const CpuTopology& topology_cached();
+
+/**
+ * Re-run topology detection (after CPU hotplug, say) and replace the topology_cached() result
+ * References obtained before the refresh remain valid but keep the old values.
+ */
+void refresh_topology();
+
+/**
+ * Topology visible through CPUID alone, as seen from the calling CPU
+ * Caches come from leaf 4 (Intel) or 0x8000001D (AMD) and SMT width from leaf 0x1F or 0xB;
+ * core and package counts assume every package matches the calling one. Returns an empty
+ * topology when the host is not x86.
+ */
+CpuTopology detect_topology_from_cpuid();
+
+#if defined(__linux__)
+/**
+ * Read the topology from a sysfs tree (root is normally "/sys")
+ * Uses devices/system/cpu/{online,cpuN/topology,cpuN/cache} and devices/system/node.
+ */
+CpuTopology detect_topology_from_sysfs(std::string_view root = "/sys");
+#endif
+
+} // namespace archspec
+
+#endif // ARCHSPEC_TOPOLOGY_HPP
@@ -2,8 +2,14 @@
 
 #include "archspec/archspec_c.h"
 #include "archspec/archspec.hpp"
+#include "archspec/host_cache.hpp"
+#include <atomic>
 #include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 // Helper to convert C++ string to allocated C string
@@ -16,10 +22,10 @@ static char* to_c_string(const std::string& str) {
 }
 
 // Helper to join strings with comma
-static std::string join_features(const std::set<std::string>& features) {
+static std::string join_features(archspec::Span<std::string_view> features) {
     std::string result;
     bool first = true;
-    for (const auto& f : features) {
+    for (std::string_view f : features) {
         if (!first)
             result += ",";
         result += f;
@@ -28,78 +34,245 @@ static std::string join_features(const std::set<std::string>& features) {
     return result;
 }
 
+// Precomputed strings for one target, so lookups return stable pointers without allocating
+struct TargetStrings {
+    std::string features;                                  // comma-separated feature list
+    std::map<std::string, std::string, std::less<>> flags; // compiler -> default flags
+};
+
+static TargetStrings make_target_strings(const archspec::Microarchitecture& target,
+                                         const std::set<std::string>& compilers) {
+    TargetStrings result;
+    result.features = join_features(target.feature_views());
+    for (const auto& compiler : compilers) {
+        // Use empty version string to get default flags
+        std::string flags = target.optimization_flags(compiler, "");
+        if (!flags.empty())
+            result.flags.emplace(compiler, std::move(flags));
+    }
+    return result;
+}
+
 // Static storage for host name and vendor (avoid repeated allocation)
+// Written exactly once under s_host_once and read-only afterwards, so readers need no lock
 static std::string s_host_name;
 static std::string s_host_vendor;
-static std::vector<std::string> s_target_names;
-static bool s_initialized = false;
+static TargetStrings s_host_strings;
+static std::once_flag s_host_once;
 
-static void ensure_initialized() {
-    if (!s_initialized) {
-        auto host_arch = archspec::host();
-        s_host_name = host_arch.name();
+// Strings of every target for one database generation; read-only once published
+struct TargetStringTable {
+    uint64_t generation = 0;
+    std::vector<std::string> names;
+    std::unordered_map<std::string_view, const TargetStrings*> strings;
+};
 
-        auto info = archspec::detect_cpu_info();
-        s_host_vendor = info.vendor;
+// The current table, rebuilt under s_table_mutex when the database generation moves on.
+// Every table and string set ever published is kept, so pointers handed out stay valid.
+static std::atomic<const TargetStringTable*> s_table{nullptr};
+static std::mutex s_table_mutex;
+static std::vector<std::unique_ptr<TargetStringTable>> s_tables;
+static std::vector<std::unique_ptr<TargetStrings>> s_strings;
 
-        // Cache target names
-        const auto& db = archspec::MicroarchitectureDatabase::instance();
-        s_target_names = db.all_names();
+// Every compiler any target has flags for
+static std::set<std::string> known_compilers() {
+    std::set<std::string> compilers;
+    for (const auto& [name, target] : archspec::MicroarchitectureDatabase::instance().all()) {
+        for (const auto& [compiler, _] : target.compilers())
+            compilers.insert(compiler);
+    }
+    return compilers;
+}
 
-        s_initialized = true;
+// Host strings alone; an on-disk cache hit answers them without loading the database
+static void ensure_host_initialized() {
+    std::call_once(s_host_once, [] {
+        if (auto entry = archspec::load_host_cache()) {
+            s_host_name = std::move(entry->target);
+            s_host_vendor = std::move(entry->info.vendor);
+            s_host_strings.features = std::move(entry->target_features);
+            for (auto& [compiler, flags] : entry->flags)
+                s_host_strings.flags.emplace(std::move(compiler), std::move(flags));
+            return;
+        }
+        s_host_name = archspec::host_cached().name();
+        s_host_vendor = archspec::host_cpu_info_cached().vendor;
+        s_host_strings = make_target_strings(archspec::host_cached(), known_compilers());
+    });
+}
+
+// Feature and flag strings for every target and every known compiler, current with the
+// database; entries whose strings did not change keep their storage
+static const TargetStringTable& ensure_initialized() {
+    ensure_host_initialized();
+    const auto& db = archspec::MicroarchitectureDatabase::instance();
+    const TargetStringTable* table = s_table.load(std::memory_order_acquire);
+    if (table && table->generation == db.generation())
+        return *table;
+
+    std::lock_guard<std::mutex> lock(s_table_mutex);
+    table = s_table.load(std::memory_order_relaxed);
+    if (table && table->generation == db.generation())
+        return *table;
+
+    auto next = std::make_unique<TargetStringTable>();
+    next->generation = db.generation();
+    next->names = db.all_names();
+    std::set<std::string> compilers = known_compilers();
+    for (const auto& name : next->names) { // Keys view names, which never moves again
+        TargetStrings strings = make_target_strings(db.get(name)->get(), compilers);
+        const TargetStrings* previous = nullptr;
+        if (table) {
+            auto it = table->strings.find(name);
+            if (it != table->strings.end() && it->second->features == strings.features &&
+                it->second->flags == strings.flags)
+                previous = it->second;
+        }
+        if (!previous) {
+            s_strings.push_back(std::make_unique<TargetStrings>(std::move(strings)));
+            previous = s_strings.back().get();
+        }
+        next->strings.emplace(name, previous);
     }
+
+    s_tables.push_back(std::move(next));
+    s_table.store(s_tables.back().get(), std::memory_order_release);
+    return *s_tables.back();
+}
+
+// Cached strings for a target, or nullptr if the database does not have it
+static const TargetStrings* find_target_strings(const char* name) {
+    const TargetStringTable& table = ensure_initialized();
+    auto it = table.strings.find(name);
+    return it != table.strings.end() ? it->second : nullptr;
+}
+
+static const std::string* find_flags(const TargetStrings& strings, const char* compiler) {
+    auto it = strings.flags.find(std::string_view(compiler));
+    return it != strings.flags.end() ? &it->second : nullptr;
+}
+
+// Copy str into buf as a NUL-terminated string, truncating if len is too small
+static int copy_into(const std::string* str, char* buf, size_t len, size_t* needed) {
+    size_t required = str ? str->size() + 1 : 0;
+    if (needed)
+        *needed = required;
+    if (!str) {
+        if (buf && len > 0)
+            buf[0] = '\0';
+        return 0;
+    }
+    if (!buf || len == 0)
+        return 0;
+    size_t n = required <= len ? str->size() : len - 1;
+    memcpy(buf, str->data(), n);
+    buf[n] = '\0';
+    return required <= len ? 1 : 0;
+}
+
+static archspec_stat to_c_stat(const archspec::StatCounter& counter) {
+    archspec_stat result;
+    result.calls = counter.calls;
+    result.total_ns = counter.total_ns;
+    result.max_ns = counter.max_ns;
+    return result;
 }
 
 extern "C" {
 
 const char* archspec_host_name(void) {
-    ensure_initialized();
+    ensure_host_initialized();
     return s_host_name.empty() ? nullptr : s_host_name.c_str();
 }
 
 char* archspec_host_features(void) {
-    auto host_arch = archspec::host();
-    return to_c_string(join_features(host_arch.features()));
+    ensure_host_initialized();
+    return to_c_string(s_host_strings.features);
 }
 
 const char* archspec_host_vendor(void) {
-    ensure_initialized();
+    ensure_host_initialized();
     return s_host_vendor.empty() ? nullptr : s_host_vendor.c_str();
 }
 
 char* archspec_get_features(const char* name) {
     if (!name)
         return nullptr;
-    const auto& db = archspec::MicroarchitectureDatabase::instance();
-    auto target = db.get(name);
-    if (!target)
-        return nullptr;
-    return to_c_string(join_features(target->get().features()));
+    const auto* strings = find_target_strings(name);
+    return strings ? to_c_string(strings->features) : nullptr;
 }
 
 char* archspec_get_flags(const char* name, const char* compiler) {
     if (!name || !compiler)
         return nullptr;
-    const auto& db = archspec::MicroarchitectureDatabase::instance();
-    auto target = db.get(name);
-    if (!target)
-        return nullptr;
-    // Use empty version string to get default flags
-    std::string flags = target->get().optimization_flags(compiler, "");
-    if (flags.empty())
-        return nullptr;
-    return to_c_string(flags);
+    const auto* strings = find_target_strings(name);
+    const auto* flags = strings ? find_flags(*strings, compiler) : nullptr;
+    return flags ? to_c_string(*flags) : nullptr;
 }
 
 char* archspec_host_flags(const char* compiler) {
     if (!compiler)
         return nullptr;
-    auto host_arch = archspec::host();
-    // Use empty version string to get default flags
-    std::string flags = host_arch.optimization_flags(compiler, "");
-    if (flags.empty())
+    ensure_host_initialized();
+    const auto* flags = find_flags(s_host_strings, compiler);
+    return flags ? to_c_string(*flags) : nullptr;
+}
+
+const char* archspec_host_features_static(void) {
+    ensure_host_initialized();
+    return s_host_strings.features.c_str();
+}
+
+const char* archspec_host_flags_static(const char* compiler) {
+    if (!compiler)
+        return nullptr;
+    ensure_host_initialized();
+    const auto* flags = find_flags(s_host_strings, compiler);
+    return flags ? flags->c_str() : nullptr;
+}
+
+const char* archspec_get_features_static(const char* name) {
+    if (!name)
+        return nullptr;
+    const auto* strings = find_target_strings(name);
+    return strings ? strings->features.c_str() : nullptr;
+}
+
+const char* archspec_get_flags_static(const char* name, const char* compiler) {
+    if (!name || !compiler)
+        return nullptr;
+    const auto* strings = find_target_strings(name);
+    if (!strings)
         return nullptr;
-    return to_c_string(flags);
+    const auto* flags = find_flags(*strings, compiler);
+    return flags ? flags->c_str() : nullptr;
+}
+
+int archspec_host_features_into(char* buf, size_t len, size_t* needed) {
+    ensure_host_initialized();
+    return copy_into(&s_host_strings.features, buf, len, needed);
+}
+
+int archspec_host_flags_into(const char* compiler, char* buf, size_t len, size_t* needed) {
+    if (!compiler)
+        return copy_into(nullptr, buf, len, needed);
+    ensure_host_initialized();
+    return copy_into(find_flags(s_host_strings, compiler), buf, len, needed);
+}
+
+int archspec_get_features_into(const char* name, char* buf, size_t len, size_t* needed) {
+    if (!name)
+        return copy_into(nullptr, buf, len, needed);
+    const auto* strings = find_target_strings(name);
+    return copy_into(strings ? &strings->features : nullptr, buf, len, needed);
+}
+
+int archspec_get_flags_into(const char* name, const char* compiler, char* buf, size_t len,
+                            size_t* needed) {
+    if (!name || !compiler)
+        return copy_into(nullptr, buf, len, needed);
+    const auto* strings = find_target_strings(name);
+    return copy_into(strings ? find_flags(*strings, compiler) : nullptr, buf, len, needed);
 }
 
 int archspec_has_feature(const char* name, const char* feature) {
@@ -115,20 +288,18 @@ int archspec_has_feature(const char* name, const char* feature) {
 int archspec_host_has_feature(const char* feature) {
     if (!feature)
         return 0;
-    auto host_arch = archspec::host();
-    return host_arch.has_feature(feature) ? 1 : 0;
+    return archspec::host_cached().has_feature(feature) ? 1 : 0;
 }
 
 size_t archspec_target_count(void) {
-    ensure_initialized();
-    return s_target_names.size();
+    return ensure_initialized().names.size();
 }
 
 const char* archspec_target_name(size_t index) {
-    ensure_initialized();
-    if (index >= s_target_names.size())
+    const TargetStringTable& table = ensure_initialized();
+    if (index >= table.names.size())
         return nullptr;
-    return s_target_names[index].c_str();
+    return table.names[index].c_str();
 }
 
 int archspec_target_exists(const char* name) {
@@ -138,6 +309,116 @@ int archspec_target_exists(const char* name) {
     return db.exists(name) ? 1 : 0;
 }
 
+// Split a comma-separated list into views of list
+static std::vector<std::string_view> split_features(std::string_view list) {
+    std::vector<std::string_view> result;
+    while (!list.empty()) {
+        size_t end = list.find(',');
+        if (end != 0)
+            result.push_back(list.substr(0, end));
+        if (end == std::string_view::npos)
+            break;
+        list.remove_prefix(end + 1);
+    }
+    return result;
+}
+
+static char* join_targets(const std::vector<const archspec::Microarchitecture*>& targets) {
+    std::string result;
+    for (const auto* target : targets) {
+        if (!result.empty())
+            result += ",";
+        result += target->name();
+    }
+    return to_c_string(result);
+}
+
+char* archspec_targets_with(const char* features) {
+    if (!features)
+        return nullptr;
+    const auto& db = archspec::MicroarchitectureDatabase::instance();
+    return join_targets(db.targets_with(split_features(features)));
+}
+
+char* archspec_targets_without(const char* features) {
+    if (!features)
+        return nullptr;
+    const auto& db = archspec::MicroarchitectureDatabase::instance();
+    return join_targets(db.targets_without(split_features(features)));
+}
+
+char* archspec_minimal_target(const char* features, const char* family) {
+    if (!features)
+        return nullptr;
+    const auto& db = archspec::MicroarchitectureDatabase::instance();
+    const auto* target = db.minimal_target(split_features(features), family ? family : "");
+    return target ? to_c_string(target->name()) : nullptr;
+}
+
+char* archspec_feature_diff(const char* a, const char* b) {
+    if (!a || !b)
+        return nullptr;
+    const auto& db = archspec::MicroarchitectureDatabase::instance();
+    auto target_a = db.get(a);
+    auto target_b = db.get(b);
+    if (!target_a || !target_b)
+        return nullptr;
+    std::vector<std::string> diff = db.feature_diff(target_a->get(), target_b->get());
+    std::string result;
+    for (const auto& feature : diff) {
+        if (!result.empty())
+            result += ",";
+        result += feature;
+    }
+    return to_c_string(result);
+}
+
+static_assert(int(archspec::CacheType::Data) == ARCHSPEC_CACHE_DATA &&
+                  int(archspec::CacheType::Instruction) == ARCHSPEC_CACHE_INSTRUCTION &&
+                  int(archspec::CacheType::Unified) == ARCHSPEC_CACHE_UNIFIED,
+              "archspec_cache.type mirrors archspec::CacheType");
+
+int archspec_host_topology(archspec_topology* out) {
+    if (!out)
+        return 0;
+    const archspec::CpuTopology& topo = archspec::topology_cached();
+    memset(out, 0, sizeof(*out));
+    out->logical_cpus = topo.logical_cpus;
+    out->physical_cores = topo.physical_cores;
+    out->packages = topo.packages;
+    out->threads_per_core = topo.threads_per_core;
+    out->numa_nodes = static_cast<uint32_t>(topo.numa_nodes.size());
+    for (const auto& cache : topo.caches) {
+        if (out->cache_count == ARCHSPEC_MAX_CACHES)
+            break;
+        archspec_cache& c = out->caches[out->cache_count++];
+        c.level = cache.level;
+        c.type = static_cast<int>(cache.type);
+        c.size = cache.size;
+        c.line_size = cache.line_size;
+        c.ways = cache.ways;
+        c.sharing = cache.sharing;
+        c.instances = cache.instances;
+    }
+    return 1;
+}
+
+uint64_t archspec_host_cache_size(int level) {
+    return archspec::topology_cached().data_cache_size(level);
+}
+
+void archspec_get_stats(archspec_stats* out) {
+    if (!out)
+        return;
+    archspec::Stats s = archspec::stats();
+    out->enabled = s.enabled ? 1 : 0;
+    out->load_embedded_data = to_c_stat(s.load_embedded_data);
+    out->detect_cpu_info = to_c_stat(s.detect_cpu_info);
+    out->compatible_microarchitectures = to_c_stat(s.compatible_microarchitectures);
+    out->host = to_c_stat(s.host);
+    out->optimization_flags = to_c_stat(s.optimization_flags);
+}
+
 void archspec_free(char* str) {
     free(str);
 }
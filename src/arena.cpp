@@ -0,0 +1,46 @@
+// This file is a part of Julia. License is MIT: https://julialang.org/license
+
+#include "archspec/arena.hpp"
+
+#include <cstdint>
+#include <cstring>
+
+namespace archspec {
+
+void* Arena::allocate(size_t size, size_t align) {
+    size_t pad = (align - reinterpret_cast<uintptr_t>(cursor_) % align) % align;
+    if (!cursor_ || pad + size > remaining_) {
+        // Oversized requests get a block of their own so the current one keeps filling
+        if (size + align > kBlockSize) {
+            blocks_.emplace_back(new char[size + align]);
+            reserved_ += size + align;
+            char* start = blocks_.back().get();
+            used_ += size;
+            return start + (align - reinterpret_cast<uintptr_t>(start) % align) % align;
+        }
+        blocks_.emplace_back(new char[kBlockSize]);
+        reserved_ += kBlockSize;
+        cursor_ = blocks_.back().get();
+        remaining_ = kBlockSize;
+        pad = (align - reinterpret_cast<uintptr_t>(cursor_) % align) % align;
+    }
+    char* out = cursor_ + pad;
+    cursor_ += pad + size;
+    remaining_ -= pad + size;
+    used_ += size;
+    return out;
+}
+
+std::string_view Arena::intern(std::string_view str) {
+    if (str.empty())
+        return {};
+    if (auto it = strings_.find(str); it != strings_.end())
+        return *it;
+    char* out = static_cast<char*>(allocate(str.size(), 1));
+    std::memcpy(out, str.data(), str.size());
+    std::string_view stored(out, str.size());
+    strings_.insert(stored);
+    return stored;
+}
+
+} // namespace archspec
@@ -0,0 +1,533 @@
+// This file is a part of Julia. License is MIT: https://julialang.org/license
+//
+// Binary database format used by save_binary() and load_binary()
+//
+// All integers are little-endian. The file is an 80-byte header followed by sections, each
+// 8-byte aligned:
+//
+//   header   magic "ARCHSPDB", u32 version, u32 section count, then per section
+//            {u32 offset, u32 count} in the order of the Section enum below
+//   strings  raw bytes, referenced by StrRef {u32 offset, u32 length}
+//   names    StrRef[]: target parents and alias lists index into this
+//   features u32[] into names: the feature universe, bit i of a bitmap is features[i]
+//   targets  {StrRef name, vendor, cpupart; i32 generation; Range parents (names),
+//            Range compilers; u32 vector_width, fma_units, sve_vector_length, prefer_256
+//            (0 unset, 1 no, 2 yes); u32 reserved} (64 bytes); the declared tuning hints
+//   bitmaps  u64[targets * words], words = ceil(features / 64), one row per target
+//   compilers {StrRef compiler, versions, name, flags, warnings} (40 bytes)
+//   aliases  {StrRef name; Range any_of, families (names)} (24 bytes)
+//   conversions {u32 kind (0 darwin flags, 1 ARM vendor); StrRef key, value} (20 bytes)
+//
+// load_binary() maps the file and checks every offset against the mapping before it is used.
+// The database keeps the mapping of a file it took targets from: their name, vendor, part,
+// parent and feature views point into its string section rather than into the arena.
+
+#include "archspec/microarchitecture.hpp"
+#include "hash.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <vector>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace archspec {
+
+namespace {
+
+constexpr char kMagic[8] = {'A', 'R', 'C', 'H', 'S', 'P', 'D', 'B'};
+constexpr uint32_t kVersion = 2;
+
+enum Section : uint32_t {
+    Strings,
+    Names,
+    Features,
+    Targets,
+    Bitmaps,
+    Compilers,
+    Aliases,
+    Conversions,
+    SectionCount,
+};
+
+constexpr size_t kHeaderSize = 16 + SectionCount * 8;
+constexpr size_t kTargetSize = 64;
+constexpr size_t kCompilerSize = 40;
+constexpr size_t kAliasSize = 24;
+constexpr size_t kConversionSize = 20;
+
+// Writing
+
+void put_u32(std::string& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i)
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+}
+
+void put_u64(std::string& out, uint64_t value) {
+    for (int i = 0; i < 8; ++i)
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+}
+
+class Writer {
+  public:
+    // Strings are deduplicated; the returned pair is {offset, length} in the string section
+    void put_str(std::string& out, const std::string& str) {
+        auto [it, inserted] = string_offsets_.emplace(str, static_cast<uint32_t>(strings_.size()));
+        if (inserted)
+            strings_ += str;
+        put_u32(out, it->second);
+        put_u32(out, static_cast<uint32_t>(str.size()));
+    }
+
+    // Append names to the names section and write their Range
+    template <typename Container> void put_names(std::string& out, const Container& names) {
+        put_u32(out, name_count_);
+        put_u32(out, static_cast<uint32_t>(names.size()));
+        for (const auto& name : names) {
+            put_str(names_, name);
+            ++name_count_;
+        }
+    }
+
+    uint32_t add_name(const std::string& name) {
+        put_str(names_, name);
+        return name_count_++;
+    }
+
+    std::string strings_;
+    std::string names_;
+    uint32_t name_count_ = 0;
+
+  private:
+    std::unordered_map<std::string, uint32_t> string_offsets_;
+};
+
+// Reading
+
+uint32_t get_u32(const unsigned char* p) {
+    return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+}
+
+uint64_t get_u64(const unsigned char* p) {
+    return uint64_t(get_u32(p)) | uint64_t(get_u32(p + 4)) << 32;
+}
+
+// Read-only view of a whole file, memory-mapped where the platform allows it
+class MappedFile {
+  public:
+    explicit MappedFile(const std::string& path) {
+#if defined(_WIN32) || defined(_WIN64)
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file.is_open())
+            return;
+        std::streamoff size = file.tellg();
+        if (size <= 0)
+            return;
+        buffer_.resize(static_cast<size_t>(size));
+        file.seekg(0);
+        if (!file.read(reinterpret_cast<char*>(buffer_.data()), size))
+            return;
+        data_ = buffer_.data();
+        size_ = buffer_.size();
+#else
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return;
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* map = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED,
+                               fd, 0);
+            if (map != MAP_FAILED) {
+                data_ = static_cast<const unsigned char*>(map);
+                size_ = static_cast<size_t>(st.st_size);
+            }
+        }
+        ::close(fd);
+#endif
+    }
+
+    ~MappedFile() {
+#if !defined(_WIN32) && !defined(_WIN64)
+        if (data_)
+            ::munmap(const_cast<unsigned char*>(data_), size_);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const unsigned char* data() const {
+        return data_;
+    }
+    size_t size() const {
+        return size_;
+    }
+
+  private:
+    const unsigned char* data_ = nullptr;
+    size_t size_ = 0;
+#if defined(_WIN32) || defined(_WIN64)
+    std::vector<unsigned char> buffer_;
+#endif
+};
+
+// Bounds-checked decoder over a mapped image
+class Reader {
+  public:
+    Reader(const unsigned char* data, size_t size) : data_(data), size_(size) {}
+
+    bool parse_header() {
+        if (size_ < kHeaderSize || std::memcmp(data_, kMagic, sizeof(kMagic)) != 0)
+            return false;
+        if (get_u32(data_ + 8) != kVersion || get_u32(data_ + 12) != SectionCount)
+            return false;
+
+        static constexpr size_t kRecordSizes[SectionCount] = {
+            1, 8, 4, kTargetSize, 8, kCompilerSize, kAliasSize, kConversionSize};
+        for (uint32_t s = 0; s < SectionCount; ++s) {
+            offsets_[s] = get_u32(data_ + 16 + s * 8);
+            counts_[s] = get_u32(data_ + 20 + s * 8);
+            if (uint64_t(offsets_[s]) + uint64_t(counts_[s]) * kRecordSizes[s] > size_)
+                return false;
+        }
+        return true;
+    }
+
+    uint32_t count(Section s) const {
+        return counts_[s];
+    }
+
+    const unsigned char* record(Section s, size_t index, size_t record_size) const {
+        return data_ + offsets_[s] + index * record_size;
+    }
+
+    // String at p (a StrRef); ok is cleared if it is out of bounds
+    std::string_view str(const unsigned char* p, bool& ok) const {
+        uint32_t offset = get_u32(p);
+        uint32_t length = get_u32(p + 4);
+        if (uint64_t(offset) + length > counts_[Strings]) {
+            ok = false;
+            return {};
+        }
+        return std::string_view(reinterpret_cast<const char*>(data_ + offsets_[Strings] + offset),
+                                length);
+    }
+
+    std::string_view name(uint32_t index, bool& ok) const {
+        if (index >= counts_[Names]) {
+            ok = false;
+            return {};
+        }
+        return str(record(Names, index, 8), ok);
+    }
+
+    // Names in the Range at p
+    template <typename Container> void names(const unsigned char* p, Container& out, bool& ok) {
+        uint32_t begin = get_u32(p);
+        uint32_t count = get_u32(p + 4);
+        if (uint64_t(begin) + count > counts_[Names]) {
+            ok = false;
+            return;
+        }
+        for (uint32_t i = begin; i < begin + count; ++i)
+            out.insert(out.end(), typename Container::value_type(name(i, ok)));
+    }
+
+  private:
+    const unsigned char* data_;
+    size_t size_;
+    uint32_t offsets_[SectionCount] = {};
+    uint32_t counts_[SectionCount] = {};
+};
+
+} // anonymous namespace
+
+bool MicroarchitectureDatabase::save_binary(std::string_view path) const {
+    Writer w;
+
+    // Feature universe: every interned id, so bitmaps line up with feature_names_
+    std::string features;
+    for (const auto& name : feature_names_)
+        put_u32(features, w.add_name(name));
+    uint32_t feature_count = static_cast<uint32_t>(feature_names_.size());
+    size_t words = (feature_count + 63) / 64;
+
+    std::string targets, bitmaps, compilers;
+    uint32_t compiler_count = 0;
+    for (const auto& [name, target] : targets_) {
+        w.put_str(targets, target.name_);
+        w.put_str(targets, target.vendor_);
+        w.put_str(targets, target.cpu_part_);
+        put_u32(targets, static_cast<uint32_t>(target.generation_));
+        w.put_names(targets, target.parent_names_);
+
+        uint32_t first = compiler_count;
+        for (const auto& [compiler, entries] : target.compilers_) {
+            for (const auto& entry : entries) {
+                w.put_str(compilers, compiler);
+                w.put_str(compilers, entry.versions);
+                w.put_str(compilers, entry.name);
+                w.put_str(compilers, entry.flags);
+                w.put_str(compilers, entry.warnings);
+                ++compiler_count;
+            }
+        }
+        put_u32(targets, first);
+        put_u32(targets, compiler_count - first);
+        const TuningHints& tuning = target.tuning_;
+        put_u32(targets, tuning.vector_width);
+        put_u32(targets, tuning.fma_units);
+        put_u32(targets, tuning.sve_vector_length);
+        put_u32(targets, tuning.prefer_256 ? (*tuning.prefer_256 ? 2 : 1) : 0);
+        put_u32(targets, 0);
+
+        std::vector<uint64_t> row(words, 0);
+        for (std::string_view f : target.views_->features) {
+            FeatureId id = feature_ids_.at(f);
+            row[id / 64] |= uint64_t(1) << (id % 64);
+        }
+        for (uint64_t word : row)
+            put_u64(bitmaps, word);
+    }
+
+    std::string aliases;
+    uint32_t alias_count = 0;
+    std::set<std::string> alias_names;
+    for (const auto& [name, _] : feature_aliases_)
+        alias_names.insert(name);
+    for (const auto& [name, _] : family_features_)
+        alias_names.insert(name);
+    static const std::set<std::string> kNone;
+    for (const auto& name : alias_names) {
+        auto any_of = feature_aliases_.find(name);
+        auto families = family_features_.find(name);
+        w.put_str(aliases, name);
+        w.put_names(aliases, any_of != feature_aliases_.end() ? any_of->second : kNone);
+        w.put_names(aliases, families != family_features_.end() ? families->second : kNone);
+        ++alias_count;
+    }
+
+    std::string conversions;
+    uint32_t conversion_count = 0;
+    for (const auto* map : {&darwin_flags_, &arm_vendors_}) {
+        for (const auto& [key, value] : *map) {
+            put_u32(conversions, map == &darwin_flags_ ? 0 : 1);
+            w.put_str(conversions, key);
+            w.put_str(conversions, value);
+            ++conversion_count;
+        }
+    }
+
+    const std::string* bodies[SectionCount] = {&w.strings_, &w.names_,   &features,
+                                               &targets,    &bitmaps,    &compilers,
+                                               &aliases,    &conversions};
+    uint32_t counts[SectionCount] = {static_cast<uint32_t>(w.strings_.size()),
+                                     w.name_count_,
+                                     feature_count,
+                                     static_cast<uint32_t>(targets_.size()),
+                                     static_cast<uint32_t>(targets_.size() * words),
+                                     compiler_count,
+                                     alias_count,
+                                     conversion_count};
+
+    std::string image(kMagic, sizeof(kMagic));
+    put_u32(image, kVersion);
+    put_u32(image, SectionCount);
+    size_t offset = kHeaderSize;
+    for (uint32_t s = 0; s < SectionCount; ++s) {
+        offset = (offset + 7) & ~size_t(7);
+        put_u32(image, static_cast<uint32_t>(offset));
+        put_u32(image, counts[s]);
+        offset += bodies[s]->size();
+    }
+    for (uint32_t s = 0; s < SectionCount; ++s) {
+        image.resize((image.size() + 7) & ~size_t(7), '\0');
+        image += *bodies[s];
+    }
+
+    // Written beside path and renamed over it, so a database still mapping the old file keeps
+    // reading intact data
+    std::string target_path(path);
+    std::string temp_path = target_path + ".tmp";
+    {
+        std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+        if (!out.is_open())
+            return false;
+        out.write(image.data(), static_cast<std::streamsize>(image.size()));
+        if (!out.flush()) {
+            out.close();
+            std::remove(temp_path.c_str());
+            return false;
+        }
+    }
+    if (std::rename(temp_path.c_str(), target_path.c_str()) != 0) {
+        // Windows does not rename over an existing file
+        std::remove(target_path.c_str());
+        if (std::rename(temp_path.c_str(), target_path.c_str()) != 0) {
+            std::remove(temp_path.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+bool MicroarchitectureDatabase::load_binary(std::string_view path) {
+    auto mapping = std::make_shared<MappedFile>(std::string(path));
+    const MappedFile& file = *mapping;
+    if (!file.data())
+        return false;
+    Reader r(file.data(), file.size());
+    if (!r.parse_header())
+        return false;
+
+    bool ok = true;
+    uint32_t feature_count = r.count(Features);
+    size_t words = (feature_count + 63) / 64;
+    if (uint64_t(r.count(Targets)) * words != r.count(Bitmaps))
+        return false;
+
+    std::vector<std::string_view> features(feature_count);
+    for (uint32_t i = 0; i < feature_count; ++i)
+        features[i] = r.name(get_u32(r.record(Features, i, 4)), ok);
+    if (!ok)
+        return false;
+
+    // Decode everything first, so a corrupt file leaves the database untouched. Views are
+    // collected as they decode and only copied into the arena once the whole file checks out.
+    struct Decoded {
+        std::string name;
+        Microarchitecture target;
+        Microarchitecture::Views views;
+        std::vector<std::string_view> parents;
+        std::vector<std::string_view> features;
+    };
+    std::vector<Decoded> loaded;
+    loaded.reserve(r.count(Targets));
+    for (uint32_t t = 0; t < r.count(Targets); ++t) {
+        const unsigned char* rec = r.record(Targets, t, kTargetSize);
+        Microarchitecture::Views views;
+        views.name = r.str(rec, ok);
+        std::string name(views.name);
+        if (targets_.count(name))
+            continue;
+
+        std::vector<std::string> parents;
+        std::vector<std::string_view> parent_views;
+        r.names(rec + 28, parents, ok);
+        r.names(rec + 28, parent_views, ok);
+
+        std::vector<std::string_view> target_features;
+        const unsigned char* row = r.record(Bitmaps, size_t(t) * words, 8);
+        for (size_t w = 0; w < words; ++w) {
+            for (uint64_t bits = get_u64(row + w * 8); bits; bits &= bits - 1) {
+                size_t id = w * 64 + static_cast<size_t>(__builtin_ctzll(bits));
+                if (id >= feature_count) {
+                    ok = false;
+                    break;
+                }
+                target_features.push_back(features[id]);
+            }
+        }
+        std::sort(target_features.begin(), target_features.end());
+
+        std::map<std::string, std::vector<CompilerEntry>> compilers;
+        uint32_t first = get_u32(rec + 36);
+        uint32_t count = get_u32(rec + 40);
+        if (uint64_t(first) + count > r.count(Compilers))
+            return false;
+        for (uint32_t c = first; c < first + count; ++c) {
+            const unsigned char* entry = r.record(Compilers, c, kCompilerSize);
+            compilers[std::string(r.str(entry, ok))].push_back(
+                {std::string(r.str(entry + 8, ok)), std::string(r.str(entry + 16, ok)),
+                 std::string(r.str(entry + 24, ok)), std::string(r.str(entry + 32, ok))});
+        }
+
+        views.vendor = r.str(rec + 8, ok);
+        views.cpu_part = r.str(rec + 16, ok);
+        std::string vendor(views.vendor);
+        std::string cpu_part(views.cpu_part);
+        int generation = static_cast<int>(get_u32(rec + 24));
+        TuningHints tuning;
+        tuning.vector_width = get_u32(rec + 44);
+        tuning.fma_units = get_u32(rec + 48);
+        tuning.sve_vector_length = get_u32(rec + 52);
+        if (uint32_t prefer = get_u32(rec + 56); prefer != 0)
+            tuning.prefer_256 = prefer == 2;
+        if (!ok)
+            return false;
+        // Features live only in the views, so the target gets no set of its own
+        Microarchitecture target(name, std::move(parents), std::move(vendor), {},
+                                 std::move(compilers), generation, std::move(cpu_part),
+                                 std::move(tuning));
+        loaded.push_back({std::move(name), std::move(target), views, std::move(parent_views),
+                          std::move(target_features)});
+    }
+
+    std::map<std::string, std::set<std::string>> any_of, families;
+    for (uint32_t a = 0; a < r.count(Aliases); ++a) {
+        const unsigned char* rec = r.record(Aliases, a, kAliasSize);
+        std::string name(r.str(rec, ok));
+        std::set<std::string> list;
+        r.names(rec + 8, list, ok);
+        if (!list.empty())
+            any_of.emplace(name, std::move(list));
+        list.clear();
+        r.names(rec + 16, list, ok);
+        if (!list.empty())
+            families.emplace(name, std::move(list));
+    }
+
+    std::vector<std::pair<std::string, std::string>> darwin, vendors;
+    for (uint32_t c = 0; c < r.count(Conversions); ++c) {
+        const unsigned char* rec = r.record(Conversions, c, kConversionSize);
+        auto& list = get_u32(rec) == 0 ? darwin : vendors;
+        list.emplace_back(r.str(rec + 4, ok), r.str(rec + 12, ok));
+    }
+    if (!ok)
+        return false;
+
+    // Same precedence as load_from_string(): entries already present are overwritten only for
+    // aliases and conversions, targets loaded earlier win
+    std::vector<std::string> added;
+    for (auto& decoded : loaded) {
+        added.push_back(decoded.name);
+        Microarchitecture& target =
+            targets_.emplace(std::move(decoded.name), std::move(decoded.target)).first->second;
+        decoded.views.parents = arena_.copy(decoded.parents);
+        decoded.views.features = arena_.copy(decoded.features);
+        *target.views_ = decoded.views;
+        target.views_.publish();
+        target.features_ = {};
+    }
+    if (!loaded.empty())
+        mappings_.push_back(std::move(mapping));
+    for (auto& [name, list] : any_of)
+        feature_aliases_[name] = std::move(list);
+    for (auto& [name, list] : families)
+        family_features_[name] = std::move(list);
+    for (auto& [key, value] : darwin)
+        darwin_flags_[key] = std::move(value);
+    for (auto& [key, value] : vendors)
+        arm_vendors_[key] = std::move(value);
+
+    content_hash_ = hash_bytes(
+        std::string_view(reinterpret_cast<const char*>(file.data()), file.size()), content_hash_);
+
+    if (loaded_)
+        refresh(added);
+    else
+        finalize();
+    loaded_ = true;
+    return true;
+}
+
+} // namespace archspec
@@ -2,6 +2,174 @@
 
 #include "archspec/cpuid.hpp"
 
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+namespace archspec {
+
+namespace {
+
+enum class Reg : uint8_t { Eax, Ebx, Ecx, Edx };
+
+// One decodable feature bit, named with the Linux /proc/cpuinfo spelling that
+// microarchitectures.json uses
+struct FeatureBit {
+    uint32_t leaf;
+    uint32_t subleaf;
+    Reg reg;
+    uint8_t bit;
+    const char* name;
+};
+
+// clang-format off
+constexpr FeatureBit kFeatureBits[] = {
+    // EAX=1: Basic feature flags
+    {1, 0, Reg::Edx, 0, "fpu"},
+    {1, 0, Reg::Edx, 23, "mmx"},
+    {1, 0, Reg::Edx, 25, "sse"},
+    {1, 0, Reg::Edx, 26, "sse2"},
+    {1, 0, Reg::Edx, 28, "ht"},
+    {1, 0, Reg::Ecx, 0, "pni"}, // SSE3
+    {1, 0, Reg::Ecx, 1, "pclmulqdq"},
+    {1, 0, Reg::Ecx, 9, "ssse3"},
+    {1, 0, Reg::Ecx, 12, "fma"},
+    {1, 0, Reg::Ecx, 13, "cx16"},
+    {1, 0, Reg::Ecx, 19, "sse4_1"},
+    {1, 0, Reg::Ecx, 20, "sse4_2"},
+    {1, 0, Reg::Ecx, 22, "movbe"},
+    {1, 0, Reg::Ecx, 23, "popcnt"},
+    {1, 0, Reg::Ecx, 25, "aes"},
+    {1, 0, Reg::Ecx, 26, "xsave"},
+    {1, 0, Reg::Ecx, 28, "avx"},
+    {1, 0, Reg::Ecx, 29, "f16c"},
+    {1, 0, Reg::Ecx, 30, "rdrand"},
+    {1, 0, Reg::Ecx, 31, "hypervisor"},
+
+    // EAX=7, ECX=0: Extended features
+    {7, 0, Reg::Ebx, 0, "fsgsbase"},
+    {7, 0, Reg::Ebx, 1, "tsc_adjust"},
+    {7, 0, Reg::Ebx, 3, "bmi1"},
+    {7, 0, Reg::Ebx, 5, "avx2"},
+    {7, 0, Reg::Ebx, 8, "bmi2"},
+    {7, 0, Reg::Ebx, 16, "avx512f"},
+    {7, 0, Reg::Ebx, 17, "avx512dq"},
+    {7, 0, Reg::Ebx, 18, "rdseed"},
+    {7, 0, Reg::Ebx, 19, "adx"},
+    {7, 0, Reg::Ebx, 21, "avx512ifma"},
+    {7, 0, Reg::Ebx, 23, "clflushopt"},
+    {7, 0, Reg::Ebx, 24, "clwb"},
+    {7, 0, Reg::Ebx, 26, "avx512pf"},
+    {7, 0, Reg::Ebx, 27, "avx512er"},
+    {7, 0, Reg::Ebx, 28, "avx512cd"},
+    {7, 0, Reg::Ebx, 29, "sha_ni"},
+    {7, 0, Reg::Ebx, 30, "avx512bw"},
+    {7, 0, Reg::Ebx, 31, "avx512vl"},
+    {7, 0, Reg::Ecx, 1, "avx512vbmi"},
+    {7, 0, Reg::Ecx, 3, "pku"},
+    {7, 0, Reg::Ecx, 5, "waitpkg"},
+    {7, 0, Reg::Ecx, 6, "avx512_vbmi2"},
+    {7, 0, Reg::Ecx, 8, "gfni"},
+    {7, 0, Reg::Ecx, 9, "vaes"},
+    {7, 0, Reg::Ecx, 10, "vpclmulqdq"},
+    {7, 0, Reg::Ecx, 11, "avx512_vnni"},
+    {7, 0, Reg::Ecx, 12, "avx512_bitalg"},
+    {7, 0, Reg::Ecx, 14, "avx512_vpopcntdq"},
+    {7, 0, Reg::Ecx, 22, "rdpid"},
+    {7, 0, Reg::Ecx, 25, "cldemote"},
+    {7, 0, Reg::Ecx, 27, "movdiri"},
+    {7, 0, Reg::Ecx, 28, "movdir64b"},
+    {7, 0, Reg::Edx, 8, "avx512_vp2intersect"},
+    {7, 0, Reg::Edx, 14, "serialize"},
+    {7, 0, Reg::Edx, 22, "amx_bf16"},
+    {7, 0, Reg::Edx, 24, "amx_tile"},
+    {7, 0, Reg::Edx, 25, "amx_int8"},
+    {7, 0, Reg::Edx, 28, "flush_l1d"},
+
+    // EAX=7, ECX=1: More extended features
+    {7, 1, Reg::Eax, 4, "avx_vnni"},
+    {7, 1, Reg::Eax, 5, "avx512_bf16"},
+
+    // EAX=0xD, ECX=1: XSAVE features
+    {0xD, 1, Reg::Eax, 0, "xsaveopt"},
+    {0xD, 1, Reg::Eax, 1, "xsavec"},
+
+    // Extended features (0x80000001)
+    {0x80000001, 0, Reg::Ecx, 0, "lahf_lm"},
+    {0x80000001, 0, Reg::Ecx, 5, "abm"}, // lzcnt, popcnt
+    {0x80000001, 0, Reg::Ecx, 6, "sse4a"},
+    {0x80000001, 0, Reg::Ecx, 11, "xop"},
+    {0x80000001, 0, Reg::Ecx, 16, "fma4"},
+    {0x80000001, 0, Reg::Ecx, 21, "tbm"},
+    {0x80000001, 0, Reg::Edx, 30, "3dnowext"},
+    {0x80000001, 0, Reg::Edx, 31, "3dnow"},
+
+    // AMD extended feature identifiers
+    {0x80000008, 0, Reg::Ebx, 0, "clzero"},
+    {0x80000021, 0, Reg::Eax, 8, "autoibrs"},
+};
+// clang-format on
+
+// Names added by detect_features() from other bits rather than read directly
+constexpr const char* kDerivedFeatures[] = {"sse3", "ibrs_enhanced"};
+
+// XCR0 state components each feature group needs
+constexpr uint64_t kXcr0Ymm = 0x6;      // SSE and AVX (upper YMM halves)
+constexpr uint64_t kXcr0Zmm = 0xe0;     // Opmask, upper ZMM0-15 halves and ZMM16-31
+constexpr uint64_t kXcr0Tile = 0x60000; // XTILECFG and XTILEDATA
+
+// VEX-encoded features whose names do not start with "avx"
+constexpr const char* kYmmFeatures[] = {"f16c", "fma", "fma4", "vaes", "vpclmulqdq", "xop"};
+constexpr const char* kXsaveFeatures[] = {"xsave", "xsavec", "xsaveopt"};
+
+bool starts_with(const std::string& name, const char* prefix) {
+    return name.compare(0, std::strlen(prefix), prefix) == 0;
+}
+
+} // anonymous namespace
+
+const std::set<std::string>& Cpuid::known_features() {
+    static const std::set<std::string> names = [] {
+        std::set<std::string> result;
+        for (const auto& entry : kFeatureBits)
+            result.insert(entry.name);
+        for (const char* name : kDerivedFeatures)
+            result.insert(name);
+        return result;
+    }();
+    return names;
+}
+
+std::set<std::string> Cpuid::os_disabled(const std::set<std::string>& features,
+                                         const OsXsaveState& state) {
+    uint64_t xcr0 = state.osxsave ? state.xcr0 : 0;
+    bool ymm = (xcr0 & kXcr0Ymm) == kXcr0Ymm;
+    bool zmm = ymm && (xcr0 & kXcr0Zmm) == kXcr0Zmm;
+    bool tiles = state.amx_permitted && (xcr0 & kXcr0Tile) == kXcr0Tile;
+
+    std::set<std::string> disabled;
+    for (const auto& name : features) {
+        bool allowed = true;
+        if (starts_with(name, "amx"))
+            allowed = tiles;
+        else if (starts_with(name, "avx512"))
+            allowed = zmm;
+        else if (starts_with(name, "avx"))
+            allowed = ymm;
+        else if (std::find(std::begin(kYmmFeatures), std::end(kYmmFeatures), name) !=
+                 std::end(kYmmFeatures))
+            allowed = ymm;
+        else if (std::find(std::begin(kXsaveFeatures), std::end(kXsaveFeatures), name) !=
+                 std::end(kXsaveFeatures))
+            allowed = state.osxsave;
+        if (!allowed)
+            disabled.insert(name);
+    }
+    return disabled;
+}
+
+} // namespace archspec
+
 #if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
 #define ARCHSPEC_X86 1
 #endif
@@ -9,15 +177,41 @@
 #ifdef ARCHSPEC_X86
 
 #if defined(_MSC_VER)
+#include <immintrin.h>
 #include <intrin.h>
 #elif defined(__GNUC__) || defined(__clang__)
 #include <cpuid.h>
 #endif
 
-#include <cstring>
+#if defined(__linux__) && defined(__x86_64__)
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 namespace archspec {
 
+namespace {
+
+// Only valid when CPUID reports OSXSAVE; XGETBV raises #UD otherwise
+uint64_t read_xcr0() {
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    uint32_t eax = 0;
+    uint32_t edx = 0;
+    // XGETBV, spelled out for assemblers that predate the mnemonic
+    __asm__ volatile(".byte 0x0f, 0x01, 0xd0" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+}
+
+#if defined(__linux__) && defined(__x86_64__)
+constexpr int kArchReqXcompPerm = 0x1023; // ARCH_REQ_XCOMP_PERM from asm/prctl.h
+constexpr int kXfeatureXtiledata = 18;
+#endif
+
+} // anonymous namespace
+
 bool Cpuid::is_supported() {
 #ifdef ARCHSPEC_X86
     return true;
@@ -26,7 +220,7 @@ bool Cpuid::is_supported() {
 #endif
 }
 
-CpuidRegisters Cpuid::query(uint32_t eax_in, uint32_t ecx_in) const {
+CpuidRegisters Cpuid::query(uint32_t eax_in, uint32_t ecx_in) {
     CpuidRegisters regs;
 
 #if defined(_MSC_VER)
@@ -43,6 +237,36 @@ CpuidRegisters Cpuid::query(uint32_t eax_in, uint32_t ecx_in) const {
     return regs;
 }
 
+const OsXsaveState& Cpuid::host_os_state() {
+    static const OsXsaveState state = [] {
+        OsXsaveState result;
+        result.osxsave = (query(1, 0).ecx & (1u << 27)) != 0;
+        if (result.osxsave)
+            result.xcr0 = read_xcr0();
+
+#if defined(__APPLE__)
+        // macOS enables AVX-512 state lazily, on a thread's first AVX-512 instruction, so
+        // XCR0 lacks it until then
+        bool avx512f = query(0, 0).eax >= 7 && (query(7, 0).ebx & (1u << 16)) != 0;
+        if (avx512f && (result.xcr0 & kXcr0Ymm) == kXcr0Ymm)
+            result.xcr0 |= kXcr0Zmm;
+#endif
+
+#if defined(__linux__) && defined(__x86_64__)
+        // Kernels before 5.16 never set the tile bits in XCR0, so only newer ones are asked
+        result.amx_permitted =
+            (result.xcr0 & kXcr0Tile) == kXcr0Tile &&
+            syscall(SYS_arch_prctl, kArchReqXcompPerm, kXfeatureXtiledata) == 0;
+#elif defined(__linux__)
+        result.amx_permitted = false; // 32-bit processes cannot use AMX
+#else
+        result.amx_permitted = true;
+#endif
+        return result;
+    }();
+    return state;
+}
+
 Cpuid::Cpuid() {
     // Get vendor string and highest basic function
     CpuidRegisters regs = query(0, 0);
@@ -59,8 +283,12 @@ Cpuid::Cpuid() {
     regs = query(0x80000000, 0);
     highest_extended_ = regs.eax;
 
-    // Detect features
+    // Detect features, then drop those the OS has not enabled
     detect_features();
+    raw_features_ = features_;
+    os_state_ = host_os_state();
+    for (const auto& name : os_disabled(raw_features_, os_state_))
+        features_.erase(name);
 }
 
 bool Cpuid::is_bit_set(uint32_t reg, int bit) const {
@@ -68,180 +296,48 @@ bool Cpuid::is_bit_set(uint32_t reg, int bit) const {
 }
 
 void Cpuid::detect_features() {
-    // EAX=1: Basic feature flags
-    if (highest_basic_ >= 1) {
-        CpuidRegisters regs = query(1, 0);
-
-        // EDX features
-        if (is_bit_set(regs.edx, 0))
-            features_.insert("fpu");
-        if (is_bit_set(regs.edx, 23))
-            features_.insert("mmx");
-        if (is_bit_set(regs.edx, 25))
-            features_.insert("sse");
-        if (is_bit_set(regs.edx, 26))
-            features_.insert("sse2");
-        if (is_bit_set(regs.edx, 28))
-            features_.insert("ht");
-
-        // ECX features
-        if (is_bit_set(regs.ecx, 0))
-            features_.insert("pni"); // SSE3
-        if (is_bit_set(regs.ecx, 1))
-            features_.insert("pclmulqdq");
-        if (is_bit_set(regs.ecx, 9))
-            features_.insert("ssse3");
-        if (is_bit_set(regs.ecx, 12))
-            features_.insert("fma");
-        if (is_bit_set(regs.ecx, 13))
-            features_.insert("cx16");
-        if (is_bit_set(regs.ecx, 19))
-            features_.insert("sse4_1");
-        if (is_bit_set(regs.ecx, 20))
-            features_.insert("sse4_2");
-        if (is_bit_set(regs.ecx, 22))
-            features_.insert("movbe");
-        if (is_bit_set(regs.ecx, 23))
-            features_.insert("popcnt");
-        if (is_bit_set(regs.ecx, 25))
-            features_.insert("aes");
-        if (is_bit_set(regs.ecx, 26))
-            features_.insert("xsave");
-        if (is_bit_set(regs.ecx, 28))
-            features_.insert("avx");
-        if (is_bit_set(regs.ecx, 29))
-            features_.insert("f16c");
-        if (is_bit_set(regs.ecx, 30))
-            features_.insert("rdrand");
-    }
-
-    // EAX=7, ECX=0: Extended features
-    if (highest_basic_ >= 7) {
-        CpuidRegisters regs = query(7, 0);
-
-        // EBX features
-        if (is_bit_set(regs.ebx, 0))
-            features_.insert("fsgsbase");
-        if (is_bit_set(regs.ebx, 3))
-            features_.insert("bmi1");
-        if (is_bit_set(regs.ebx, 5))
-            features_.insert("avx2");
-        if (is_bit_set(regs.ebx, 8))
-            features_.insert("bmi2");
-        if (is_bit_set(regs.ebx, 16))
-            features_.insert("avx512f");
-        if (is_bit_set(regs.ebx, 17))
-            features_.insert("avx512dq");
-        if (is_bit_set(regs.ebx, 18))
-            features_.insert("rdseed");
-        if (is_bit_set(regs.ebx, 19))
-            features_.insert("adx");
-        if (is_bit_set(regs.ebx, 21))
-            features_.insert("avx512ifma");
-        if (is_bit_set(regs.ebx, 23))
-            features_.insert("clflushopt");
-        if (is_bit_set(regs.ebx, 24))
-            features_.insert("clwb");
-        if (is_bit_set(regs.ebx, 26))
-            features_.insert("avx512pf");
-        if (is_bit_set(regs.ebx, 27))
-            features_.insert("avx512er");
-        if (is_bit_set(regs.ebx, 28))
-            features_.insert("avx512cd");
-        if (is_bit_set(regs.ebx, 29))
-            features_.insert("sha_ni");
-        if (is_bit_set(regs.ebx, 30))
-            features_.insert("avx512bw");
-        if (is_bit_set(regs.ebx, 31))
-            features_.insert("avx512vl");
-
-        // ECX features
-        if (is_bit_set(regs.ecx, 1))
-            features_.insert("avx512vbmi");
-        if (is_bit_set(regs.ecx, 3))
-            features_.insert("pku");
-        if (is_bit_set(regs.ecx, 5))
-            features_.insert("waitpkg");
-        if (is_bit_set(regs.ecx, 6))
-            features_.insert("avx512_vbmi2");
-        if (is_bit_set(regs.ecx, 8))
-            features_.insert("gfni");
-        if (is_bit_set(regs.ecx, 9))
-            features_.insert("vaes");
-        if (is_bit_set(regs.ecx, 10))
-            features_.insert("vpclmulqdq");
-        if (is_bit_set(regs.ecx, 11))
-            features_.insert("avx512_vnni");
-        if (is_bit_set(regs.ecx, 12))
-            features_.insert("avx512_bitalg");
-        if (is_bit_set(regs.ecx, 14))
-            features_.insert("avx512_vpopcntdq");
-        if (is_bit_set(regs.ecx, 22))
-            features_.insert("rdpid");
-        if (is_bit_set(regs.ecx, 25))
-            features_.insert("cldemote");
-        if (is_bit_set(regs.ecx, 27))
-            features_.insert("movdiri");
-        if (is_bit_set(regs.ecx, 28))
-            features_.insert("movdir64b");
-
-        // EDX features
-        if (is_bit_set(regs.edx, 8))
-            features_.insert("avx512_vp2intersect");
-        if (is_bit_set(regs.edx, 14))
-            features_.insert("serialize");
-        if (is_bit_set(regs.edx, 22))
-            features_.insert("amx_bf16");
-        if (is_bit_set(regs.edx, 24))
-            features_.insert("amx_tile");
-        if (is_bit_set(regs.edx, 25))
-            features_.insert("amx_int8");
-    }
-
-    // EAX=7, ECX=1: More extended features
-    if (highest_basic_ >= 7) {
-        CpuidRegisters regs = query(7, 1);
-
-        if (is_bit_set(regs.eax, 4))
-            features_.insert("avx_vnni");
-        if (is_bit_set(regs.eax, 5))
-            features_.insert("avx512_bf16");
+    // Entries are grouped by (leaf, subleaf), so each leaf is queried once
+    CpuidRegisters regs;
+    bool have_leaf = false;
+    for (size_t i = 0; i < std::size(kFeatureBits); ++i) {
+        const FeatureBit& entry = kFeatureBits[i];
+        if (i == 0 || entry.leaf != kFeatureBits[i - 1].leaf ||
+            entry.subleaf != kFeatureBits[i - 1].subleaf) {
+            uint32_t highest = entry.leaf >= 0x80000000 ? highest_extended_ : highest_basic_;
+            have_leaf = entry.leaf <= highest;
+            if (have_leaf)
+                regs = query(entry.leaf, entry.subleaf);
+        }
+        if (!have_leaf)
+            continue;
+
+        uint32_t value = 0;
+        switch (entry.reg) {
+        case Reg::Eax:
+            value = regs.eax;
+            break;
+        case Reg::Ebx:
+            value = regs.ebx;
+            break;
+        case Reg::Ecx:
+            value = regs.ecx;
+            break;
+        case Reg::Edx:
+            value = regs.edx;
+            break;
+        }
+        if (is_bit_set(value, entry.bit))
+            features_.insert(entry.name);
     }
 
-    // EAX=0xD, ECX=1: XSAVE features
-    if (highest_basic_ >= 0xD) {
-        CpuidRegisters regs = query(0xD, 1);
-
-        if (is_bit_set(regs.eax, 0))
-            features_.insert("xsaveopt");
-        if (is_bit_set(regs.eax, 1))
-            features_.insert("xsavec");
-    }
+    // ssse3 implies sse3, matching what detect_from_proc_cpuinfo() adds on top of "pni"
+    if (features_.count("ssse3"))
+        features_.insert("sse3");
 
-    // Extended features (0x80000001)
-    if (highest_extended_ >= 0x80000001) {
-        CpuidRegisters regs = query(0x80000001, 0);
-
-        // ECX features
-        if (is_bit_set(regs.ecx, 0))
-            features_.insert("lahf_lm");
-        if (is_bit_set(regs.ecx, 5))
-            features_.insert("abm"); // lzcnt, popcnt
-        if (is_bit_set(regs.ecx, 6))
-            features_.insert("sse4a");
-        if (is_bit_set(regs.ecx, 11))
-            features_.insert("xop");
-        if (is_bit_set(regs.ecx, 16))
-            features_.insert("fma4");
-        if (is_bit_set(regs.ecx, 21))
-            features_.insert("tbm");
-
-        // EDX features
-        if (is_bit_set(regs.edx, 30))
-            features_.insert("3dnowext");
-        if (is_bit_set(regs.edx, 31))
-            features_.insert("3dnow");
-    }
+    // AMD's Automatic IBRS is what Linux reports as ibrs_enhanced. The kernel additionally
+    // drops it on SEV-SNP hosts, which is not visible from user space.
+    if (features_.count("autoibrs"))
+        features_.insert("ibrs_enhanced");
 }
 
 std::string Cpuid::brand_string() const {
@@ -281,7 +377,12 @@ bool Cpuid::is_supported() {
 
 Cpuid::Cpuid() {}
 
-CpuidRegisters Cpuid::query(uint32_t, uint32_t) const {
+const OsXsaveState& Cpuid::host_os_state() {
+    static const OsXsaveState state;
+    return state;
+}
+
+CpuidRegisters Cpuid::query(uint32_t, uint32_t) {
     return CpuidRegisters{};
 }
 
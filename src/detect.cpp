@@ -2,12 +2,19 @@
 
 #include "archspec/detect.hpp"
 #include "archspec/cpuid.hpp"
+#include "archspec/host_cache.hpp"
+#include "archspec/hwcap.hpp"
+#include "trace.hpp"
 
 #include <algorithm>
-#include <fstream>
+#include <atomic>
+#include <charconv>
+#include <memory>
+#include <mutex>
 #include <sstream>
+#include <thread>
+#include <unordered_map>
 #include <cstring>
-#include <regex>
 
 // Platform-specific includes
 #if defined(__APPLE__)
@@ -20,6 +27,18 @@
 #include <sys/utsname.h>
 #endif
 
+#if defined(__linux__)
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && defined(__aarch64__)
+#include <cstdlib>
+#include <sys/auxv.h>
+#include <sys/prctl.h>
+#endif
+
 #if defined(_WIN32) || defined(_WIN64)
 #include <windows.h>
 // PROCESSOR_ARCHITECTURE_ARM64 may not be defined in older SDKs/MinGW
@@ -104,114 +123,181 @@ std::string get_machine() {
 #endif
 }
 
-#if defined(__linux__)
-// Helper to trim string (Linux only)
-static std::string trim(const std::string& s) {
+namespace {
+
+std::string_view trim(std::string_view s) {
     size_t start = s.find_first_not_of(" \t\r\n");
+    if (start == std::string_view::npos)
+        return {};
     size_t end = s.find_last_not_of(" \t\r\n");
-    if (start == std::string::npos)
-        return "";
     return s.substr(start, end - start + 1);
 }
 
-DetectedCpuInfo detect_from_proc_cpuinfo() {
-    DetectedCpuInfo info;
+// Insert every whitespace-separated token of s
+void insert_tokens(std::string_view s, std::set<std::string>& out) {
+    size_t pos = 0;
+    while (pos < s.size()) {
+        size_t start = s.find_first_not_of(" \t", pos);
+        if (start == std::string_view::npos)
+            break;
+        size_t end = s.find_first_of(" \t", start);
+        if (end == std::string_view::npos)
+            end = s.size();
+        out.emplace(s.substr(start, end - start));
+        pos = end;
+    }
+}
 
-    std::ifstream cpuinfo("/proc/cpuinfo");
-    if (!cpuinfo.is_open()) {
-        return info;
+// Generation number following the first "POWER" in s, e.g. 9 for "POWER9 (architected)"
+int parse_power_generation(std::string_view s) {
+    size_t pos = s.find("POWER");
+    if (pos == std::string_view::npos)
+        return 0;
+    int generation = 0;
+    bool any = false;
+    for (pos += 5; pos < s.size() && s[pos] >= '0' && s[pos] <= '9'; ++pos) {
+        generation = generation * 10 + (s[pos] - '0');
+        any = true;
     }
+    return any ? generation : 0;
+}
+
+// Vendor name for an ARM "CPU implementer" code, or the code itself when unknown
+std::string arm_vendor(std::string_view implementer) {
+    const auto& vendors = MicroarchitectureDatabase::instance().arm_vendors();
+    auto it = vendors.find(std::string(implementer));
+    return it != vendors.end() ? it->second : std::string(implementer);
+}
+
+// Parse the processor block starting at pos into info and advance pos past it. processor
+// receives the block's "processor" number, or -1 when it has none. Returns false when no
+// block was left; info then holds the defaults for an empty block.
+bool parse_cpuinfo_block(std::string_view content, size_t& pos, std::string_view arch,
+                         DetectedCpuInfo& info, int& processor) {
+    bool x86 = arch == ARCH_X86_64 || arch == "i686" || arch == "i386";
+    bool aarch64 = arch == ARCH_AARCH64;
+    bool ppc = arch == ARCH_PPC64LE || arch == ARCH_PPC64;
+    bool riscv = arch == ARCH_RISCV64;
+
+    // Values point into content; only the keys the architecture needs are kept
+    std::string_view vendor_id, flags, implementer, part, cpu, uarch;
+    bool have_vendor_id = false, have_implementer = false, have_uarch = false;
+    bool in_block = false;
+    processor = -1;
+
+    while (pos < content.size()) {
+        size_t eol = content.find('\n', pos);
+        if (eol == std::string_view::npos)
+            eol = content.size();
+        std::string_view line = content.substr(pos, eol - pos);
+        pos = eol + 1;
 
-    std::map<std::string, std::string> data;
-    std::string line;
-    while (std::getline(cpuinfo, line)) {
         size_t colon = line.find(':');
-        if (colon == std::string::npos) {
+        if (colon == std::string_view::npos) {
             // Empty line - we've read one CPU's info
-            if (!data.empty())
+            if (in_block)
                 break;
             continue;
         }
-
-        std::string key = trim(line.substr(0, colon));
-        std::string value = trim(line.substr(colon + 1));
-        data[key] = value;
-    }
-
-    std::string arch = get_machine();
-
-    if (arch == ARCH_X86_64 || arch == "i686" || arch == "i386") {
-        info.vendor = data.count("vendor_id") ? data["vendor_id"] : "generic";
-
-        // Parse flags
-        if (data.count("flags")) {
-            for (const auto& flag : split(data["flags"], ' ')) {
-                if (!flag.empty()) {
-                    info.features.insert(flag);
-                }
+        in_block = true;
+
+        std::string_view key = trim(line.substr(0, colon));
+        std::string_view value = trim(line.substr(colon + 1));
+        if (key == "processor") {
+            // Older AArch64 kernels also print a textual "Processor" line; only numbers count
+            int number = 0;
+            const char* end = value.data() + value.size();
+            auto result = std::from_chars(value.data(), end, number);
+            if (result.ec == std::errc() && result.ptr == end)
+                processor = number;
+        } else if (x86) {
+            if (key == "vendor_id") {
+                vendor_id = value;
+                have_vendor_id = true;
+            } else if (key == "flags") {
+                flags = value;
+            }
+        } else if (aarch64) {
+            if (key == "Features") {
+                flags = value;
+            } else if (key == "CPU implementer") {
+                implementer = value;
+                have_implementer = true;
+            } else if (key == "CPU part") {
+                part = value;
+            }
+        } else if (ppc) {
+            if (key == "cpu")
+                cpu = value;
+        } else if (riscv) {
+            if (key == "uarch") {
+                uarch = value;
+                have_uarch = true;
             }
         }
+    }
+
+    if (x86) {
+        info.vendor = have_vendor_id ? std::string(vendor_id) : "generic";
+        insert_tokens(flags, info.features);
 
         // ssse3 implies sse3; on Linux sse3 is reported as "pni" in /proc/cpuinfo,
         // so add sse3 when ssse3 is present (matching archspec Python behavior)
         if (info.features.count("ssse3")) {
             info.features.insert("sse3");
         }
-    } else if (arch == ARCH_AARCH64) {
+    } else if (aarch64) {
         // Get vendor from CPU implementer
-        if (data.count("CPU implementer")) {
-            const auto& db = MicroarchitectureDatabase::instance();
-            const auto& vendors = db.arm_vendors();
-            auto it = vendors.find(data["CPU implementer"]);
-            if (it != vendors.end()) {
-                info.vendor = it->second;
-            } else {
-                info.vendor = data["CPU implementer"];
-            }
-        } else {
-            info.vendor = "generic";
-        }
-
-        // Parse features
-        if (data.count("Features")) {
-            for (const auto& flag : split(data["Features"], ' ')) {
-                if (!flag.empty()) {
-                    info.features.insert(flag);
-                }
-            }
-        }
-
-        // CPU part
-        info.cpu_part = data.count("CPU part") ? data["CPU part"] : "";
-    } else if (arch == ARCH_PPC64LE || arch == ARCH_PPC64) {
-        // Parse POWER generation
-        if (data.count("cpu")) {
-            std::regex power_re("POWER(\\d+)");
-            std::smatch match;
-            std::string cpu_str = data["cpu"];
-            if (std::regex_search(cpu_str, match, power_re)) {
-                std::string gen_str = match[1].str();
-                char* end = nullptr;
-                long val = std::strtol(gen_str.c_str(), &end, 10);
-                if (end != gen_str.c_str()) {
-                    info.generation = static_cast<int>(val);
-                }
-            }
-        }
-    } else if (arch == ARCH_RISCV64) {
-        if (data.count("uarch")) {
-            std::string uarch = data["uarch"];
-            if (uarch == "sifive,u74-mc") {
-                uarch = "u74mc";
-            }
-            info.name = uarch;
+        info.vendor = have_implementer ? arm_vendor(implementer) : "generic";
+        insert_tokens(flags, info.features);
+        info.cpu_part = std::string(part);
+    } else if (ppc) {
+        info.generation = parse_power_generation(cpu);
+    } else if (riscv) {
+        if (have_uarch) {
+            info.name = uarch == "sifive,u74-mc" ? "u74mc" : std::string(uarch);
         } else {
             info.name = ARCH_RISCV64;
         }
     }
 
+    return in_block;
+}
+
+} // anonymous namespace
+
+DetectedCpuInfo parse_cpuinfo(std::string_view content, std::string_view arch) {
+    DetectedCpuInfo info;
+    size_t pos = 0;
+    int processor = -1;
+    parse_cpuinfo_block(content, pos, arch, info, processor);
     return info;
 }
+
+#if defined(__linux__)
+DetectedCpuInfo detect_from_proc_cpuinfo() {
+    // Only the first processor block is parsed, which comfortably fits in this buffer
+    char buffer[16384];
+    size_t size = 0;
+
+    int fd = ::open("/proc/cpuinfo", O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return DetectedCpuInfo{};
+    while (size < sizeof(buffer)) {
+        ssize_t n = ::read(fd, buffer + size, sizeof(buffer) - size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        size += static_cast<size_t>(n);
+        // procfs hands out whole records, so stop once the first block has ended
+        if (std::string_view(buffer, size).find("\n\n") != std::string_view::npos)
+            break;
+    }
+    ::close(fd);
+
+    return parse_cpuinfo(std::string_view(buffer, size), get_machine());
+}
 #endif
 
 #if defined(__FreeBSD__)
@@ -225,6 +311,9 @@ DetectedCpuInfo detect_from_proc_cpuinfo() {
             Cpuid cpuid;
             info.vendor = cpuid.vendor();
             info.features = cpuid.features();
+            for (const auto& name : cpuid.raw_features())
+                if (!info.features.count(name))
+                    info.disabled_features.insert(name);
         }
     } else if (arch == ARCH_AARCH64) {
         // Try to get features from hw.optional sysctls
@@ -317,41 +406,109 @@ DetectedCpuInfo detect_from_sysctl() {
 }
 #endif
 
-#if defined(_WIN32) || defined(_WIN64)
 DetectedCpuInfo detect_from_cpuid() {
     DetectedCpuInfo info;
     std::string arch = get_machine();
 
-    if (arch == ARCH_X86_64) {
+    if (arch == ARCH_X86_64 || arch == "i686" || arch == "i386") {
         if (Cpuid::is_supported()) {
             Cpuid cpuid;
             info.vendor = cpuid.vendor();
             info.features = cpuid.features();
+            for (const auto& name : cpuid.raw_features())
+                if (!info.features.count(name))
+                    info.disabled_features.insert(name);
         }
     }
     // TODO: Add ARM64 Windows support if needed
 
     return info;
 }
+
+DetectedCpuInfo detect_from_hwcaps() {
+    DetectedCpuInfo info;
+#if defined(__linux__) && defined(__aarch64__)
+    uint64_t caps = getauxval(AT_HWCAP);
+    uint64_t caps2 = 0;
+#ifdef AT_HWCAP2
+    caps2 = getauxval(AT_HWCAP2);
 #endif
+    if (caps == 0)
+        return info;
 
-DetectedCpuInfo detect_cpu_info() {
+    char buffer[64];
+    int fd = ::open("/sys/devices/system/cpu/cpu0/regs/identification/midr_el1",
+                    O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return info;
+    ssize_t n = ::read(fd, buffer, sizeof(buffer) - 1);
+    ::close(fd);
+    if (n <= 0)
+        return info;
+    buffer[n] = '\0';
+    uint64_t midr = std::strtoull(buffer, nullptr, 16);
+
+    info.vendor = arm_vendor(hwcap::midr_implementer(midr));
+    info.cpu_part = hwcap::midr_part(midr);
+    info.features = hwcap::decode(caps, caps2);
+#endif
+    return info;
+}
+
+namespace {
+
+// The kernel's feature list covers what it supports, which on Linux includes AMX before the
+// process has been granted tile data; drop what this process cannot use
+void mask_os_disabled(DetectedCpuInfo& info) {
+    if (!Cpuid::is_supported() || info.vendor.empty())
+        return;
+    for (const auto& name : Cpuid::os_disabled(info.features, Cpuid::host_os_state())) {
+        info.features.erase(name);
+        info.disabled_features.insert(name);
+    }
+}
+
+DetectedCpuInfo detect_from_operating_system() {
 #if defined(__linux__) || defined(__FreeBSD__)
-    return detect_from_proc_cpuinfo();
+    DetectedCpuInfo info = detect_from_proc_cpuinfo();
+    mask_os_disabled(info);
+    return info;
 #elif defined(__APPLE__)
-    return detect_from_sysctl();
-#elif defined(_WIN32) || defined(_WIN64)
+    DetectedCpuInfo info = detect_from_sysctl();
+    mask_os_disabled(info);
+    return info;
+#else
+    // Windows and unknown platforms only have CPUID, which is already masked
     return detect_from_cpuid();
+#endif
+}
+
+} // anonymous namespace
+
+DetectedCpuInfo detect_cpu_info(DetectionMethod method) {
+    ARCHSPEC_TRACE_SCOPE(DetectCpuInfo);
+    if (method == DetectionMethod::Auto) {
+#if defined(ARCHSPEC_CPUID_DETECTION)
+        method = DetectionMethod::Cpuid;
+#elif defined(__linux__) && defined(__aarch64__)
+        // AT_HWCAP holds the same bits the kernel prints on the cpuinfo Features line
+        method = DetectionMethod::Hwcap;
 #else
-    // Fallback - try CPUID for x86
-    DetectedCpuInfo info;
-    if (Cpuid::is_supported()) {
-        Cpuid cpuid;
-        info.vendor = cpuid.vendor();
-        info.features = cpuid.features();
-    }
-    return info;
+        method = DetectionMethod::OperatingSystem;
 #endif
+    }
+
+    if (method == DetectionMethod::Cpuid || method == DetectionMethod::Hwcap) {
+        DetectedCpuInfo info =
+            method == DetectionMethod::Cpuid ? detect_from_cpuid() : detect_from_hwcaps();
+        if (!info.vendor.empty())
+            return info;
+    }
+    return detect_from_operating_system();
+}
+
+DetectedCpuInfo detect_cpu_info() {
+    return detect_cpu_info(DetectionMethod::Auto);
 }
 
 std::optional<std::string> brand_string() {
@@ -376,16 +533,18 @@ std::optional<std::string> brand_string() {
 #endif
 }
 
+FeatureMask DetectedCpuInfo::feature_mask() const {
+    return MicroarchitectureDatabase::instance().feature_mask(features);
+}
+
+FeatureMask DetectedCpuInfo::feature_mask(const MicroarchitectureDatabase& db) const {
+    return db.feature_mask(features);
+}
+
 namespace compatibility {
 
 static bool is_in_family(const Microarchitecture& target, std::string_view family_name) {
-    if (target.name() == family_name)
-        return true;
-    for (const auto& ancestor : target.ancestors()) {
-        if (ancestor == family_name)
-            return true;
-    }
-    return false;
+    return target.has_ancestor(family_name);
 }
 
 static bool vendor_matches(const Microarchitecture& target, const std::string& info_vendor) {
@@ -393,7 +552,15 @@ static bool vendor_matches(const Microarchitecture& target, const std::string& i
 }
 
 static bool has_required_features(const Microarchitecture& target,
-                                  const std::set<std::string>& available_features) {
+                                  const std::set<std::string>& available_features,
+                                  const FeatureMask& available_mask) {
+    // Ids are per database, so a snapshot's target needs the features interned against it
+    if (const auto* db = target.database(); db && db->masks_exact()) {
+        if (db == &MicroarchitectureDatabase::instance())
+            return target.feature_mask().is_subset_of(available_mask);
+        return target.feature_mask().is_subset_of(db->feature_mask(available_features));
+    }
+
     for (const auto& feature : target.features()) {
         if (available_features.count(feature) == 0)
             return false;
@@ -401,12 +568,18 @@ static bool has_required_features(const Microarchitecture& target,
     return true;
 }
 
-bool check_x86_64(const DetectedCpuInfo& info, const Microarchitecture& target) {
+bool check_x86_64(const DetectedCpuInfo& info, const FeatureMask& features,
+                  const Microarchitecture& target) {
     return is_in_family(target, ARCH_X86_64) && vendor_matches(target, info.vendor) &&
-           has_required_features(target, info.features);
+           has_required_features(target, info.features, features);
 }
 
-bool check_aarch64(const DetectedCpuInfo& info, const Microarchitecture& target) {
+bool check_x86_64(const DetectedCpuInfo& info, const Microarchitecture& target) {
+    return check_x86_64(info, info.feature_mask(), target);
+}
+
+bool check_aarch64(const DetectedCpuInfo& info, [[maybe_unused]] const FeatureMask& features,
+                   const Microarchitecture& target) {
     if (target.vendor() == "generic" && target.name() != ARCH_AARCH64)
         return false;
     if (!is_in_family(target, ARCH_AARCH64))
@@ -416,23 +589,22 @@ bool check_aarch64(const DetectedCpuInfo& info, const Microarchitecture& target)
 
 #if defined(__APPLE__)
     if (!info.name.empty()) {
-        auto model = MicroarchitectureDatabase::instance().get(info.name);
-        if (model) {
-            if (target.name() == info.name)
-                return true;
-            for (const auto& ancestor : model->get().ancestors()) {
-                if (ancestor == target.name())
-                    return true;
-            }
-        }
+        const auto* db = target.database();
+        auto model = (db ? *db : MicroarchitectureDatabase::instance()).get(info.name);
+        if (model && model->get().has_ancestor(target.name()))
+            return true;
     }
 #else
-    if (!has_required_features(target, info.features))
+    if (!has_required_features(target, info.features, features))
         return false;
 #endif
     return true;
 }
 
+bool check_aarch64(const DetectedCpuInfo& info, const Microarchitecture& target) {
+    return check_aarch64(info, info.feature_mask(), target);
+}
+
 bool check_ppc64(const DetectedCpuInfo& info, const Microarchitecture& target) {
     std::string arch = get_machine();
     return is_in_family(target, arch) && target.generation() <= info.generation;
@@ -445,49 +617,102 @@ bool check_riscv64(const DetectedCpuInfo& info, const Microarchitecture& target)
 
 } // namespace compatibility
 
-std::vector<const Microarchitecture*> compatible_microarchitectures(const DetectedCpuInfo& info,
-                                                                    std::string_view arch) {
-    std::vector<const Microarchitecture*> result;
-    const auto& db = MicroarchitectureDatabase::instance();
+namespace {
 
-    std::function<bool(const DetectedCpuInfo&, const Microarchitecture&)> checker;
+// Every checker takes the interned feature mask, computed once for the whole scan
+using Checker = bool (*)(const DetectedCpuInfo&, const FeatureMask&, const Microarchitecture&);
+
+// Checker for an architecture, or nullptr when the architecture has no compatibility rules
+Checker checker_for(std::string_view arch) {
     if (arch == ARCH_X86_64 || arch == "i686" || arch == "i386")
-        checker = compatibility::check_x86_64;
-    else if (arch == ARCH_AARCH64)
-        checker = compatibility::check_aarch64;
-    else if (arch == ARCH_PPC64 || arch == ARCH_PPC64LE)
-        checker = compatibility::check_ppc64;
-    else if (arch == ARCH_RISCV64)
-        checker = compatibility::check_riscv64;
-    else {
-        if (auto generic = db.get(arch))
-            result.push_back(&generic->get());
-        return result;
+        return compatibility::check_x86_64;
+    if (arch == ARCH_AARCH64)
+        return compatibility::check_aarch64;
+    if (arch == ARCH_PPC64 || arch == ARCH_PPC64LE)
+        return [](const DetectedCpuInfo& i, const FeatureMask&, const Microarchitecture& t) {
+            return compatibility::check_ppc64(i, t);
+        };
+    if (arch == ARCH_RISCV64)
+        return [](const DetectedCpuInfo& i, const FeatureMask&, const Microarchitecture& t) {
+            return compatibility::check_riscv64(i, t);
+        };
+    return nullptr;
+}
+
+// Scan the database's columnar table, testing features with the vector subset kernel.
+// Returns false when the table cannot answer for arch: masks that are not exact, or checks
+// that need more than the table holds (RISC-V names, Apple model ancestry).
+bool scan_table(const DetectedCpuInfo& info, std::string_view arch,
+                std::vector<const Microarchitecture*>& result) {
+    const auto& db = MicroarchitectureDatabase::instance();
+    const TargetTable& table = db.target_table();
+
+    // check_ppc64: same family as the running machine, generation no newer than the CPU's
+    if (arch == ARCH_PPC64 || arch == ARCH_PPC64LE) {
+        int family = table.family_id(get_machine());
+        for (size_t i = 0; i < table.size(); ++i) {
+            if (table.families[i] == family && table.generations[i] <= info.generation)
+                result.push_back(table.targets[i]);
+        }
+        return true;
     }
 
-    for (const auto& [name, target] : db.all()) {
-        if (checker(info, target))
-            result.push_back(&target);
+    bool x86 = arch == ARCH_X86_64 || arch == "i686" || arch == "i386";
+#if defined(__APPLE__)
+    bool arm = false;
+#else
+    bool arm = arch == ARCH_AARCH64;
+#endif
+    if (!db.masks_exact() || (!x86 && !arm))
+        return false;
+
+    int family = table.family_id(x86 ? ARCH_X86_64 : ARCH_AARCH64);
+    if (family < 0)
+        return true;
+    int generic = table.vendor_id("generic");
+    int vendor = table.vendor_id(info.vendor);
+
+    thread_local std::vector<uint8_t> subset;
+    subset.resize(table.size());
+    subset_scan(table.masks.data(), table.size(), info.feature_mask(), subset.data());
+
+    for (size_t i = 0; i < table.size(); ++i) {
+        if (!subset[i] || table.families[i] != family)
+            continue;
+        if (table.vendors[i] == generic) {
+            // check_aarch64: only the family root among the generic AArch64 targets
+            if (arm && table.targets[i]->name() != ARCH_AARCH64)
+                continue;
+        } else if (table.vendors[i] != vendor) {
+            continue;
+        }
+        result.push_back(table.targets[i]);
     }
+    return true;
+}
 
+// Append the compatible targets in all() order, or the generic target for arch if none is
+void collect_compatible(const DetectedCpuInfo& info, std::string_view arch, Checker checker,
+                        std::vector<const Microarchitecture*>& result) {
+    const auto& db = MicroarchitectureDatabase::instance();
+    if (!scan_table(info, arch, result)) {
+        FeatureMask features = info.feature_mask();
+        for (const auto& [name, target] : db.all()) {
+            if (checker(info, features, target))
+                result.push_back(&target);
+        }
+    }
     if (result.empty()) {
         if (auto generic = db.get(arch))
             result.push_back(&generic->get());
     }
-
-    return result;
-}
-
-std::vector<const Microarchitecture*> compatible_microarchitectures(const DetectedCpuInfo& info) {
-    return compatible_microarchitectures(info, get_machine());
 }
 
-Microarchitecture host() {
-    DetectedCpuInfo info = detect_cpu_info();
-    auto candidates = compatible_microarchitectures(info);
-
+// Pick the most specific target out of the compatible candidates
+const Microarchitecture* select_best(std::vector<const Microarchitecture*> candidates,
+                                     const DetectedCpuInfo& info) {
     if (candidates.empty())
-        return generic_microarchitecture(get_machine());
+        return nullptr;
 
     std::vector<const Microarchitecture*> generic_candidates;
     for (const auto* c : candidates) {
@@ -511,20 +736,328 @@ Microarchitecture host() {
             candidates = cpu_part_matches;
     }
 
+    // Like archspec, only vendor targets that descend from the best generic one qualify, so a
+    // virtual CPU missing a niche feature still gets a reasonably performant target
     if (best_generic) {
         std::vector<const Microarchitecture*> filtered;
         for (const auto* c : candidates) {
             if (*c > *best_generic)
                 filtered.push_back(c);
         }
-        if (!filtered.empty())
-            candidates = filtered;
+        candidates = filtered;
     }
 
     if (candidates.empty())
-        return best_generic ? *best_generic : generic_microarchitecture(get_machine());
+        return best_generic;
+
+    return *std::max_element(candidates.begin(), candidates.end(), compare_microarch_specificity);
+}
+
+bool same_cpu(const DetectedCpuInfo& a, const DetectedCpuInfo& b) {
+    return a.name == b.name && a.vendor == b.vendor && a.generation == b.generation &&
+           a.cpu_part == b.cpu_part && a.features == b.features;
+}
+
+// Bucket key for deduplication; same_cpu() settles collisions, so only the cheap parts of the
+// feature set (its size and its first and last names) are hashed
+size_t hash_cpu(const DetectedCpuInfo& info) {
+    std::hash<std::string> hash;
+    size_t h = hash(info.name);
+    auto mix = [&h](size_t v) { h ^= v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2); };
+    mix(hash(info.vendor));
+    mix(hash(info.cpu_part));
+    mix(static_cast<size_t>(info.generation));
+    mix(info.features.size());
+    if (!info.features.empty()) {
+        mix(hash(*info.features.begin()));
+        mix(hash(*info.features.rbegin()));
+    }
+    return h;
+}
+
+} // anonymous namespace
+
+std::vector<const Microarchitecture*> compatible_microarchitectures(const DetectedCpuInfo& info,
+                                                                    std::string_view arch) {
+    ARCHSPEC_TRACE_SCOPE(CompatibleMicroarchitectures);
+    std::vector<const Microarchitecture*> result;
+    const auto& db = MicroarchitectureDatabase::instance();
+
+    Checker checker = checker_for(arch);
+    if (!checker) {
+        if (auto generic = db.get(arch))
+            result.push_back(&generic->get());
+        return result;
+    }
+
+    collect_compatible(info, arch, checker, result);
+    return result;
+}
+
+std::vector<const Microarchitecture*> compatible_microarchitectures(const DetectedCpuInfo& info) {
+    return compatible_microarchitectures(info, get_machine());
+}
+
+const Microarchitecture* best_match(const DetectedCpuInfo& info, std::string_view arch) {
+    return select_best(compatible_microarchitectures(info, arch), info);
+}
+
+std::vector<const Microarchitecture*> resolve_batch(const DetectedCpuInfo* infos, size_t count,
+                                                    std::string_view arch, unsigned threads) {
+    std::vector<const Microarchitecture*> result(count, nullptr);
+    const auto& db = MicroarchitectureDatabase::instance();
+
+    Checker checker = checker_for(arch);
+    if (!checker) {
+        auto generic = db.get(arch);
+        std::fill(result.begin(), result.end(), generic ? &generic->get() : nullptr);
+        return result;
+    }
+
+    // Each worker takes a contiguous slice and resolves every distinct record in it once;
+    // comparing feature sets costs about as much as resolving them, so dedup is split too
+    auto work = [&](size_t begin, size_t end) {
+        std::unordered_map<size_t, std::vector<size_t>> seen; // hash -> first record
+        std::vector<const Microarchitecture*> candidates;
+        for (size_t i = begin; i < end; ++i) {
+            const DetectedCpuInfo& info = infos[i];
+            auto& bucket = seen[hash_cpu(info)];
+            auto same = std::find_if(bucket.begin(), bucket.end(),
+                                     [&](size_t j) { return same_cpu(infos[j], info); });
+            if (same != bucket.end()) {
+                result[i] = result[*same];
+                continue;
+            }
+            bucket.push_back(i);
+            candidates.clear();
+            collect_compatible(info, arch, checker, candidates);
+            result[i] = select_best(candidates, info);
+        }
+    };
+
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(threads, count)));
+    size_t slice = (count + threads - 1) / threads;
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t)
+        pool.emplace_back(work, std::min(count, t * slice), std::min(count, (t + 1) * slice));
+    work(0, std::min(count, slice));
+    for (auto& t : pool)
+        t.join();
+    return result;
+}
+
+std::vector<const Microarchitecture*> resolve_batch(const std::vector<DetectedCpuInfo>& infos,
+                                                    std::string_view arch, unsigned threads) {
+    return resolve_batch(infos.data(), infos.size(), arch, threads);
+}
+
+namespace {
+
+// Pick the most specific compatible target for already-detected CPU information
+Microarchitecture resolve_target(const DetectedCpuInfo& info, std::string_view arch) {
+    const Microarchitecture* best = best_match(info, arch);
+    return best ? *best : generic_microarchitecture(std::string(arch));
+}
+
+Microarchitecture resolve_host(const DetectedCpuInfo& info) {
+    return resolve_target(info, get_machine());
+}
+
+// Detection result shared by host_cached() and host_cpu_info_cached()
+struct HostSnapshot {
+    DetectedCpuInfo info;
+    Microarchitecture target;
+};
+
+// Detect and resolve the host, first trying the on-disk cache if use_disk_cache is set. Fresh
+// results are written back to the cache (see host_cache.hpp).
+HostSnapshot detect_host(bool use_disk_cache) {
+#if defined(ARCHSPEC_HOST_CACHE)
+    if (use_disk_cache) {
+        if (auto entry = load_host_cache()) {
+            if (auto target = MicroarchitectureDatabase::instance().get(entry->target))
+                return {std::move(entry->info), target->get()};
+        }
+    }
+    HostSnapshot result{detect_cpu_info(), {}};
+    result.target = resolve_host(result.info);
+    store_host_cache(make_host_cache_entry(result.info, result.target));
+    return result;
+#else
+    (void)use_disk_cache;
+    HostSnapshot result{detect_cpu_info(), {}};
+    result.target = resolve_host(result.info);
+    return result;
+#endif
+}
+
+std::once_flag g_host_once;
+std::atomic<const HostSnapshot*> g_host{nullptr};
+
+// Every snapshot ever published is kept so references handed out earlier stay valid
+std::mutex g_host_mutex;
+std::vector<std::unique_ptr<HostSnapshot>> g_host_snapshots;
+
+void publish_host_snapshot(bool use_disk_cache) {
+    auto snapshot = std::make_unique<HostSnapshot>(detect_host(use_disk_cache));
+
+    std::lock_guard<std::mutex> lock(g_host_mutex);
+    g_host.store(snapshot.get(), std::memory_order_release);
+    g_host_snapshots.push_back(std::move(snapshot));
+}
+
+const HostSnapshot& host_snapshot() {
+    std::call_once(g_host_once, publish_host_snapshot, true);
+    return *g_host.load(std::memory_order_acquire);
+}
+
+} // anonymous namespace
+
+Microarchitecture host() {
+    ARCHSPEC_TRACE_SCOPE(Host);
+    return detect_host(true).target;
+}
+
+const Microarchitecture& host_cached() {
+    return host_snapshot().target;
+}
+
+const DetectedCpuInfo& host_cpu_info_cached() {
+    return host_snapshot().info;
+}
+
+void refresh_host() {
+    // Publish first so host_cached() never observes a completed once_flag without a snapshot
+    publish_host_snapshot(false);
+    std::call_once(g_host_once, [] {});
+}
+
+uint32_t sve_vector_length() {
+#if defined(__linux__) && defined(__aarch64__)
+    // AT_HWCAP bit 22 is "sve"; without it RDVL would raise SIGILL
+    if (!(getauxval(AT_HWCAP) & (uint64_t(1) << 22)))
+        return 0;
+#if defined(PR_SVE_GET_VL)
+    int vl = prctl(PR_SVE_GET_VL, 0, 0, 0, 0);
+    if (vl >= 0)
+        return static_cast<uint32_t>(vl & PR_SVE_VL_LEN_MASK) * 8;
+#endif
+    // RDVL X0, #1, encoded directly so assemblers without SVE support accept it
+    uint64_t bytes = 0;
+    __asm__ volatile(".inst 0x04bf5020\n\tmov %0, x0" : "=r"(bytes) : : "x0");
+    return static_cast<uint32_t>(bytes * 8);
+#else
+    return 0;
+#endif
+}
+
+TuningHints host_tuning() {
+    TuningHints hints = host_cached().tuning();
+    // SVE implementations may run with a shorter length than the hardware maximum
+    if (uint32_t vl = sve_vector_length())
+        hints.sve_vector_length = vl;
+    return hints;
+}
+
+std::vector<CpuCluster> parse_cpu_clusters(std::string_view content, std::string_view arch) {
+    std::vector<CpuCluster> clusters;
+    size_t pos = 0;
+    for (int index = 0;; ++index) {
+        DetectedCpuInfo info;
+        int processor = -1;
+        if (!parse_cpuinfo_block(content, pos, arch, info, processor))
+            break;
+        if (processor < 0)
+            processor = index;
+
+        auto it = std::find_if(clusters.begin(), clusters.end(),
+                               [&](const CpuCluster& c) { return same_cpu(c.info, info); });
+        if (it != clusters.end()) {
+            it->cpus.push_back(processor);
+        } else {
+            CpuCluster cluster;
+            cluster.cpus.push_back(processor);
+            cluster.info = std::move(info);
+            clusters.push_back(std::move(cluster));
+        }
+    }
+
+    for (auto& cluster : clusters)
+        cluster.target = resolve_target(cluster.info, arch);
+    return clusters;
+}
+
+std::vector<CpuCluster> detect_cpu_clusters() {
+    std::string arch = get_machine();
+
+#if defined(__linux__)
+    // Unlike detect_from_proc_cpuinfo(), every processor block is needed here
+    std::string content;
+    int fd = ::open("/proc/cpuinfo", O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        char buffer[16384];
+        for (;;) {
+            ssize_t n = ::read(fd, buffer, sizeof(buffer));
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                break;
+            content.append(buffer, static_cast<size_t>(n));
+        }
+        ::close(fd);
+    }
+
+    auto clusters = parse_cpu_clusters(content, arch);
+    for (auto& cluster : clusters) {
+        size_t count = cluster.info.features.size();
+        mask_os_disabled(cluster.info);
+        if (cluster.info.features.size() != count)
+            cluster.target = resolve_target(cluster.info, arch);
+    }
+    if (!clusters.empty())
+        return clusters;
+#endif
+
+    // No per-CPU information: report every logical CPU as one cluster
+    CpuCluster cluster;
+    unsigned count = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned i = 0; i < count; ++i)
+        cluster.cpus.push_back(static_cast<int>(i));
+    cluster.info = detect_cpu_info();
+    cluster.target = resolve_target(cluster.info, arch);
+    return {std::move(cluster)};
+}
+
+Microarchitecture common_microarchitecture(const std::vector<CpuCluster>& clusters,
+                                           std::string_view arch) {
+    if (clusters.empty())
+        return generic_microarchitecture(std::string(arch));
+
+    // Keep only what every cluster agrees on; a mixed vendor leaves just generic targets
+    DetectedCpuInfo common = clusters.front().info;
+    for (const auto& cluster : clusters) {
+        const DetectedCpuInfo& info = cluster.info;
+        if (info.vendor != common.vendor)
+            common.vendor = "generic";
+        if (info.name != common.name)
+            common.name.clear();
+        if (info.cpu_part != common.cpu_part)
+            common.cpu_part.clear();
+        common.generation = std::min(common.generation, info.generation);
+        for (auto it = common.features.begin(); it != common.features.end();) {
+            if (info.features.count(*it))
+                ++it;
+            else
+                it = common.features.erase(it);
+        }
+    }
+    return resolve_target(common, arch);
+}
 
-    return **std::max_element(candidates.begin(), candidates.end(), compare_microarch_specificity);
+Microarchitecture common_microarchitecture(const std::vector<CpuCluster>& clusters) {
+    return common_microarchitecture(clusters, get_machine());
 }
 
 } // namespace archspec
@@ -0,0 +1,98 @@
+// This file is a part of Julia. License is MIT: https://julialang.org/license
+
+#include "archspec/feature_mask.hpp"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define ARCHSPEC_SCAN_AVX2 1
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define ARCHSPEC_SCAN_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace archspec {
+
+void subset_scan_scalar(const FeatureMask* masks, size_t count, const FeatureMask& available,
+                        uint8_t* out) {
+    for (size_t i = 0; i < count; ++i)
+        out[i] = masks[i].is_subset_of(available) ? 1 : 0;
+}
+
+namespace {
+
+using ScanKernel = void (*)(const FeatureMask*, size_t, const FeatureMask&, uint8_t*);
+
+#if defined(ARCHSPEC_SCAN_AVX2)
+
+// One 256-bit mask per register; vptest's carry flag is set when (~available & mask) == 0
+__attribute__((target("avx2"))) void subset_scan_avx2(const FeatureMask* masks, size_t count,
+                                                      const FeatureMask& available,
+                                                      uint8_t* out) {
+    const __m256i have = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&available));
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m256i* row = reinterpret_cast<const __m256i*>(masks + i);
+        out[i] = static_cast<uint8_t>(_mm256_testc_si256(have, _mm256_loadu_si256(row)));
+        out[i + 1] = static_cast<uint8_t>(_mm256_testc_si256(have, _mm256_loadu_si256(row + 1)));
+        out[i + 2] = static_cast<uint8_t>(_mm256_testc_si256(have, _mm256_loadu_si256(row + 2)));
+        out[i + 3] = static_cast<uint8_t>(_mm256_testc_si256(have, _mm256_loadu_si256(row + 3)));
+    }
+    for (; i < count; ++i) {
+        const __m256i* row = reinterpret_cast<const __m256i*>(masks + i);
+        out[i] = static_cast<uint8_t>(_mm256_testc_si256(have, _mm256_loadu_si256(row)));
+    }
+}
+
+#elif defined(ARCHSPEC_SCAN_NEON)
+
+// Two 128-bit halves per mask; a row passes when neither half has bits outside available
+void subset_scan_neon(const FeatureMask* masks, size_t count, const FeatureMask& available,
+                      uint8_t* out) {
+    const uint64_t* have = available.words().data();
+    const uint64x2_t have_lo = vld1q_u64(have);
+    const uint64x2_t have_hi = vld1q_u64(have + 2);
+    for (size_t i = 0; i < count; ++i) {
+        const uint64_t* row = masks[i].words().data();
+        uint64x2_t missing = vorrq_u64(vbicq_u64(vld1q_u64(row), have_lo),
+                                       vbicq_u64(vld1q_u64(row + 2), have_hi));
+        out[i] = (vgetq_lane_u64(missing, 0) | vgetq_lane_u64(missing, 1)) == 0 ? 1 : 0;
+    }
+}
+
+#endif
+
+struct Dispatch {
+    ScanKernel kernel = subset_scan_scalar;
+    const char* name = "scalar";
+
+    Dispatch() {
+#if defined(ARCHSPEC_SCAN_AVX2)
+        // libgcc and compiler-rt also check that the OS saves the YMM registers
+        if (__builtin_cpu_supports("avx2")) {
+            kernel = subset_scan_avx2;
+            name = "avx2";
+        }
+#elif defined(ARCHSPEC_SCAN_NEON)
+        kernel = subset_scan_neon;
+        name = "neon";
+#endif
+    }
+};
+
+const Dispatch& dispatch() {
+    static const Dispatch instance;
+    return instance;
+}
+
+} // anonymous namespace
+
+void subset_scan(const FeatureMask* masks, size_t count, const FeatureMask& available,
+                 uint8_t* out) {
+    dispatch().kernel(masks, count, available, out);
+}
+
+const char* subset_scan_kernel() {
+    return dispatch().name;
+}
+
+} // namespace archspec
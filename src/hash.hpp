@@ -0,0 +1,39 @@
+// This file is a part of Julia. License is MIT: https://julialang.org/license
+//
+// Internal content hash for cache keys. Stable across processes on the same machine; not
+// meant to resist deliberate collisions.
+
+#ifndef ARCHSPEC_HASH_HPP
+#define ARCHSPEC_HASH_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace archspec {
+
+constexpr uint64_t kHashSeed = 0x9e3779b97f4a7c15ull;
+
+// Fold data into seed eight bytes at a time, so different lengths never collide trivially
+inline uint64_t hash_bytes(std::string_view data, uint64_t seed = kHashSeed) {
+    auto mix = [](uint64_t h, uint64_t word) {
+        h ^= word;
+        h *= 0xff51afd7ed558ccdull;
+        return h ^ (h >> 32);
+    };
+
+    uint64_t h = mix(seed, data.size());
+    size_t i = 0;
+    for (; i + 8 <= data.size(); i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data.data() + i, 8);
+        h = mix(h, word);
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail, data.data() + i, data.size() - i);
+    return mix(h, tail);
+}
+
+} // namespace archspec
+
+#endif // ARCHSPEC_HASH_HPP
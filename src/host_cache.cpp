@@ -0,0 +1,367 @@
+// This file is a part of Julia. License is MIT: https://julialang.org/license
+
+#include "archspec/host_cache.hpp"
+#include "archspec/cpuid.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <set>
+
+#if !defined(_WIN32) && !defined(_WIN64)
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define ARCHSPEC_HOST_CACHE_POSIX 1
+#endif
+
+#if defined(__APPLE__)
+#include <sys/types.h>
+#include <sys/sysctl.h>
+#endif
+
+#if defined(__linux__) && defined(__aarch64__)
+#include <sys/auxv.h>
+#endif
+
+namespace archspec {
+
+namespace {
+
+// First line of every cache file; bump the number when the format or detection changes
+constexpr std::string_view kMagic = "archspec-host-cache 1";
+
+#if defined(ARCHSPEC_HOST_CACHE_POSIX)
+std::string read_small_file(const char* path) {
+    char buffer[256];
+    size_t size = 0;
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return {};
+    while (size < sizeof(buffer)) {
+        ssize_t n = ::read(fd, buffer + size, sizeof(buffer) - size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        size += static_cast<size_t>(n);
+    }
+    ::close(fd);
+    while (size > 0 && (buffer[size - 1] == '\n' || buffer[size - 1] == ' '))
+        --size;
+    return std::string(buffer, size);
+}
+#endif
+
+std::string boot_id() {
+#if defined(__linux__)
+    return read_small_file("/proc/sys/kernel/random/boot_id");
+#elif defined(__APPLE__)
+    char uuid[64] = {0};
+    size_t size = sizeof(uuid);
+    if (sysctlbyname("kern.bootsessionuuid", uuid, &size, nullptr, 0) != 0)
+        return {};
+    return uuid;
+#else
+    return {};
+#endif
+}
+
+void append_hex(std::string& out, uint64_t value) {
+    char buffer[20];
+    std::snprintf(buffer, sizeof(buffer), "%llx", static_cast<unsigned long long>(value));
+    out += buffer;
+    out += '.';
+}
+
+// What distinguishes this CPU, and the state the OS exposes of it, from any other
+std::string cpu_signature() {
+    std::string signature = get_machine() + ":";
+    if (Cpuid::is_supported()) {
+        // Leaf 1 EBX holds the APIC ID of the calling CPU, so it is left out
+        CpuidRegisters regs = Cpuid::query(0);
+        uint32_t highest = regs.eax;
+        for (uint32_t value : {regs.eax, regs.ebx, regs.ecx, regs.edx})
+            append_hex(signature, value);
+        regs = Cpuid::query(1);
+        for (uint32_t value : {regs.eax, regs.ecx, regs.edx})
+            append_hex(signature, value);
+        if (highest >= 7) {
+            regs = Cpuid::query(7);
+            for (uint32_t value : {regs.ebx, regs.ecx, regs.edx})
+                append_hex(signature, value);
+        }
+        const OsXsaveState& state = Cpuid::host_os_state();
+        append_hex(signature, state.xcr0);
+        append_hex(signature, state.amx_permitted);
+    }
+#if defined(__linux__) && defined(__aarch64__)
+    signature += read_small_file("/sys/devices/system/cpu/cpu0/regs/identification/midr_el1");
+    signature += '.';
+    append_hex(signature, getauxval(AT_HWCAP));
+#ifdef AT_HWCAP2
+    append_hex(signature, getauxval(AT_HWCAP2));
+#endif
+#endif
+    return signature;
+}
+
+[[maybe_unused]] std::string join(const std::set<std::string>& names, char separator) {
+    std::string result;
+    for (const auto& name : names) {
+        if (!result.empty())
+            result += separator;
+        result += name;
+    }
+    return result;
+}
+
+[[maybe_unused]] std::set<std::string> split(std::string_view list) {
+    std::set<std::string> result;
+    while (!list.empty()) {
+        size_t end = list.find(' ');
+        if (end != 0)
+            result.emplace(list.substr(0, end));
+        if (end == std::string_view::npos)
+            break;
+        list.remove_prefix(end + 1);
+    }
+    return result;
+}
+
+// Values are stored one per line, after a tab, so neither may appear inside them
+[[maybe_unused]] bool storable(std::string_view value) {
+    return value.find_first_of("\t\n") == std::string_view::npos;
+}
+
+[[maybe_unused]] bool parse_entry(std::string_view data, std::string_view key,
+                                  HostCacheEntry& entry) {
+    bool have_key = false;
+    bool complete = false;
+    bool first = true;
+    while (!data.empty()) {
+        size_t eol = data.find('\n');
+        if (eol == std::string_view::npos)
+            return false; // Truncated
+        std::string_view line = data.substr(0, eol);
+        data.remove_prefix(eol + 1);
+
+        if (first) {
+            if (line != kMagic)
+                return false;
+            first = false;
+            continue;
+        }
+        if (line == "end") {
+            complete = true;
+            break;
+        }
+        size_t tab = line.find('\t');
+        if (tab == std::string_view::npos)
+            return false;
+        std::string_view field = line.substr(0, tab);
+        std::string_view value = line.substr(tab + 1);
+
+        if (field == "key") {
+            if (value != key)
+                return false;
+            have_key = true;
+        } else if (field == "target") {
+            entry.target = value;
+        } else if (field == "name") {
+            entry.info.name = value;
+        } else if (field == "vendor") {
+            entry.info.vendor = value;
+        } else if (field == "generation") {
+            entry.info.generation = std::atoi(std::string(value).c_str());
+        } else if (field == "cpu_part") {
+            entry.info.cpu_part = value;
+        } else if (field == "features") {
+            entry.info.features = split(value);
+        } else if (field == "disabled") {
+            entry.info.disabled_features = split(value);
+        } else if (field == "target_features") {
+            entry.target_features = value;
+        } else if (field == "flags") {
+            size_t sep = value.find('\t');
+            if (sep == std::string_view::npos)
+                return false;
+            entry.flags.emplace_back(value.substr(0, sep), value.substr(sep + 1));
+        }
+    }
+    return have_key && complete && !entry.target.empty();
+}
+
+#if defined(ARCHSPEC_HOST_CACHE_POSIX)
+// Create dir and any missing parents, private to the user
+bool make_directories(const std::string& dir) {
+    if (dir.empty() || ::mkdir(dir.c_str(), 0700) == 0 || errno == EEXIST)
+        return true;
+    if (errno != ENOENT)
+        return false;
+    size_t slash = dir.find_last_of('/');
+    if (slash == std::string::npos || slash == 0)
+        return false;
+    return make_directories(dir.substr(0, slash)) &&
+           (::mkdir(dir.c_str(), 0700) == 0 || errno == EEXIST);
+}
+#endif
+
+} // anonymous namespace
+
+HostCacheEntry make_host_cache_entry(const DetectedCpuInfo& info,
+                                     const Microarchitecture& target) {
+    HostCacheEntry entry;
+    entry.target = target.name();
+    entry.info = info;
+    for (std::string_view feature : target.feature_views()) {
+        if (!entry.target_features.empty())
+            entry.target_features += ',';
+        entry.target_features += feature;
+    }
+
+    std::set<std::string> compilers;
+    for (const auto& [name, known] : MicroarchitectureDatabase::instance().all()) {
+        for (const auto& [compiler, _] : known.compilers())
+            compilers.insert(compiler);
+    }
+    for (const auto& compiler : compilers) {
+        std::string flags = target.optimization_flags(compiler, "");
+        if (!flags.empty())
+            entry.flags.emplace_back(compiler, std::move(flags));
+    }
+    return entry;
+}
+
+std::string host_cache_key() {
+    std::string boot = boot_id();
+    if (boot.empty())
+        return {};
+    std::string key = "boot=" + boot + " cpu=" + cpu_signature() + " db=";
+    append_hex(key, MicroarchitectureDatabase::instance_content_hash());
+    key += " build=";
+#if defined(ARCHSPEC_CPUID_DETECTION)
+    key += "cpuid";
+#else
+    key += "os";
+#endif
+    return key;
+}
+
+std::string host_cache_path() {
+    const char* xdg = std::getenv("XDG_CACHE_HOME");
+    if (xdg && *xdg == '/')
+        return std::string(xdg) + "/archspec/host";
+    const char* home = std::getenv("HOME");
+    if (home && *home)
+        return std::string(home) + "/.cache/archspec/host";
+    return {};
+}
+
+std::optional<HostCacheEntry> read_host_cache(std::string_view path, std::string_view key) {
+#if defined(ARCHSPEC_HOST_CACHE_POSIX)
+    if (path.empty() || key.empty())
+        return std::nullopt;
+    int fd = ::open(std::string(path).c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return std::nullopt;
+    struct stat st;
+    void* map = MAP_FAILED;
+    if (::fstat(fd, &st) == 0 && st.st_size > 0)
+        map = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED)
+        return std::nullopt;
+
+    HostCacheEntry entry;
+    size_t size = static_cast<size_t>(st.st_size);
+    bool ok = parse_entry(std::string_view(static_cast<const char*>(map), size), key, entry);
+    ::munmap(map, size);
+    if (!ok)
+        return std::nullopt;
+    return entry;
+#else
+    (void)path;
+    (void)key;
+    return std::nullopt;
+#endif
+}
+
+bool write_host_cache(std::string_view path, std::string_view key, const HostCacheEntry& entry) {
+#if defined(ARCHSPEC_HOST_CACHE_POSIX)
+    if (path.empty() || key.empty())
+        return false;
+    std::string content(kMagic);
+    content += '\n';
+    auto field = [&content](const char* name, std::string_view value) {
+        content += name;
+        content += '\t';
+        content += value;
+        content += '\n';
+        return storable(value);
+    };
+    bool ok = field("key", key) && field("target", entry.target) &&
+              field("name", entry.info.name) && field("vendor", entry.info.vendor) &&
+              field("generation", std::to_string(entry.info.generation)) &&
+              field("cpu_part", entry.info.cpu_part) &&
+              field("features", join(entry.info.features, ' ')) &&
+              field("disabled", join(entry.info.disabled_features, ' ')) &&
+              field("target_features", entry.target_features);
+    for (const auto& [compiler, flags] : entry.flags) {
+        ok = ok && storable(compiler) && storable(flags);
+        content += "flags\t" + compiler + "\t" + flags + "\n";
+    }
+    content += "end\n";
+    if (!ok)
+        return false;
+
+    std::string file(path);
+    size_t slash = file.find_last_of('/');
+    if (slash != std::string::npos && !make_directories(file.substr(0, slash)))
+        return false;
+
+    // Readers see either the old file or the new one, never a partial write
+    std::string temp = file + "." + std::to_string(::getpid()) + ".tmp";
+    int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0)
+        return false;
+    size_t written = 0;
+    while (written < content.size()) {
+        ssize_t n = ::write(fd, content.data() + written, content.size() - written);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        written += static_cast<size_t>(n);
+    }
+    bool stored = ::close(fd) == 0 && written == content.size() &&
+                  ::rename(temp.c_str(), file.c_str()) == 0;
+    if (!stored)
+        ::unlink(temp.c_str());
+    return stored;
+#else
+    (void)path;
+    (void)key;
+    (void)entry;
+    return false;
+#endif
+}
+
+std::optional<HostCacheEntry> load_host_cache() {
+#if defined(ARCHSPEC_HOST_CACHE)
+    return read_host_cache(host_cache_path(), host_cache_key());
+#else
+    return std::nullopt;
+#endif
+}
+
+void store_host_cache(const HostCacheEntry& entry) {
+#if defined(ARCHSPEC_HOST_CACHE)
+    write_host_cache(host_cache_path(), host_cache_key(), entry);
+#else
+    (void)entry;
+#endif
+}
+
+} // namespace archspec
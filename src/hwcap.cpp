@@ -0,0 +1,72 @@
+// This file is a part of Julia. License is MIT: https://julialang.org/license
+
+#include "archspec/hwcap.hpp"
+
+#include <cstdio>
+
+namespace archspec {
+namespace hwcap {
+
+namespace {
+
+// Names indexed by bit position, in the order of hwcap_str[] in arch/arm64/kernel/cpuinfo.c
+// clang-format off
+constexpr const char* kHwcapNames[] = {
+    /*  0 */ "fp", "asimd", "evtstrm", "aes", "pmull", "sha1", "sha2", "crc32",
+    /*  8 */ "atomics", "fphp", "asimdhp", "cpuid", "asimdrdm", "jscvt", "fcma", "lrcpc",
+    /* 16 */ "dcpop", "sha3", "sm3", "sm4", "asimddp", "sha512", "sve", "asimdfhm",
+    /* 24 */ "dit", "uscat", "ilrcpc", "flagm", "ssbs", "sb", "paca", "pacg",
+};
+
+constexpr const char* kHwcap2Names[] = {
+    /*  0 */ "dcpodp", "sve2", "sveaes", "svepmull", "svebitperm", "svesha3", "svesm4", "flagm2",
+    /*  8 */ "frint", "svei8mm", "svef32mm", "svef64mm", "svebf16", "i8mm", "bf16", "dgh",
+    /* 16 */ "rng", "bti", "mte", "ecv", "afp", "rpres", "mte3", "sme",
+    /* 24 */ "smei16i64", "smef64f64", "smei8i32", "smef16f32",
+    /* 28 */ "smeb16f32", "smef32f32", "smefa64", "wfxt",
+    /* 32 */ "ebf16", "sveebf16", "cssc", "rprfm", "sve2p1", "sme2", "sme2p1", "smei16i32",
+    /* 40 */ "smebi32i32", "smeb16b16", "smef16f16", "mops", "hbc", "sveb16b16", "lrcpc3", "lse128",
+};
+// clang-format on
+
+static_assert(sizeof(kHwcapNames) / sizeof(kHwcapNames[0]) <= 64, "AT_HWCAP is 64 bits");
+static_assert(sizeof(kHwcap2Names) / sizeof(kHwcap2Names[0]) <= 64, "AT_HWCAP2 is 64 bits");
+
+template <size_t N>
+void decode_bits(uint64_t bits, const char* const (&names)[N], std::set<std::string>& out) {
+    for (size_t i = 0; i < N; ++i) {
+        if ((bits >> i) & 1)
+            out.insert(names[i]);
+    }
+}
+
+std::string format_hex(unsigned value, int width) {
+    char buf[16];
+    std::snprintf(buf, sizeof(buf), "0x%0*x", width, value);
+    return buf;
+}
+
+} // anonymous namespace
+
+std::set<std::string> decode(uint64_t hwcap, uint64_t hwcap2) {
+    std::set<std::string> features;
+    decode_bits(hwcap, kHwcapNames, features);
+    decode_bits(hwcap2, kHwcap2Names, features);
+    return features;
+}
+
+const std::set<std::string>& known_features() {
+    static const std::set<std::string> names = decode(~uint64_t(0), ~uint64_t(0));
+    return names;
+}
+
+std::string midr_implementer(uint64_t midr) {
+    return format_hex(static_cast<unsigned>((midr >> 24) & 0xff), 2);
+}
+
+std::string midr_part(uint64_t midr) {
+    return format_hex(static_cast<unsigned>((midr >> 4) & 0xfff), 3);
+}
+
+} // namespace hwcap
+} // namespace archspec
@@ -3,15 +3,21 @@
 #include "archspec/llvm_compat.hpp"
 #include "archspec/microarchitecture.hpp"
 #include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
 #include <cctype>
+#include <mutex>
 
 namespace archspec {
 
+// Every table below is keyed and valued by string literals, so lookups take a string_view
+// directly and never build a temporary std::string
+
 // ============================================================================
 // AArch64 feature mapping
 // ============================================================================
 
-static const std::unordered_map<std::string, std::string> aarch64_feature_map = {
+static const std::unordered_map<std::string_view, std::string_view> aarch64_feature_map = {
     {"asimd", "neon"},       {"asimddp", "dotprod"},  {"asimdfhm", "fp16fml"},
     {"asimdhp", "fullfp16"}, {"asimdrdm", "rdm"},     {"atomics", "lse"},
     {"crc32", "crc"},        {"fcma", "complxnum"},   {"fp", "fp-armv8"},
@@ -21,7 +27,7 @@ static const std::unordered_map<std::string, std::string> aarch64_feature_map =
 };
 
 // Features to filter out (no LLVM equivalent or implied by other features)
-static const std::set<std::string> aarch64_filter_out = {
+static const std::unordered_set<std::string_view> aarch64_filter_out = {
     "cpuid", "dcpodp", "dcpop", "dgh", "evtstrm", "flagm2", "frint",
     "uscat", "sha1", "sha512", "pmull",
     "svebf16",  // implied by sve + bf16
@@ -32,7 +38,7 @@ static const std::set<std::string> aarch64_filter_out = {
 // x86_64 feature mapping
 // ============================================================================
 
-static const std::unordered_map<std::string, std::string> x86_64_feature_map = {
+static const std::unordered_map<std::string_view, std::string_view> x86_64_feature_map = {
     {"sse4_1", "sse4.1"},
     {"sse4_2", "sse4.2"},
     {"avx512_vnni", "avx512vnni"},
@@ -55,7 +61,7 @@ static const std::unordered_map<std::string, std::string> x86_64_feature_map = {
     {"amx_tile", "amx-tile"},
 };
 
-static const std::set<std::string> x86_64_filter_out = {
+static const std::unordered_set<std::string_view> x86_64_filter_out = {
     "3dnow",
     "3dnowext",
     "avx512er",
@@ -66,7 +72,7 @@ static const std::set<std::string> x86_64_filter_out = {
 // RISC-V feature mapping
 // ============================================================================
 
-static const std::unordered_map<std::string, std::string> riscv_feature_map = {
+static const std::unordered_map<std::string_view, std::string_view> riscv_feature_map = {
     // RISC-V extensions often match but may need prefix
     {"m", "m"},
     {"a", "a"},
@@ -86,7 +92,7 @@ static const std::unordered_map<std::string, std::string> riscv_feature_map = {
     {"zvl1024b", "zvl1024b"},
 };
 
-static const std::set<std::string> riscv_filter_out = {
+static const std::unordered_set<std::string_view> riscv_filter_out = {
     // RISC-V usually doesn't need filtering
 };
 
@@ -94,7 +100,7 @@ static const std::set<std::string> riscv_filter_out = {
 // CPU name mapping
 // ============================================================================
 
-static const std::unordered_map<std::string, std::string> aarch64_cpu_map = {
+static const std::unordered_map<std::string_view, std::string_view> aarch64_cpu_map = {
     // Apple Silicon: archspec uses short names, LLVM uses apple- prefix
     {"m1", "apple-m1"},
     {"m1_pro", "apple-m1"},
@@ -128,7 +134,7 @@ static const std::unordered_map<std::string, std::string> aarch64_cpu_map = {
     {"thunderx3", "thunderx3t110"},
 };
 
-static const std::unordered_map<std::string, std::string> x86_64_cpu_map = {
+static const std::unordered_map<std::string_view, std::string_view> x86_64_cpu_map = {
     // AMD Zen family: archspec uses "zen" names, LLVM uses "znver"
     {"zen", "znver1"},
     {"zen2", "znver2"},
@@ -146,89 +152,85 @@ static const std::unordered_map<std::string, std::string> x86_64_cpu_map = {
 // Implementation
 // ============================================================================
 
-std::string map_feature_to_llvm(std::string_view arch_family, std::string_view feature) {
-    std::string feat_str(feature);
+namespace {
+
+using NameMap = std::unordered_map<std::string_view, std::string_view>;
+using NameSet = std::unordered_set<std::string_view>;
+
+bool is_x86(std::string_view arch_family) {
+    return arch_family == "x86_64" || arch_family == "x86";
+}
+
+bool is_riscv(std::string_view arch_family) {
+    return arch_family == "riscv64" || arch_family == "riscv32";
+}
+
+NameMap reversed(const NameMap& map) {
+    NameMap result;
+    for (const auto& [from, to] : map)
+        result[to] = from;
+    return result;
+}
 
+} // anonymous namespace
+
+std::string map_feature_to_llvm(std::string_view arch_family, std::string_view feature) {
+    const NameMap* map = nullptr;
+    const NameSet* filter_out = nullptr;
     if (arch_family == "aarch64") {
+        map = &aarch64_feature_map;
+        filter_out = &aarch64_filter_out;
+    } else if (is_x86(arch_family)) {
+        map = &x86_64_feature_map;
+        filter_out = &x86_64_filter_out;
+    } else if (is_riscv(arch_family)) {
+        map = &riscv_feature_map;
+        filter_out = &riscv_filter_out;
+    }
+
+    if (map) {
         // Check if should be filtered
-        if (aarch64_filter_out.count(feat_str)) {
+        if (filter_out->count(feature))
             return "";
-        }
         // Check for mapping
-        auto it = aarch64_feature_map.find(feat_str);
-        if (it != aarch64_feature_map.end()) {
-            return it->second;
-        }
-    } else if (arch_family == "x86_64" || arch_family == "x86") {
-        if (x86_64_filter_out.count(feat_str)) {
-            return "";
-        }
-        auto it = x86_64_feature_map.find(feat_str);
-        if (it != x86_64_feature_map.end()) {
-            return it->second;
-        }
-    } else if (arch_family == "riscv64" || arch_family == "riscv32") {
-        if (riscv_filter_out.count(feat_str)) {
-            return "";
-        }
-        auto it = riscv_feature_map.find(feat_str);
-        if (it != riscv_feature_map.end()) {
-            return it->second;
-        }
+        auto it = map->find(feature);
+        if (it != map->end())
+            return std::string(it->second);
     }
 
     // No mapping needed, return as-is
-    return feat_str;
+    return std::string(feature);
 }
 
 std::string map_llvm_feature_to_archspec(std::string_view arch_family, std::string_view feature) {
-    std::string feat_str(feature);
-    
-    // Build reverse maps lazily (static)
-    static std::unordered_map<std::string, std::string> aarch64_reverse_map;
-    static std::unordered_map<std::string, std::string> x86_64_reverse_map;
-    static std::unordered_map<std::string, std::string> riscv_reverse_map;
-    static bool initialized = false;
-    
-    if (!initialized) {
-        for (const auto& p : aarch64_feature_map) {
-            aarch64_reverse_map[p.second] = p.first;
-        }
-        for (const auto& p : x86_64_feature_map) {
-            x86_64_reverse_map[p.second] = p.first;
-        }
-        for (const auto& p : riscv_feature_map) {
-            riscv_reverse_map[p.second] = p.first;
-        }
-        initialized = true;
-    }
-    
-    if (arch_family == "aarch64") {
-        auto it = aarch64_reverse_map.find(feat_str);
-        if (it != aarch64_reverse_map.end()) {
-            return it->second;
-        }
-    } else if (arch_family == "x86_64" || arch_family == "x86") {
-        auto it = x86_64_reverse_map.find(feat_str);
-        if (it != x86_64_reverse_map.end()) {
-            return it->second;
-        }
-    } else if (arch_family == "riscv64" || arch_family == "riscv32") {
-        auto it = riscv_reverse_map.find(feat_str);
-        if (it != riscv_reverse_map.end()) {
-            return it->second;
-        }
+    // Reverse maps are built once, on first use
+    static const NameMap aarch64_reverse_map = reversed(aarch64_feature_map);
+    static const NameMap x86_64_reverse_map = reversed(x86_64_feature_map);
+    static const NameMap riscv_reverse_map = reversed(riscv_feature_map);
+
+    const NameMap* map = nullptr;
+    if (arch_family == "aarch64")
+        map = &aarch64_reverse_map;
+    else if (is_x86(arch_family))
+        map = &x86_64_reverse_map;
+    else if (is_riscv(arch_family))
+        map = &riscv_reverse_map;
+
+    if (map) {
+        auto it = map->find(feature);
+        if (it != map->end())
+            return std::string(it->second);
     }
-    
+
     // No mapping needed, return as-is
-    return feat_str;
+    return std::string(feature);
 }
 
 std::set<std::string> get_llvm_features(const Microarchitecture& uarch) {
     std::set<std::string> result;
-    std::string family = uarch.family();
+    const std::string& family = uarch.family();
 
-    for (const auto& feat : uarch.features()) {
+    for (std::string_view feat : uarch.feature_views()) {
         std::string mapped = map_feature_to_llvm(family, feat);
         if (!mapped.empty()) {
             result.insert(mapped);
@@ -239,6 +241,16 @@ std::set<std::string> get_llvm_features(const Microarchitecture& uarch) {
 }
 
 std::string get_llvm_features_string(const Microarchitecture& uarch) {
+    return uarch.llvm_features();
+}
+
+std::string get_llvm_cpu_name(const Microarchitecture& uarch) {
+    return uarch.llvm_cpu_name();
+}
+
+namespace {
+
+std::string make_llvm_features_string(const Microarchitecture& uarch) {
     auto features = get_llvm_features(uarch);
     std::string result;
 
@@ -252,44 +264,65 @@ std::string get_llvm_features_string(const Microarchitecture& uarch) {
     return result;
 }
 
-std::string get_llvm_cpu_name(const Microarchitecture& uarch) {
-    std::string name = uarch.name();
-    std::string family = uarch.family();
-    std::string vendor = uarch.vendor();
+std::string make_llvm_cpu_name(const Microarchitecture& uarch) {
+    const std::string& name = uarch.name();
+    const std::string& family = uarch.family();
+    const std::string& vendor = uarch.vendor();
 
     // Check architecture-specific CPU name mappings
     if (family == "aarch64") {
-        // Apple Silicon special handling
-        if (vendor == "Apple" || vendor == "apple") {
-            auto it = aarch64_cpu_map.find(name);
-            if (it != aarch64_cpu_map.end()) {
-                return it->second;
-            }
-            // Fallback: if name starts with 'm' or 'a', add apple- prefix
-            if (!name.empty() && (name[0] == 'm' || name[0] == 'a')) {
-                return "apple-" + name;
-            }
-        }
         auto it = aarch64_cpu_map.find(name);
-        if (it != aarch64_cpu_map.end()) {
-            return it->second;
+        if (it != aarch64_cpu_map.end())
+            return std::string(it->second);
+        // Apple Silicon fallback: if name starts with 'm' or 'a', add apple- prefix
+        if ((vendor == "Apple" || vendor == "apple") && !name.empty() &&
+            (name[0] == 'm' || name[0] == 'a')) {
+            return "apple-" + name;
         }
-    } else if (family == "x86_64" || family == "x86") {
+    } else if (is_x86(family)) {
         auto it = x86_64_cpu_map.find(name);
-        if (it != x86_64_cpu_map.end()) {
-            return it->second;
-        }
+        if (it != x86_64_cpu_map.end())
+            return std::string(it->second);
     }
 
     // No mapping needed
     return name;
 }
 
+} // anonymous namespace
+
+void Microarchitecture::compute_llvm_names(LlvmNames& out) const {
+    out.features = make_llvm_features_string(*this);
+    out.cpu_name = make_llvm_cpu_name(*this);
+}
+
+const Microarchitecture::LlvmNames& Microarchitecture::llvm_names() const {
+    if (db_ || llvm_.ready())
+        return *llvm_;
+
+    // Standalone targets compute theirs on first use
+    static std::mutex standalone_mutex;
+    std::lock_guard<std::mutex> lock(standalone_mutex);
+    if (!llvm_.ready()) {
+        compute_llvm_names(*llvm_);
+        llvm_.publish();
+    }
+    return *llvm_;
+}
+
+const std::string& Microarchitecture::llvm_features() const {
+    return llvm_names().features;
+}
+
+const std::string& Microarchitecture::llvm_cpu_name() const {
+    return llvm_names().cpu_name;
+}
+
 // ============================================================================
 // Reverse CPU name mapping (LLVM -> archspec)
 // ============================================================================
 
-static const std::unordered_map<std::string, std::string> aarch64_cpu_reverse_map = {
+static const std::unordered_map<std::string_view, std::string_view> aarch64_cpu_reverse_map = {
     // Apple Silicon: LLVM uses apple- prefix, archspec uses short names
     {"apple-m1", "m1"},
     {"apple-m2", "m2"},
@@ -337,7 +370,7 @@ static const std::unordered_map<std::string, std::string> aarch64_cpu_reverse_ma
     {"ampere1a", "neoverse_n1"},
 };
 
-static const std::unordered_map<std::string, std::string> x86_64_cpu_reverse_map = {
+static const std::unordered_map<std::string_view, std::string_view> x86_64_cpu_reverse_map = {
     // AMD Zen family: LLVM uses "znver", archspec uses "zen"
     {"znver1", "zen"},
     {"znver2", "zen2"},
@@ -358,78 +391,60 @@ static const std::unordered_map<std::string, std::string> x86_64_cpu_reverse_map
 };
 
 std::string normalize_cpu_name(std::string_view arch_family, std::string_view llvm_name) {
-    std::string name_str(llvm_name);
+    auto dashes_to_underscores = [](std::string_view name) {
+        std::string result(name);
+        std::replace(result.begin(), result.end(), '-', '_');
+        return result;
+    };
 
     if (arch_family == "aarch64") {
-        auto it = aarch64_cpu_reverse_map.find(name_str);
-        if (it != aarch64_cpu_reverse_map.end()) {
-            return it->second;
-        }
+        auto it = aarch64_cpu_reverse_map.find(llvm_name);
+        if (it != aarch64_cpu_reverse_map.end())
+            return std::string(it->second);
         // Handle apple- prefix generically
-        if (name_str.substr(0, 6) == "apple-") {
-            return name_str.substr(6);
-        }
+        if (llvm_name.substr(0, 6) == "apple-")
+            return std::string(llvm_name.substr(6));
         // Handle cortex- prefix (replace - with _)
-        if (name_str.find("cortex-") == 0 || name_str.find("neoverse-") == 0) {
-            std::string result = name_str;
-            for (auto& c : result) {
-                if (c == '-')
-                    c = '_';
-            }
-            return result;
-        }
-    } else if (arch_family == "x86_64" || arch_family == "x86") {
-        auto it = x86_64_cpu_reverse_map.find(name_str);
-        if (it != x86_64_cpu_reverse_map.end()) {
-            return it->second;
-        }
+        if (llvm_name.substr(0, 7) == "cortex-" || llvm_name.substr(0, 9) == "neoverse-")
+            return dashes_to_underscores(llvm_name);
+    } else if (is_x86(arch_family)) {
+        auto it = x86_64_cpu_reverse_map.find(llvm_name);
+        if (it != x86_64_cpu_reverse_map.end())
+            return std::string(it->second);
         // Handle skylake-avx512 style names
-        std::string result = name_str;
-        for (auto& c : result) {
-            if (c == '-')
-                c = '_';
-        }
-        return result;
+        return dashes_to_underscores(llvm_name);
     }
 
     // No mapping needed
-    return name_str;
+    return std::string(llvm_name);
 }
 
 std::string get_llvm_features_for_cpu(std::string_view cpu_name, std::string_view arch_family) {
-    auto& db = MicroarchitectureDatabase::instance();
-    std::string name_str(cpu_name);
+    const auto& db = MicroarchitectureDatabase::instance();
 
     // Skip special names
-    if (name_str == "native" || name_str == "generic") {
+    if (cpu_name == "native" || cpu_name == "generic")
         return "";
-    }
 
     // Try direct lookup first
-    auto uarch_ref = db.get(name_str);
-    if (uarch_ref) {
-        return get_llvm_features_string(uarch_ref->get());
-    }
+    if (auto uarch = db.get(cpu_name))
+        return get_llvm_features_string(uarch->get());
 
     // Try normalized name
     std::string normalized = normalize_cpu_name(arch_family, cpu_name);
-    if (normalized != name_str) {
-        uarch_ref = db.get(normalized);
-        if (uarch_ref) {
-            return get_llvm_features_string(uarch_ref->get());
-        }
+    if (normalized != cpu_name) {
+        if (auto uarch = db.get(normalized))
+            return get_llvm_features_string(uarch->get());
     }
 
-    // Try lowercase
-    std::string lower = name_str;
-    for (auto& c : lower) {
-        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
-    }
-    if (lower != name_str) {
-        uarch_ref = db.get(lower);
-        if (uarch_ref) {
-            return get_llvm_features_string(uarch_ref->get());
-        }
+    // Try lowercase, only when there is something to lower
+    auto is_upper = [](char c) { return std::isupper(static_cast<unsigned char>(c)) != 0; };
+    if (std::any_of(cpu_name.begin(), cpu_name.end(), is_upper)) {
+        std::string lower(cpu_name);
+        for (auto& c : lower)
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        if (auto uarch = db.get(lower))
+            return get_llvm_features_string(uarch->get());
     }
 
     // Not found
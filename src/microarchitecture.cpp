@@ -1,46 +1,192 @@
 // This file is a part of Julia. License is MIT: https://julialang.org/license
 
 #include "archspec/microarchitecture.hpp"
+#include "hash.hpp"
+#include "trace.hpp"
 #include <nlohmann/json.hpp>
 #include <fstream>
-#include <sstream>
 #include <algorithm>
-#include <regex>
+#include <atomic>
+#include <charconv>
+#include <iterator>
+#include <mutex>
+#include <unordered_set>
 #include <stdexcept>
 
+#if defined(ARCHSPEC_STATIC_DATA)
+// Pre-generated constexpr tables (make regenerate-data)
+#include "microarchitectures_tables.hpp"
+#else
 // Embedded JSON data
 #include "microarchitectures_data.inc"
+#endif
 
 namespace archspec {
 
-Microarchitecture::Microarchitecture(
-    const std::string& name, const std::vector<std::string>& parents, const std::string& vendor,
-    const std::set<std::string>& features,
-    const std::map<std::string, std::vector<CompilerEntry>>& compilers, int generation,
-    const std::string& cpu_part)
-    : name_(name),
-      parent_names_(parents),
-      vendor_(vendor),
-      features_(features),
-      compilers_(compilers),
+namespace {
+
+// Parse a version string like "4.9" into its numeric components; non-numeric parts are ignored
+std::vector<int> parse_version(std::string_view version) {
+    std::vector<int> result;
+    size_t pos = 0;
+    while (pos <= version.size()) {
+        size_t dot = version.find('.', pos);
+        if (dot == std::string_view::npos)
+            dot = version.size();
+        int value = 0;
+        const char* first = version.data() + pos;
+        const char* last = version.data() + dot;
+        if (first != last && std::from_chars(first, last, value).ec == std::errc())
+            result.push_back(value);
+        pos = dot + 1;
+    }
+    return result;
+}
+
+// Compare versions: returns -1 if a < b, 0 if equal, 1 if a > b
+int compare_versions(const std::vector<int>& a, const std::vector<int>& b) {
+    size_t max_len = std::max(a.size(), b.size());
+    for (size_t i = 0; i < max_len; ++i) {
+        int va = (i < a.size()) ? a[i] : 0;
+        int vb = (i < b.size()) ? b[i] : 0;
+        if (va < vb)
+            return -1;
+        if (va > vb)
+            return 1;
+    }
+    return 0;
+}
+
+struct BuiltinTuning {
+    std::string_view name;
+    uint32_t vector_width;
+    uint32_t fma_units;
+    uint32_t sve_vector_length;
+    int prefer_256;
+};
+
+constexpr BuiltinTuning kBuiltinTuning[] = {
+#include "microarchitectures_tuning.inc"
+};
+
+constexpr bool builtin_tuning_sorted() {
+    for (size_t i = 1; i < std::size(kBuiltinTuning); ++i) {
+        if (!(kBuiltinTuning[i - 1].name < kBuiltinTuning[i].name))
+            return false;
+    }
+    return true;
+}
+static_assert(builtin_tuning_sorted(), "microarchitectures_tuning.inc must be sorted by name");
+
+// Copy every hint from that into is unset in
+void fill_unset(TuningHints& into, const TuningHints& from) {
+    if (!into.vector_width)
+        into.vector_width = from.vector_width;
+    if (!into.fma_units)
+        into.fma_units = from.fma_units;
+    if (!into.sve_vector_length)
+        into.sve_vector_length = from.sve_vector_length;
+    if (!into.prefer_256)
+        into.prefer_256 = from.prefer_256;
+}
+
+// Declared hints completed from the built-in table
+TuningHints with_builtin_tuning(std::string_view name, const TuningHints& declared) {
+    TuningHints result = declared;
+    auto it = std::lower_bound(std::begin(kBuiltinTuning), std::end(kBuiltinTuning), name,
+                               [](const BuiltinTuning& entry, std::string_view key) {
+                                   return entry.name < key;
+                               });
+    if (it != std::end(kBuiltinTuning) && it->name == name) {
+        TuningHints builtin;
+        builtin.vector_width = it->vector_width;
+        builtin.fma_units = it->fma_units;
+        builtin.sve_vector_length = it->sve_vector_length;
+        if (it->prefer_256 >= 0)
+            builtin.prefer_256 = it->prefer_256 == 1;
+        fill_unset(result, builtin);
+    }
+    return result;
+}
+
+} // anonymous namespace
+
+Microarchitecture::Microarchitecture(std::string name, std::vector<std::string> parents,
+                                     std::string vendor, std::set<std::string> features,
+                                     std::map<std::string, std::vector<CompilerEntry>> compilers,
+                                     int generation, std::string cpu_part, TuningHints tuning)
+    : name_(std::move(name)),
+      parent_names_(std::move(parents)),
+      vendor_(std::move(vendor)),
+      compilers_(std::move(compilers)),
       generation_(generation),
-      cpu_part_(cpu_part) {
+      cpu_part_(std::move(cpu_part)),
+      tuning_(std::move(tuning)) {
     // ssse3 implies sse3; add it if not present
-    if (features_.count("ssse3") && !features_.count("sse3")) {
-        features_.insert("sse3");
+    if (features.count("ssse3") && !features.count("sse3")) {
+        features.insert("sse3");
+    }
+    *features_ = std::move(features);
+    features_.publish();
+
+    // A target without parents is its own family and generic
+    lineage_->family = name_;
+    lineage_->generic = name_;
+    lineage_->tuning = with_builtin_tuning(name_, tuning_);
+    if (parent_names_.empty())
+        lineage_.publish();
+
+    for (const auto& [compiler, entries] : compilers_) {
+        auto& rules = flag_rules_[compiler];
+        rules.reserve(entries.size());
+        for (const auto& entry : entries) {
+            FlagRule rule;
+            size_t colon = entry.versions.find(':');
+            if (colon == std::string::npos) {
+                rule.exact = entry.versions;
+            } else {
+                std::string_view versions(entry.versions);
+                rule.range = true;
+                rule.min = parse_version(versions.substr(0, colon));
+                rule.max = parse_version(versions.substr(colon + 1));
+            }
+
+            const std::string& target_name = entry.name.empty() ? name_ : entry.name;
+            rule.flags = entry.flags;
+            size_t pos = 0;
+            while ((pos = rule.flags.find("{name}", pos)) != std::string::npos) {
+                rule.flags.replace(pos, 6, target_name);
+                pos += target_name.length();
+            }
+            rules.push_back(std::move(rule));
+        }
     }
 }
 
 bool Microarchitecture::has_feature(std::string_view feature) const {
-    std::string feature_str(feature);
-    if (features_.count(feature_str))
+    // Database-owned targets answer from the interned mask without building strings
+    if (db_ && db_->masks_exact()) {
+        if (auto id = db_->feature_id(feature); id && feature_mask_.test(*id))
+            return true;
+        if (const auto* alias = db_->find_alias(feature)) {
+            if (feature_mask_.intersects(alias->any_of))
+                return true;
+            if (alias->families && alias->families->count(family()))
+                return true;
+        }
+        return false;
+    }
+
+    if (declares(feature))
         return true;
 
-    const auto& db = MicroarchitectureDatabase::instance();
+    std::string feature_str(feature);
+
+    const auto& db = db_ ? *db_ : MicroarchitectureDatabase::instance();
 
     if (auto it = db.feature_aliases().find(feature_str); it != db.feature_aliases().end()) {
         for (const auto& aliased : it->second) {
-            if (features_.count(aliased))
+            if (declares(aliased))
                 return true;
         }
     }
@@ -53,69 +199,177 @@ bool Microarchitecture::has_feature(std::string_view feature) const {
     return false;
 }
 
-std::vector<std::string> Microarchitecture::ancestors() const {
-    std::vector<std::string> result;
-    const auto& db = MicroarchitectureDatabase::instance();
+void Microarchitecture::compute_lineage(const Microarchitecture& target,
+                                        const MicroarchitectureDatabase& db, Lineage& out) {
+    out.ancestors.clear();
 
-    // Breadth-first: add direct parents first
-    for (const auto& parent_name : parent_names_)
-        result.push_back(parent_name);
+    // Breadth-first: add direct parents first, then each parent's own closure
+    for (const auto& parent_name : target.parent_names_)
+        out.ancestors.push_back(parent_name);
 
-    for (const auto& parent_name : parent_names_) {
+    for (const auto& parent_name : target.parent_names_) {
         if (auto parent = db.get(parent_name)) {
             for (const auto& ancestor : parent->get().ancestors()) {
-                if (std::find(result.begin(), result.end(), ancestor) == result.end())
-                    result.push_back(ancestor);
+                if (std::find(out.ancestors.begin(), out.ancestors.end(), ancestor) ==
+                    out.ancestors.end())
+                    out.ancestors.push_back(ancestor);
             }
         }
     }
 
-    return result;
+    // Family: the first root (target without parents) among the ancestors
+    out.family = target.name_;
+    if (!target.parent_names_.empty()) {
+        for (const auto& ancestor_name : out.ancestors) {
+            auto ancestor = db.get(ancestor_name);
+            if (ancestor && ancestor->get().parent_names().empty()) {
+                out.family = ancestor_name;
+                break;
+            }
+        }
+    }
+
+    // Generic: the deepest generic ancestor, falling back to the family
+    out.generic = target.name_;
+    if (target.vendor_ != "generic") {
+        const Microarchitecture* best_generic = nullptr;
+        for (const auto& ancestor_name : out.ancestors) {
+            auto ancestor = db.get(ancestor_name);
+            if (!ancestor || ancestor->get().vendor() != "generic")
+                continue;
+            if (!best_generic || ancestor->get().depth() > best_generic->depth())
+                best_generic = &ancestor->get();
+        }
+        out.generic = best_generic ? best_generic->name() : out.family;
+    }
+
+    // Tuning: declared hints, then the built-in row, then each parent's resolved hints
+    out.tuning = with_builtin_tuning(target.name_, target.tuning_);
+    for (const auto& parent_name : target.parent_names_) {
+        if (auto parent = db.get(parent_name))
+            fill_unset(out.tuning, parent->get().tuning());
+    }
 }
 
-std::string Microarchitecture::family() const {
-    if (parent_names_.empty())
-        return name_;
+const Microarchitecture::Lineage& Microarchitecture::lineage() const {
+    // Database-owned targets are finalized at load; targets without parents need no lookups
+    if (db_ || lineage_.ready())
+        return *lineage_;
+
+    // Standalone targets resolve their parents against the global database once
+    static std::mutex standalone_mutex;
+    std::lock_guard<std::mutex> lock(standalone_mutex);
+    if (!lineage_.ready()) {
+        compute_lineage(*this, MicroarchitectureDatabase::instance(), *lineage_);
+        lineage_.publish();
+    }
+    return *lineage_;
+}
 
-    const auto& db = MicroarchitectureDatabase::instance();
-    std::vector<std::string> roots;
+void Microarchitecture::intern_views(Arena& arena, Views& out) const {
+    out.name = arena.intern(name_);
+    out.vendor = arena.intern(vendor_);
+    out.cpu_part = arena.intern(cpu_part_);
+
+    std::vector<std::string_view> items;
+    items.reserve(std::max(parent_names_.size(), features_->size()));
+    for (const auto& parent : parent_names_)
+        items.push_back(arena.intern(parent));
+    out.parents = arena.copy(items);
+    items.clear();
+    for (const auto& feature : *features_)
+        items.push_back(arena.intern(feature));
+    out.features = arena.copy(items);
+}
 
-    for (const auto& ancestor_name : ancestors()) {
-        if (auto ancestor = db.get(ancestor_name)) {
-            if (ancestor->get().parent_names().empty()) {
-                if (std::find(roots.begin(), roots.end(), ancestor_name) == roots.end())
-                    roots.push_back(ancestor_name);
-            }
-        }
+const Microarchitecture::Views& Microarchitecture::views() const {
+    if (db_ || views_.ready())
+        return *views_;
+
+    // Standalone targets intern into an arena shared by all of them, once per object
+    static std::mutex standalone_mutex;
+    static Arena standalone_arena;
+    std::lock_guard<std::mutex> lock(standalone_mutex);
+    if (!views_.ready()) {
+        intern_views(standalone_arena, *views_);
+        views_.publish();
     }
+    return *views_;
+}
 
-    if (roots.size() == 1)
-        return roots[0];
+const std::set<std::string>& Microarchitecture::features() const {
+    if (features_.ready())
+        return *features_;
 
-    return roots.empty() ? name_ : roots[0];
+    static std::mutex materialize_mutex;
+    std::lock_guard<std::mutex> lock(materialize_mutex);
+    if (!features_.ready()) {
+        for (std::string_view feature : feature_views())
+            features_->emplace_hint(features_->end(), feature);
+        features_.publish();
+    }
+    return *features_;
 }
 
-std::string Microarchitecture::generic() const {
-    if (vendor_ == "generic")
-        return name_;
+// Standalone targets still hold the set; others search the sorted feature_views()
+bool Microarchitecture::declares(std::string_view feature) const {
+    if (!db_ && features_.ready())
+        return features_->count(std::string(feature)) > 0;
+    Span<std::string_view> all = feature_views();
+    return std::binary_search(all.begin(), all.end(), feature);
+}
 
-    const auto& db = MicroarchitectureDatabase::instance();
-    std::string best_generic;
-    size_t best_depth = 0;
+const std::vector<std::string>& Microarchitecture::ancestors() const {
+    return lineage().ancestors;
+}
 
-    for (const auto& ancestor_name : ancestors()) {
-        if (auto ancestor = db.get(ancestor_name)) {
-            if (ancestor->get().vendor() == "generic") {
-                size_t depth = ancestor->get().ancestors().size();
-                if (best_generic.empty() || depth > best_depth) {
-                    best_generic = ancestor_name;
-                    best_depth = depth;
-                }
-            }
+const std::string& Microarchitecture::family() const {
+    return lineage().family;
+}
+
+const std::string& Microarchitecture::generic() const {
+    return lineage().generic;
+}
+
+// Copies of database targets keep their bits; after a renumbering they compare by name
+bool Microarchitecture::lineage_bits_current() const {
+    return db_ && lineage_->epoch == db_->index_epoch_;
+}
+
+bool Microarchitecture::has_ancestor(std::string_view name) const {
+    if (name == name_)
+        return true;
+
+    if (lineage_bits_current()) {
+        auto it = db_->target_index_.find(name);
+        if (it != db_->target_index_.end()) {
+            uint32_t i = it->second;
+            const auto& bits = lineage_->bits;
+            return i / 64 < bits.size() && ((bits[i / 64] >> (i % 64)) & 1);
         }
     }
 
-    return best_generic.empty() ? family() : best_generic;
+    const auto& all = ancestors();
+    return std::find(all.begin(), all.end(), name) != all.end();
+}
+
+uint32_t Microarchitecture::preferred_vector_width() const {
+    const TuningHints& hints = tuning();
+    bool avx512 = declares("avx512f");
+    if (avx512 && hints.prefer_256.value_or(false))
+        return 256;
+
+    uint32_t width = 0;
+    if (avx512)
+        width = 512;
+    else if (declares("avx"))
+        width = 256;
+    else if (declares("sse2") || declares("asimd") || declares("neon") || declares("altivec") ||
+             declares("vsx"))
+        width = 128;
+    if (declares("sve"))
+        width = std::max(width, hints.sve_vector_length ? hints.sve_vector_length : 128u);
+    return width ? width : hints.vector_width;
 }
 
 std::set<std::string> Microarchitecture::to_set() const {
@@ -128,8 +382,18 @@ std::set<std::string> Microarchitecture::to_set() const {
 }
 
 bool Microarchitecture::operator==(const Microarchitecture& other) const {
-    return name_ == other.name_ && vendor_ == other.vendor_ && features_ == other.features_ &&
-           parent_names_ == other.parent_names_ && generation_ == other.generation_ &&
+    if (name_ != other.name_ || vendor_ != other.vendor_)
+        return false;
+    if (db_ || other.db_) {
+        Span<std::string_view> features = feature_views();
+        Span<std::string_view> other_features = other.feature_views();
+        if (!std::equal(features.begin(), features.end(), other_features.begin(),
+                        other_features.end()))
+            return false;
+    } else if (features() != other.features()) {
+        return false;
+    }
+    return parent_names_ == other.parent_names_ && generation_ == other.generation_ &&
            cpu_part_ == other.cpu_part_;
 }
 
@@ -138,6 +402,21 @@ bool Microarchitecture::operator!=(const Microarchitecture& other) const {
 }
 
 bool Microarchitecture::operator<(const Microarchitecture& other) const {
+    // Targets of the same database compare their lineage bitmaps directly
+    const auto& this_bits = lineage_->bits;
+    const auto& other_bits = other.lineage_->bits;
+    if (db_ == other.db_ && lineage_bits_current() && other.lineage_bits_current() &&
+        this_bits.size() == other_bits.size()) {
+        bool proper = false;
+        for (size_t i = 0; i < this_bits.size(); ++i) {
+            if (this_bits[i] & ~other_bits[i])
+                return false;
+            if (this_bits[i] != other_bits[i])
+                proper = true;
+        }
+        return proper;
+    }
+
     auto this_set = to_set();
     auto other_set = other.to_set();
 
@@ -167,113 +446,77 @@ bool Microarchitecture::operator>=(const Microarchitecture& other) const {
     return other <= *this;
 }
 
-namespace {
-
-// Helper to parse version string like "4.9" into tuple
-std::vector<int> parse_version(const std::string& version) {
-    std::vector<int> result;
-    std::stringstream ss(version);
-    std::string part;
-    while (std::getline(ss, part, '.')) {
-        if (!part.empty()) {
-            // Parse without exceptions
-            char* end = nullptr;
-            long val = std::strtol(part.c_str(), &end, 10);
-            if (end != part.c_str()) {
-                result.push_back(static_cast<int>(val));
-            }
-            // Ignore non-numeric parts
+const Microarchitecture::FlagRule*
+Microarchitecture::match_flag_rule(std::string_view compiler, std::string_view version,
+                                   const std::vector<int>& parsed) const {
+    auto it = flag_rules_.find(compiler);
+    if (it == flag_rules_.end())
+        return nullptr;
+    for (const auto& rule : it->second) {
+        // A constraint without a colon is an exact match (shouldn't happen in practice)
+        if (!rule.range) {
+            if (rule.exact == version)
+                return &rule;
+            continue;
         }
+        if (!rule.min.empty() && compare_versions(parsed, rule.min) < 0)
+            continue;
+        if (!rule.max.empty() && compare_versions(parsed, rule.max) > 0)
+            continue;
+        return &rule;
     }
-    return result;
-}
-
-// Compare versions: returns -1 if a < b, 0 if equal, 1 if a > b
-int compare_versions(const std::vector<int>& a, const std::vector<int>& b) {
-    size_t max_len = std::max(a.size(), b.size());
-    for (size_t i = 0; i < max_len; ++i) {
-        int va = (i < a.size()) ? a[i] : 0;
-        int vb = (i < b.size()) ? b[i] : 0;
-        if (va < vb)
-            return -1;
-        if (va > vb)
-            return 1;
-    }
-    return 0;
+    return nullptr;
 }
 
-// Check if version satisfies a version constraint like "4.9:" or "3.9:11.1"
-bool satisfies_version(const std::string& constraint, std::string_view version) {
-    size_t colon_pos = constraint.find(':');
-    if (colon_pos == std::string::npos) {
-        // No colon - exact match? (shouldn't happen in practice)
-        return constraint == version;
+Microarchitecture::FlagsResult Microarchitecture::resolve_flags(std::string_view compiler,
+                                                                std::string_view version) const {
+    std::string key;
+    if (db_) {
+        key.reserve(name_.size() + compiler.size() + version.size() + 2);
+        key.append(name_).append(1, '\0').append(compiler).append(1, '\0').append(version);
+        std::shared_lock<std::shared_mutex> lock(db_->flags_mutex_);
+        auto it = db_->flags_cache_.find(key);
+        if (it != db_->flags_cache_.end())
+            return it->second;
     }
 
-    std::string min_ver = constraint.substr(0, colon_pos);
-    std::string max_ver = constraint.substr(colon_pos + 1);
-
-    auto ver = parse_version(std::string(version));
-
-    if (!min_ver.empty()) {
-        auto min = parse_version(min_ver);
-        if (compare_versions(ver, min) < 0) {
-            return false;
+    FlagsResult result;
+    if (const FlagRule* rule = match_flag_rule(compiler, version, parse_version(version))) {
+        result.flags = rule->flags;
+        result.source = name_;
+    } else {
+        // Version not supported or no compiler info - try ancestors
+        const auto& db = db_ ? *db_ : MicroarchitectureDatabase::instance();
+        for (const auto& ancestor_name : ancestors()) {
+            auto ancestor = db.get(ancestor_name);
+            if (!ancestor)
+                continue;
+            result = ancestor->get().resolve_flags(compiler, version);
+            if (!result.flags.empty())
+                break;
         }
+        if (result.flags.empty())
+            result.source.clear();
     }
 
-    if (!max_ver.empty()) {
-        auto max = parse_version(max_ver);
-        if (compare_versions(ver, max) > 0) {
-            return false;
-        }
+    if (db_) {
+        std::unique_lock<std::shared_mutex> lock(db_->flags_mutex_);
+        if (db_->flags_cache_.size() >= MicroarchitectureDatabase::kFlagsCacheLimit)
+            db_->flags_cache_.clear();
+        db_->flags_cache_.emplace(std::move(key), result);
     }
-
-    return true;
+    return result;
 }
 
-} // anonymous namespace
-
 std::string Microarchitecture::optimization_flags(std::string_view compiler,
                                                   std::string_view version) const {
-    const auto& db = MicroarchitectureDatabase::instance();
-
-    // Check if we have info for this compiler
-    std::string compiler_str(compiler);
-    auto it = compilers_.find(compiler_str);
-    if (it != compilers_.end() && !it->second.empty()) {
-        const auto& entries = it->second;
-
-        for (const auto& entry : entries) {
-            if (satisfies_version(entry.versions, version)) {
-                // Format the flags
-                std::string flags = entry.flags;
-                std::string target_name = entry.name.empty() ? name_ : entry.name;
-
-                // Replace {name} placeholder
-                size_t pos = 0;
-                while ((pos = flags.find("{name}", pos)) != std::string::npos) {
-                    flags.replace(pos, 6, target_name);
-                    pos += target_name.length();
-                }
-
-                return flags;
-            }
-        }
-    }
-
-    // Version not supported or no compiler info - try ancestors
-    for (const auto& ancestor_name : ancestors()) {
-        auto ancestor = db.get(ancestor_name);
-        if (ancestor) {
-            std::string result = ancestor->get().optimization_flags(compiler, version);
-            if (!result.empty()) {
-                return result;
-            }
-        }
-    }
+    ARCHSPEC_TRACE_SCOPE(OptimizationFlags);
+    return resolve_flags(compiler, version).flags;
+}
 
-    return "";
+std::string Microarchitecture::optimization_flags_source(std::string_view compiler,
+                                                         std::string_view version) const {
+    return resolve_flags(compiler, version).source;
 }
 
 Microarchitecture generic_microarchitecture(std::string_view name) {
@@ -282,26 +525,106 @@ Microarchitecture generic_microarchitecture(std::string_view name) {
 
 // MicroarchitectureDatabase implementation
 
+namespace {
+
+// The singleton once it has been built, for instance_content_hash()
+std::atomic<const MicroarchitectureDatabase*> g_instance{nullptr};
+
+// Hash of the embedded data, computed once per process
+uint64_t embedded_content_hash() {
+    static const uint64_t hash = [] {
+#if defined(ARCHSPEC_STATIC_DATA)
+        using namespace tables;
+        uint64_t h = kHashSeed;
+        auto add = [&h](std::string_view s) { h = hash_bytes(s, h); };
+        auto add_range = [&h](const Range& r) {
+            h = hash_bytes(std::string_view(reinterpret_cast<const char*>(&r), sizeof(r)), h);
+        };
+        for (std::string_view name : kNames)
+            add(name);
+        for (const CompilerRecord& c : kCompilers) {
+            for (std::string_view field : {c.compiler, c.versions, c.name, c.flags, c.warnings})
+                add(field);
+        }
+        for (const TargetRecord& t : kTargets) {
+            add(t.name);
+            add(t.vendor);
+            add(std::to_string(t.generation));
+            add(t.cpupart);
+            add_range(t.parents);
+            add_range(t.features);
+            add_range(t.compilers);
+        }
+        for (const FeatureAliasRecord& a : kFeatureAliases) {
+            add(a.name);
+            add_range(a.any_of);
+            add_range(a.families);
+        }
+        for (const StringPairRecord& pair : kDarwinFlags) {
+            add(pair.key);
+            add(pair.value);
+        }
+        for (const StringPairRecord& pair : kArmVendors) {
+            add(pair.key);
+            add(pair.value);
+        }
+        return h;
+#else
+        return hash_bytes(MICROARCHITECTURES_JSON);
+#endif
+    }();
+    return hash;
+}
+
+} // anonymous namespace
+
 MicroarchitectureDatabase& MicroarchitectureDatabase::instance() {
     static MicroarchitectureDatabase db;
+    static const bool published = (g_instance.store(&db, std::memory_order_release), true);
+    (void)published;
     return db;
 }
 
+uint64_t MicroarchitectureDatabase::instance_content_hash() {
+    if (const MicroarchitectureDatabase* db = g_instance.load(std::memory_order_acquire))
+        return db->content_hash();
+    return embedded_content_hash();
+}
+
+DatabaseSnapshot
+MicroarchitectureDatabase::make_snapshot(const std::vector<std::string>& overlays) {
+    // The destructor is private; this deleter shares the member function's access
+    DatabaseSnapshot snapshot(new MicroarchitectureDatabase(),
+                              [](const MicroarchitectureDatabase* p) { delete p; });
+    auto& db = const_cast<MicroarchitectureDatabase&>(*snapshot);
+    for (const auto& overlay : overlays) {
+        if (!db.load_overlay(overlay))
+            return nullptr;
+    }
+    for (auto& [name, target] : db.targets_)
+        target.snapshot_.weak = snapshot;
+    return snapshot;
+}
+
 MicroarchitectureDatabase::MicroarchitectureDatabase() {
+    // Intern the generated feature list first so the constants in dispatch.hpp are the ids
+#define ARCHSPEC_FEATURE(identifier, name) intern_feature(name);
+#include "archspec/feature_ids.inc"
+#undef ARCHSPEC_FEATURE
     load_embedded_data();
 }
 
+// Both answer from the string_view hash index rebuilt by finalize() after every load
 std::optional<std::reference_wrapper<const Microarchitecture>>
 MicroarchitectureDatabase::get(std::string_view name) const {
-    std::string name_str(name);
-    auto it = targets_.find(name_str);
-    if (it != targets_.end())
-        return std::cref(it->second);
+    auto it = target_index_.find(name);
+    if (it != target_index_.end())
+        return std::cref(*topo_order_[it->second]);
     return std::nullopt;
 }
 
 bool MicroarchitectureDatabase::exists(std::string_view name) const {
-    return targets_.count(std::string(name)) > 0;
+    return target_index_.count(name) > 0;
 }
 
 std::vector<std::string> MicroarchitectureDatabase::all_names() const {
@@ -313,64 +636,523 @@ std::vector<std::string> MicroarchitectureDatabase::all_names() const {
     return names;
 }
 
+std::optional<FeatureId> MicroarchitectureDatabase::feature_id(std::string_view name) const {
+    auto it = feature_ids_.find(name);
+    if (it != feature_ids_.end())
+        return it->second;
+    return std::nullopt;
+}
+
+FeatureMask MicroarchitectureDatabase::feature_mask(const std::set<std::string>& features) const {
+    FeatureMask mask;
+    for (const auto& f : features) {
+        if (auto id = feature_id(f))
+            mask.set(*id);
+    }
+    return mask;
+}
+
+FeatureId MicroarchitectureDatabase::intern_feature(std::string_view name) {
+    if (auto id = feature_id(name))
+        return *id;
+    FeatureId id = static_cast<FeatureId>(feature_names_.size());
+    feature_names_.emplace_back(name);
+    feature_ids_.emplace(feature_names_.back(), id);
+    return id;
+}
+
+int TargetTable::vendor_id(std::string_view name) const {
+    auto it = std::find(vendor_names.begin(), vendor_names.end(), name);
+    return it != vendor_names.end() ? static_cast<int>(it - vendor_names.begin()) : -1;
+}
+
+int TargetTable::family_id(std::string_view name) const {
+    auto it = std::find(family_names.begin(), family_names.end(), name);
+    return it != family_names.end() ? static_cast<int>(it - family_names.begin()) : -1;
+}
+
+const MicroarchitectureDatabase::AliasEntry*
+MicroarchitectureDatabase::find_alias(std::string_view name) const {
+    auto it = aliases_.find(name);
+    return it != aliases_.end() ? &it->second : nullptr;
+}
+
+void MicroarchitectureDatabase::finalize() {
+    // New targets can change ancestor chains, so memoized flags are recomputed
+    {
+        std::unique_lock<std::shared_mutex> lock(flags_mutex_);
+        flags_cache_.clear();
+    }
+
+    // Ids are only ever appended, so masks held by earlier copies of targets stay valid.
+    // Only targets not seen before are copied into the arena.
+    for (auto& [name, target] : targets_)
+        prepare_target(target);
+
+    // Order targets so every parent precedes its children; a cycle is cut where it is found
+    std::vector<Microarchitecture*> order;
+    std::map<const Microarchitecture*, int> state; // 1 = visiting, 2 = done
+    auto visit = [&](auto& self, Microarchitecture& target) -> void {
+        if (state[&target])
+            return;
+        state[&target] = 1;
+        for (const auto& parent_name : target.parent_names_) {
+            auto it = targets_.find(parent_name);
+            if (it != targets_.end())
+                self(self, it->second);
+        }
+        state[&target] = 2;
+        order.push_back(&target);
+    };
+    for (auto& [name, target] : targets_)
+        visit(visit, target);
+
+    topo_order_.assign(order.begin(), order.end());
+    ++index_epoch_;
+    target_index_.clear();
+    for (uint32_t i = 0; i < order.size(); ++i)
+        target_index_[order[i]->name_] = i;
+
+    // Parents are final before their children, so each closure is built from its parents'
+    size_t words = (order.size() + 63) / 64;
+    for (uint32_t i = 0; i < order.size(); ++i) {
+        Microarchitecture& target = *order[i];
+        target.index_ = i;
+        target.lineage_->bits.assign(words, 0);
+        target.lineage_->bits[i / 64] |= uint64_t(1) << (i % 64);
+        for (const auto& parent_name : target.parent_names_) {
+            auto it = target_index_.find(parent_name);
+            if (it == target_index_.end() || it->second >= i)
+                continue;
+            const auto& parent_bits = order[it->second]->lineage_->bits;
+            for (size_t w = 0; w < words; ++w)
+                target.lineage_->bits[w] |= parent_bits[w];
+        }
+        Microarchitecture::compute_lineage(target, *this, *target.lineage_);
+        target.lineage_->epoch = index_epoch_;
+        target.lineage_.publish();
+    }
+
+    // LLVM names depend on the family, so they follow the lineage
+    for (auto* target : order) {
+        target->compute_llvm_names(*target->llvm_);
+        target->llvm_.publish();
+    }
+
+    rebuild_table_and_aliases();
+}
+
+void MicroarchitectureDatabase::rebuild_table_and_aliases() {
+    // Both finalize() and refresh() end here, once per load
+    ++generation_;
+    table_ = TargetTable();
+    auto column_id = [](std::vector<std::string>& names, const std::string& name) {
+        auto it = std::find(names.begin(), names.end(), name);
+        if (it == names.end())
+            it = names.insert(names.end(), name);
+        return static_cast<uint16_t>(it - names.begin());
+    };
+    for (const auto& [name, target] : targets_) {
+        table_.masks.push_back(target.feature_mask_);
+        table_.vendors.push_back(column_id(table_.vendor_names, target.vendor_));
+        table_.families.push_back(column_id(table_.family_names, target.family()));
+        table_.generations.push_back(target.generation_);
+        table_.targets.push_back(&target);
+    }
+
+    aliases_.clear();
+    for (const auto& [name, any_of] : feature_aliases_) {
+        AliasEntry& entry = aliases_[name];
+        for (const auto& f : any_of)
+            entry.any_of.set(intern_feature(f));
+    }
+    for (const auto& [name, families] : family_features_)
+        aliases_[name].families = &families;
+
+    // Every feature is interned by now, so each id gets a row bitmap
+    size_t words = (table_.size() + 63) / 64;
+    table_.bitmap_words = words;
+    table_.feature_rows.assign(feature_names_.size() * words, 0);
+    for (size_t row = 0; row < table_.size(); ++row) {
+        uint64_t bit = uint64_t(1) << (row % 64);
+        for (std::string_view f : table_.targets[row]->views_->features)
+            table_.feature_rows[size_t(*feature_id(f)) * words + row / 64] |= bit;
+    }
+
+    for (auto& [name, entry] : aliases_)
+        entry.rows.assign(words, 0);
+    for (const auto& [name, any_of] : feature_aliases_) {
+        auto& rows = aliases_[name].rows;
+        for (const auto& f : any_of) {
+            const uint64_t* bits = table_.feature_bitmap(*feature_id(f));
+            for (size_t w = 0; w < words; ++w)
+                rows[w] |= bits[w];
+        }
+    }
+    for (const auto& [name, families] : family_features_) {
+        auto& rows = aliases_[name].rows;
+        for (size_t row = 0; row < table_.size(); ++row) {
+            if (families.count(table_.family_names[table_.families[row]]))
+                rows[row / 64] |= uint64_t(1) << (row % 64);
+        }
+    }
+}
+
+std::vector<uint64_t>
+MicroarchitectureDatabase::rows_with(const std::vector<std::string_view>& features,
+                                     bool every) const {
+    size_t words = table_.bitmap_words;
+    std::vector<uint64_t> rows(words, every ? ~uint64_t(0) : 0);
+    if (every && table_.size() % 64)
+        rows.back() = (uint64_t(1) << (table_.size() % 64)) - 1;
+
+    std::vector<uint64_t> feature(words);
+    for (std::string_view name : features) {
+        std::fill(feature.begin(), feature.end(), 0);
+        const uint64_t* bits = nullptr;
+        if (auto id = feature_id(name); id && (bits = table_.feature_bitmap(*id))) {
+            for (size_t w = 0; w < words; ++w)
+                feature[w] |= bits[w];
+        }
+        if (const auto* alias = find_alias(name)) {
+            for (size_t w = 0; w < words; ++w)
+                feature[w] |= alias->rows[w];
+        }
+        for (size_t w = 0; w < words; ++w)
+            rows[w] = every ? rows[w] & feature[w] : rows[w] | feature[w];
+    }
+    return rows;
+}
+
+std::vector<const Microarchitecture*>
+MicroarchitectureDatabase::rows_to_targets(const std::vector<uint64_t>& rows) const {
+    std::vector<const Microarchitecture*> result;
+    for (size_t w = 0; w < rows.size(); ++w) {
+        for (uint64_t bits = rows[w]; bits; bits &= bits - 1)
+            result.push_back(table_.targets[w * 64 + static_cast<size_t>(__builtin_ctzll(bits))]);
+    }
+    return result;
+}
+
+std::vector<const Microarchitecture*>
+MicroarchitectureDatabase::targets_with(const std::vector<std::string_view>& features) const {
+    return rows_to_targets(rows_with(features, true));
+}
+
+std::vector<const Microarchitecture*>
+MicroarchitectureDatabase::targets_without(const std::vector<std::string_view>& features) const {
+    std::vector<uint64_t> rows = rows_with(features, false);
+    for (auto& word : rows)
+        word = ~word;
+    if (table_.size() % 64)
+        rows.back() &= (uint64_t(1) << (table_.size() % 64)) - 1;
+    return rows_to_targets(rows);
+}
+
+const Microarchitecture*
+MicroarchitectureDatabase::minimal_target(const std::vector<std::string_view>& features,
+                                          std::string_view family) const {
+    int family_id = family.empty() ? -1 : table_.family_id(family);
+    if (!family.empty() && family_id < 0)
+        return nullptr;
+
+    // Rows are in name order, so the first of equally specific candidates wins
+    std::vector<uint64_t> rows = rows_with(features, true);
+    const Microarchitecture* best = nullptr;
+    for (size_t w = 0; w < rows.size(); ++w) {
+        for (uint64_t bits = rows[w]; bits; bits &= bits - 1) {
+            size_t row = w * 64 + static_cast<size_t>(__builtin_ctzll(bits));
+            if (family_id >= 0 && table_.families[row] != family_id)
+                continue;
+            const Microarchitecture* target = table_.targets[row];
+            if (!best || target->depth() < best->depth() ||
+                (target->depth() == best->depth() &&
+                 target->feature_views().size() < best->feature_views().size()))
+                best = target;
+        }
+    }
+    return best;
+}
+
+std::vector<std::string> MicroarchitectureDatabase::feature_diff(const Microarchitecture& a,
+                                                                 const Microarchitecture& b) const {
+    std::vector<std::string> result;
+    if (a.db_ == this && b.db_ == this && masks_exact()) {
+        FeatureMask only_a = a.feature_mask_ - b.feature_mask_;
+        for (size_t w = 0; w < FeatureMask::kWords; ++w) {
+            for (uint64_t bits = only_a.words()[w]; bits; bits &= bits - 1)
+                result.push_back(
+                    feature_names_[w * 64 + static_cast<size_t>(__builtin_ctzll(bits))]);
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+    std::set_difference(a.features().begin(), a.features().end(), b.features().begin(),
+                        b.features().end(), std::back_inserter(result));
+    return result;
+}
+
+void MicroarchitectureDatabase::prepare_target(Microarchitecture& target) {
+    target.db_ = this;
+    if (!target.views_.ready()) {
+        target.intern_views(arena_, *target.views_);
+        target.views_.publish();
+        // The arena copy is the storage from now on; features() rebuilds the set if asked
+        target.features_ = {};
+    }
+    target.feature_mask_ = FeatureMask();
+    for (std::string_view f : target.views_->features)
+        target.feature_mask_.set(intern_feature(f));
+}
+
+void MicroarchitectureDatabase::refresh(const std::vector<std::string>& changed) {
+    // Replaced targets keep their topological position and new ones are appended after every
+    // existing target. That only holds while each replaced target's parents still precede it;
+    // otherwise fall back to a full rebuild.
+    std::vector<Microarchitecture*> added;
+    std::vector<uint32_t> replaced;
+    for (const auto& name : changed) {
+        Microarchitecture& target = targets_.find(name)->second;
+        prepare_target(target);
+        auto it = target_index_.find(name);
+        if (it == target_index_.end()) {
+            added.push_back(&target);
+            continue;
+        }
+        uint32_t index = it->second;
+        for (const auto& parent_name : target.parent_names_) {
+            auto parent = target_index_.find(parent_name);
+            if (parent == target_index_.end() ? targets_.count(parent_name) > 0
+                                              : parent->second >= index) {
+                finalize();
+                return;
+            }
+        }
+        // The key viewed the replaced object's name
+        target_index_.erase(it);
+        target_index_.emplace(target.name_, index);
+        target.index_ = index;
+        replaced.push_back(index);
+    }
+
+    // A new target that an existing one already names as its parent belongs before it
+    if (!added.empty()) {
+        std::unordered_set<std::string_view> added_names;
+        for (const auto* target : added)
+            added_names.insert(target->name_);
+        for (const auto* target : topo_order_) {
+            for (const auto& parent_name : target->parent_names_) {
+                if (added_names.count(parent_name)) {
+                    finalize();
+                    return;
+                }
+            }
+        }
+    }
+
+    size_t old_count = topo_order_.size();
+    std::map<const Microarchitecture*, int> state; // 1 = visiting, 2 = done
+    auto visit = [&](auto& self, Microarchitecture& target) -> void {
+        if (state[&target])
+            return;
+        state[&target] = 1;
+        for (const auto& parent_name : target.parent_names_) {
+            auto it = targets_.find(parent_name);
+            if (it != targets_.end() && !target_index_.count(parent_name))
+                self(self, it->second);
+        }
+        state[&target] = 2;
+        target.index_ = static_cast<uint32_t>(topo_order_.size());
+        topo_order_.push_back(&target);
+        target_index_.emplace(target.name_, target.index_);
+    };
+    for (auto* target : added)
+        visit(visit, *target);
+
+    // Affected: every changed target and everything descending from one, found through the
+    // lineage bits computed before this load
+    size_t words = (topo_order_.size() + 63) / 64;
+    std::vector<uint64_t> dirty(words, 0);
+    for (uint32_t index : replaced)
+        dirty[index / 64] |= uint64_t(1) << (index % 64);
+    std::vector<uint32_t> affected;
+    for (uint32_t i = 0; i < topo_order_.size(); ++i) {
+        auto& bits = const_cast<Microarchitecture*>(topo_order_[i])->lineage_->bits;
+        bits.resize(words, 0);
+        // Replaced objects start with empty bits, so their own index is checked directly
+        bool hit = i >= old_count || ((dirty[i / 64] >> (i % 64)) & 1);
+        for (size_t w = 0; w < words && !hit; ++w)
+            hit = (bits[w] & dirty[w]) != 0;
+        if (hit)
+            affected.push_back(i);
+    }
+
+    {
+        std::unique_lock<std::shared_mutex> lock(flags_mutex_);
+        for (auto it = flags_cache_.begin(); it != flags_cache_.end();) {
+            std::string_view target_name(it->first.c_str());
+            bool stale = std::any_of(affected.begin(), affected.end(), [&](uint32_t i) {
+                return topo_order_[i]->name_ == target_name;
+            });
+            it = stale ? flags_cache_.erase(it) : std::next(it);
+        }
+    }
+
+    for (uint32_t i : affected) {
+        auto& target = *const_cast<Microarchitecture*>(topo_order_[i]);
+        target.lineage_->bits.assign(words, 0);
+        target.lineage_->bits[i / 64] |= uint64_t(1) << (i % 64);
+        for (const auto& parent_name : target.parent_names_) {
+            auto it = target_index_.find(parent_name);
+            if (it == target_index_.end() || it->second >= i)
+                continue;
+            const auto& parent_bits = topo_order_[it->second]->lineage_->bits;
+            for (size_t w = 0; w < words; ++w)
+                target.lineage_->bits[w] |= parent_bits[w];
+        }
+        Microarchitecture::compute_lineage(target, *this, *target.lineage_);
+        target.lineage_->epoch = index_epoch_;
+        target.lineage_.publish();
+        target.compute_llvm_names(*target.llvm_);
+        target.llvm_.publish();
+    }
+
+    rebuild_table_and_aliases();
+}
+
 bool MicroarchitectureDatabase::load_from_file(std::string_view path) {
-    std::string path_str(path);
-    std::ifstream file(path_str);
-    if (!file.is_open()) {
+    std::ifstream file(std::string(path), std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+        return false;
+    std::streamoff size = file.tellg();
+    if (size < 0)
         return false;
-    }
 
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    return load_from_string(buffer.str());
+    // Files written by save_binary() start with its magic and go to the binary loader unread
+    char magic[8] = {};
+    file.seekg(0);
+    if (size >= static_cast<std::streamoff>(sizeof(magic)) && file.read(magic, sizeof(magic)) &&
+        std::string_view(magic, sizeof(magic)) == "ARCHSPDB")
+        return load_binary(path);
+
+    // Anything else is JSON: size the buffer from the file length and read it in one call
+    std::string content(static_cast<size_t>(size), '\0');
+    file.clear();
+    file.seekg(0);
+    if (!file.read(content.data(), size))
+        return false;
+    return load_from_string(content);
 }
 
 namespace {
 
-void fill_target_from_json(std::map<std::string, Microarchitecture>& targets,
-                           const std::string& name, const nlohmann::json& data) {
-    if (targets.count(name))
-        return;
+// Strings of a JSON array; non-string entries are skipped
+template <typename Container>
+void append_strings(const nlohmann::json& array, Container& out) {
+    for (const auto& item : array) {
+        if (const auto* str = item.get_ptr<const std::string*>())
+            out.insert(out.end(), *str);
+    }
+}
+
+// Hints set in a "tuning" object; members that are missing or of the wrong type stay unset
+TuningHints tuning_from_json(const nlohmann::json& data) {
+    TuningHints hints;
+    if (!data.is_object())
+        return hints;
+    auto get_uint = [&](const char* key) -> uint32_t {
+        auto it = data.find(key);
+        return it != data.end() && it->is_number_unsigned() ? it->get<uint32_t>() : 0;
+    };
+    hints.vector_width = get_uint("vector_width");
+    hints.fma_units = get_uint("fma_units");
+    hints.sve_vector_length = get_uint("sve_vector_length");
+    if (auto it = data.find("prefer_256"); it != data.end() && it->is_boolean())
+        hints.prefer_256 = it->get<bool>();
+    return hints;
+}
+
+// Add the target unless one with that name exists (replace it instead when replace is set);
+// returns whether the database changed
+bool fill_target_from_json(std::map<std::string, Microarchitecture>& targets,
+                           const std::string& name, const nlohmann::json& data, bool replace) {
+    auto hint = targets.lower_bound(name);
+    bool exists = hint != targets.end() && hint->first == name;
+    if (exists && !replace)
+        return false;
 
     std::vector<std::string> parents;
-    if (data.contains("from")) {
-        for (const auto& parent : data["from"])
-            parents.push_back(parent.get<std::string>());
+    if (auto from = data.find("from"); from != data.end() && from->is_array()) {
+        parents.reserve(from->size());
+        append_strings(*from, parents);
     }
 
     std::set<std::string> features;
-    if (data.contains("features")) {
-        for (const auto& f : data["features"])
-            features.insert(f.get<std::string>());
-    }
+    if (auto list = data.find("features"); list != data.end())
+        append_strings(*list, features);
 
     std::map<std::string, std::vector<CompilerEntry>> compilers;
-    if (data.contains("compilers")) {
-        for (auto it = data["compilers"].begin(); it != data["compilers"].end(); ++it) {
+    if (auto list = data.find("compilers"); list != data.end()) {
+        for (auto it = list->begin(); it != list->end(); ++it) {
             std::vector<CompilerEntry> entries;
+            entries.reserve(it->size());
             for (const auto& entry : it.value()) {
                 entries.push_back({entry.value("versions", ":"), entry.value("name", ""),
                                    entry.value("flags", ""), entry.value("warnings", "")});
             }
-            compilers[it.key()] = entries;
+            compilers.emplace_hint(compilers.end(), it.key(), std::move(entries));
         }
     }
 
-    targets[name] =
-        Microarchitecture(name, parents, data.value("vendor", "generic"), features, compilers,
-                          data.value("generation", 0), data.value("cpupart", ""));
+    TuningHints tuning;
+    if (auto it = data.find("tuning"); it != data.end())
+        tuning = tuning_from_json(*it);
+
+    if (exists) {
+        hint->second = Microarchitecture(name, std::move(parents), data.value("vendor", "generic"),
+                                         std::move(features), std::move(compilers),
+                                         data.value("generation", 0), data.value("cpupart", ""),
+                                         tuning);
+        return true;
+    }
+    targets.emplace_hint(hint, std::piecewise_construct, std::forward_as_tuple(name),
+                         std::forward_as_tuple(name, std::move(parents),
+                                               data.value("vendor", "generic"),
+                                               std::move(features), std::move(compilers),
+                                               data.value("generation", 0),
+                                               data.value("cpupart", ""), tuning));
+    return true;
 }
 
 } // anonymous namespace
 
-bool load_json_into_database(MicroarchitectureDatabase& db, std::string_view json_data) {
+bool load_json_into_database(MicroarchitectureDatabase& db, std::string_view json_data,
+                             bool overlay) {
     nlohmann::json j = nlohmann::json::parse(json_data, nullptr, false);
     if (j.is_discarded())
         return false;
 
+    std::vector<std::string> changed;
     if (j.contains("microarchitectures")) {
-        for (auto it = j["microarchitectures"].begin(); it != j["microarchitectures"].end(); ++it)
-            fill_target_from_json(db.targets_, it.key(), it.value());
+        for (auto it = j["microarchitectures"].begin(); it != j["microarchitectures"].end(); ++it) {
+            if (fill_target_from_json(db.targets_, it.key(), it.value(), overlay))
+                changed.push_back(it.key());
+        }
+    }
+
+    // Hints for existing targets, merged over what they declare
+    if (auto tuning = j.find("tuning"); tuning != j.end() && tuning->is_object()) {
+        for (auto it = tuning->begin(); it != tuning->end(); ++it) {
+            auto target = db.targets_.find(it.key());
+            if (target == db.targets_.end())
+                continue;
+            TuningHints hints = tuning_from_json(it.value());
+            fill_unset(hints, target->second.tuning_);
+            if (hints != target->second.tuning_) {
+                target->second.tuning_ = hints;
+                changed.push_back(it.key());
+            }
+        }
     }
 
     if (j.contains("feature_aliases")) {
@@ -403,16 +1185,112 @@ bool load_json_into_database(MicroarchitectureDatabase& db, std::string_view jso
         }
     }
 
+    db.content_hash_ = hash_bytes(json_data, db.content_hash_);
+
+    // Loads into a populated database only recompute what they touched
+    if (db.loaded_)
+        db.refresh(changed);
+    else
+        db.finalize();
     db.loaded_ = true;
     return true;
 }
 
+#if defined(ARCHSPEC_STATIC_DATA)
+void load_tables_into_database(MicroarchitectureDatabase& db) {
+    using namespace tables;
+
+    auto names = [](const Range& r) {
+        std::vector<std::string> result;
+        result.reserve(r.count);
+        for (uint32_t i = r.begin; i < r.begin + r.count; ++i)
+            result.emplace_back(kNames[i]);
+        return result;
+    };
+
+    for (size_t t = 0; t < kTargetsCount; ++t) {
+        const TargetRecord& record = kTargets[t];
+        std::string name(record.name);
+        auto hint = db.targets_.lower_bound(name);
+        if (hint != db.targets_.end() && hint->first == name)
+            continue;
+
+        // The data lists features mostly sorted, so hinting at the end is usually exact
+        std::set<std::string> features;
+        for (uint32_t i = record.features.begin; i < record.features.begin + record.features.count;
+             ++i)
+            features.emplace_hint(features.end(), kNames[i]);
+
+        std::map<std::string, std::vector<CompilerEntry>> compilers;
+        for (uint32_t i = record.compilers.begin;
+             i < record.compilers.begin + record.compilers.count; ++i) {
+            const CompilerRecord& entry = kCompilers[i];
+            compilers[std::string(entry.compiler)].push_back(
+                {std::string(entry.versions), std::string(entry.name), std::string(entry.flags),
+                 std::string(entry.warnings)});
+        }
+
+        db.targets_.emplace_hint(
+            hint, std::piecewise_construct, std::forward_as_tuple(name),
+            std::forward_as_tuple(name, names(record.parents), std::string(record.vendor),
+                                  std::move(features), std::move(compilers), record.generation,
+                                  std::string(record.cpupart)));
+    }
+
+    for (size_t a = 0; a < kFeatureAliasesCount; ++a) {
+        const FeatureAliasRecord& record = kFeatureAliases[a];
+        std::string name(record.name);
+        if (record.any_of.count) {
+            auto any_of = names(record.any_of);
+            db.feature_aliases_[name] = std::set<std::string>(any_of.begin(), any_of.end());
+        }
+        if (record.families.count) {
+            auto families = names(record.families);
+            db.family_features_[name] = std::set<std::string>(families.begin(), families.end());
+        }
+    }
+
+    for (size_t i = 0; i < kDarwinFlagsCount; ++i)
+        db.darwin_flags_[std::string(kDarwinFlags[i].key)] = std::string(kDarwinFlags[i].value);
+    for (size_t i = 0; i < kArmVendorsCount; ++i)
+        db.arm_vendors_[std::string(kArmVendors[i].key)] = std::string(kArmVendors[i].value);
+
+    db.finalize();
+    db.loaded_ = true;
+}
+#endif
+
 bool MicroarchitectureDatabase::load_from_string(std::string_view json_data) {
-    return load_json_into_database(*this, json_data);
+    return load_json_into_database(*this, json_data, false);
+}
+
+bool MicroarchitectureDatabase::load_overlay(std::string_view json_data) {
+    return load_json_into_database(*this, json_data, true);
+}
+
+bool MicroarchitectureDatabase::load_overlay_file(std::string_view path) {
+    std::ifstream file(std::string(path), std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+        return false;
+    std::streamoff size = file.tellg();
+    if (size < 0)
+        return false;
+
+    std::string content(static_cast<size_t>(size), '\0');
+    file.seekg(0);
+    if (!file.read(content.data(), size))
+        return false;
+    return load_overlay(content);
 }
 
 void MicroarchitectureDatabase::load_embedded_data() {
+    ARCHSPEC_TRACE_SCOPE(LoadEmbeddedData);
+#if defined(ARCHSPEC_STATIC_DATA)
+    load_tables_into_database(*this);
+#else
     load_from_string(MICROARCHITECTURES_JSON);
+#endif
+    content_hash_ = embedded_content_hash();
 }
 
 } // namespace archspec
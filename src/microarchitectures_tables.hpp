@@ -0,0 +1,56 @@
+// This file is a part of Julia. License is MIT: https://julialang.org/license
+//
+// Record types for the constexpr microarchitecture tables emitted by
+// tools/generate_tables.cpp into microarchitectures_tables.inc
+
+#ifndef ARCHSPEC_MICROARCHITECTURES_TABLES_HPP
+#define ARCHSPEC_MICROARCHITECTURES_TABLES_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace archspec {
+namespace tables {
+
+// Half-open slice [begin, begin + count) into one of the flat tables below
+struct Range {
+    uint32_t begin;
+    uint32_t count;
+};
+
+struct CompilerRecord {
+    std::string_view compiler;
+    std::string_view versions;
+    std::string_view name;
+    std::string_view flags;
+    std::string_view warnings;
+};
+
+struct TargetRecord {
+    std::string_view name;
+    std::string_view vendor;
+    int generation;
+    std::string_view cpupart;
+    Range parents;   // into kNames
+    Range features;  // into kNames
+    Range compilers; // into kCompilers
+};
+
+struct FeatureAliasRecord {
+    std::string_view name;
+    Range any_of;   // into kNames
+    Range families; // into kNames
+};
+
+struct StringPairRecord {
+    std::string_view key;
+    std::string_view value;
+};
+
+} // namespace tables
+} // namespace archspec
+
+#include "microarchitectures_tables.inc"
+
+#endif // ARCHSPEC_MICROARCHITECTURES_TABLES_HPP
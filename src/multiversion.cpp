@@ -0,0 +1,89 @@
+// This file is a part of Julia. License is MIT: https://julialang.org/license
+
+#include "archspec/multiversion.hpp"
+
+#include <algorithm>
+#include <unordered_set>
+
+namespace archspec {
+
+ClonePlan plan_clones(const std::vector<std::string>& targets, std::string_view compiler,
+                      std::string_view version) {
+    const auto& db = MicroarchitectureDatabase::instance();
+    ClonePlan plan;
+
+    std::vector<const Microarchitecture*> picked;
+    std::unordered_set<std::string_view> seen;
+    for (const auto& name : targets) {
+        if (!seen.insert(name).second)
+            continue;
+        auto target = db.get(name);
+        if (!target) {
+            plan.skipped.push_back(name);
+            continue;
+        }
+        const Microarchitecture& t = target->get();
+        bool duplicate = std::any_of(picked.begin(), picked.end(), [&](const auto* other) {
+            return other->feature_mask() == t.feature_mask();
+        });
+        if (!duplicate)
+            picked.push_back(&t);
+    }
+
+    // Fewer features first is a linear extension of the subset order; the topological index
+    // keeps ties (unrelated targets of equal size) in a stable, ancestry-respecting order
+    std::vector<std::pair<size_t, uint32_t>> keys;
+    std::vector<size_t> order(picked.size());
+    for (size_t i = 0; i < picked.size(); ++i) {
+        auto pos = std::find(db.topological_order().begin(), db.topological_order().end(),
+                             picked[i]);
+        keys.emplace_back(picked[i]->feature_mask().count(),
+                          static_cast<uint32_t>(pos - db.topological_order().begin()));
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return keys[a] < keys[b]; });
+
+    for (size_t i : order) {
+        const Microarchitecture& target = *picked[i];
+        Clone clone;
+        clone.target = &target;
+        clone.flags = target.optimization_flags(compiler, version);
+        if (clone.flags.empty()) {
+            plan.skipped.push_back(target.name());
+            continue;
+        }
+        clone.llvm_cpu = target.llvm_cpu_name();
+        clone.llvm_features = target.llvm_features();
+        clone.mask = target.feature_mask();
+
+        // Closest earlier clone whose features this one includes
+        size_t best_count = 0;
+        for (uint32_t c = 0; c < plan.clones.size(); ++c) {
+            const FeatureMask& base = plan.clones[c].mask;
+            if (base.is_subset_of(clone.mask) &&
+                (clone.base == Clone::kNoBase || base.count() >= best_count)) {
+                clone.base = c;
+                best_count = base.count();
+            }
+        }
+
+        const FeatureMask added = clone.base == Clone::kNoBase
+                                      ? clone.mask
+                                      : clone.mask - plan.clones[clone.base].mask;
+        for (FeatureId id = 0; id < db.feature_count(); ++id) {
+            if (added.test(id))
+                clone.added.push_back(db.feature_name(id));
+        }
+        std::sort(clone.added.begin(), clone.added.end());
+        plan.clones.push_back(std::move(clone));
+    }
+
+    // Supersets come later in clones, so walking it backwards tests the most specific first
+    for (size_t c = plan.clones.size(); c-- > 0;) {
+        plan.dispatch.masks.push_back(plan.clones[c].mask);
+        plan.dispatch.clones.push_back(static_cast<uint32_t>(c));
+    }
+    return plan;
+}
+
+} // namespace archspec
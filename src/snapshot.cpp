@@ -0,0 +1,49 @@
+// This file is a part of Julia. License is MIT: https://julialang.org/license
+
+#include "archspec/snapshot.hpp"
+
+namespace archspec {
+
+// All operations on current_ and readers_ are sequentially consistent: a reader that pins
+// after store() checked readers_ is ordered after the swap, so it can only load the new slot.
+
+AtomicSnapshot::AtomicSnapshot(DatabaseSnapshot initial)
+    : current_(new Slot{std::move(initial)}) {}
+
+AtomicSnapshot::~AtomicSnapshot() {
+    for (Slot* slot : retired_)
+        delete slot;
+    delete current_.load();
+}
+
+DatabaseSnapshot AtomicSnapshot::load() const {
+    readers_.fetch_add(1);
+    DatabaseSnapshot result = current_.load()->snapshot;
+    readers_.fetch_sub(1);
+    return result;
+}
+
+void AtomicSnapshot::store(DatabaseSnapshot next) {
+    Slot* slot = new Slot{std::move(next)};
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    retired_.push_back(current_.exchange(slot));
+    reclaim_locked();
+}
+
+size_t AtomicSnapshot::reclaim() {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    return reclaim_locked();
+}
+
+size_t AtomicSnapshot::reclaim_locked() {
+    // Every retired slot was unpublished before this check, so with no reader pinned none
+    // of them can still be reached
+    if (readers_.load() == 0) {
+        for (Slot* slot : retired_)
+            delete slot;
+        retired_.clear();
+    }
+    return retired_.size();
+}
+
+} // namespace archspec
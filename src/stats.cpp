@@ -0,0 +1,56 @@
+// This file is a part of Julia. License is MIT: https://julialang.org/license
+
+#include "archspec/stats.hpp"
+#include "trace.hpp"
+
+namespace archspec {
+
+#if defined(ARCHSPEC_TRACE)
+
+namespace trace {
+AtomicCounter g_counters[CounterCount];
+} // namespace trace
+
+namespace {
+
+StatCounter snapshot(trace::Counter counter) {
+    const trace::AtomicCounter& c = trace::g_counters[counter];
+    StatCounter result;
+    result.calls = c.calls.load(std::memory_order_relaxed);
+    result.total_ns = c.total_ns.load(std::memory_order_relaxed);
+    result.max_ns = c.max_ns.load(std::memory_order_relaxed);
+    return result;
+}
+
+} // anonymous namespace
+
+Stats stats() {
+    Stats result;
+    result.enabled = true;
+    result.load_embedded_data = snapshot(trace::LoadEmbeddedData);
+    result.detect_cpu_info = snapshot(trace::DetectCpuInfo);
+    result.compatible_microarchitectures = snapshot(trace::CompatibleMicroarchitectures);
+    result.host = snapshot(trace::Host);
+    result.optimization_flags = snapshot(trace::OptimizationFlags);
+    return result;
+}
+
+void reset_stats() {
+    for (auto& c : trace::g_counters) {
+        c.calls.store(0, std::memory_order_relaxed);
+        c.total_ns.store(0, std::memory_order_relaxed);
+        c.max_ns.store(0, std::memory_order_relaxed);
+    }
+}
+
+#else
+
+Stats stats() {
+    return Stats{};
+}
+
+void reset_stats() {}
+
+#endif // ARCHSPEC_TRACE
+
+} // namespace archspec
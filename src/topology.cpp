@@ -0,0 +1,425 @@
+// This file is a part of Julia. License is MIT: https://julialang.org/license
+
+#include "archspec/topology.hpp"
+#include "archspec/cpuid.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if defined(__APPLE__)
+#include <sys/types.h>
+#include <sys/sysctl.h>
+#endif
+
+namespace archspec {
+
+const CacheInfo* CpuTopology::cache(int level, CacheType type) const {
+    for (const auto& c : caches) {
+        if (c.level == level && c.type == type)
+            return &c;
+    }
+    return nullptr;
+}
+
+uint64_t CpuTopology::data_cache_size(int level) const {
+    for (const auto& c : caches) {
+        if (c.level == level && c.type != CacheType::Instruction)
+            return c.size;
+    }
+    return 0;
+}
+
+namespace {
+
+bool parse_int(std::string_view s, int& out) {
+    auto result = std::from_chars(s.data(), s.data() + s.size(), out);
+    return result.ec == std::errc() && result.ptr == s.data() + s.size();
+}
+
+std::string_view trim(std::string_view s) {
+    size_t start = s.find_first_not_of(" \t\r\n");
+    if (start == std::string_view::npos)
+        return {};
+    size_t end = s.find_last_not_of(" \t\r\n");
+    return s.substr(start, end - start + 1);
+}
+
+// Order caches by level and type; stable, so each kind keeps the order of the first CPU it
+// serves
+void sort_caches(std::vector<CacheInfo>& caches) {
+    std::stable_sort(caches.begin(), caches.end(), [](const CacheInfo& a, const CacheInfo& b) {
+        return std::tie(a.level, a.type) < std::tie(b.level, b.type);
+    });
+}
+
+[[maybe_unused]] bool same_kind(const CacheInfo& a, const CacheInfo& b) {
+    return a.level == b.level && a.type == b.type && a.size == b.size &&
+           a.line_size == b.line_size && a.ways == b.ways && a.sets == b.sets &&
+           a.sharing == b.sharing;
+}
+
+// Count the instances of CPUID-derived caches, which each report how many logical CPUs they
+// serve but not which ones
+void count_instances(CpuTopology& topo) {
+    for (auto& c : topo.caches) {
+        if (c.sharing > 0 && topo.logical_cpus > 0)
+            c.instances = (topo.logical_cpus + c.sharing - 1) / c.sharing;
+    }
+}
+
+} // anonymous namespace
+
+std::vector<int> parse_cpu_list(std::string_view list) {
+    std::vector<int> cpus;
+    list = trim(list);
+    while (!list.empty()) {
+        size_t comma = list.find(',');
+        std::string_view item = trim(list.substr(0, comma));
+        list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+
+        size_t dash = item.find('-');
+        int first = 0;
+        int last = 0;
+        if (dash == std::string_view::npos) {
+            if (!parse_int(item, first))
+                continue;
+            last = first;
+        } else if (!parse_int(item.substr(0, dash), first) ||
+                   !parse_int(item.substr(dash + 1), last) || first < 0 || last < first) {
+            continue;
+        }
+        for (int cpu = first; cpu <= last; ++cpu)
+            cpus.push_back(cpu);
+    }
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+CpuTopology detect_topology_from_cpuid() {
+    CpuTopology topo;
+    if (!Cpuid::is_supported())
+        return topo;
+    Cpuid cpuid;
+    uint32_t basic = cpuid.highest_basic_function();
+    uint32_t extended = cpuid.highest_extended_function();
+    bool amd = cpuid.vendor() == "AuthenticAMD" || cpuid.vendor() == "HygonGenuine";
+
+    // Deterministic cache parameters: same layout in both leaves. AMD only has leaf 4 as a
+    // reserved leaf; its copy needs the TopologyExtensions bit.
+    uint32_t cache_leaf = 0;
+    if (amd && extended >= 0x8000001D && (cpuid.query(0x80000001).ecx & (1u << 22)))
+        cache_leaf = 0x8000001D;
+    else if (!amd && basic >= 4)
+        cache_leaf = 4;
+    for (uint32_t sub = 0; cache_leaf && sub < 16; ++sub) {
+        CpuidRegisters r = cpuid.query(cache_leaf, sub);
+        uint32_t type = r.eax & 0x1f;
+        if (type == 0)
+            break;
+        if (type > 3)
+            continue;
+        CacheInfo c;
+        c.level = static_cast<int>((r.eax >> 5) & 0x7);
+        c.type = type == 1 ? CacheType::Data
+                           : (type == 2 ? CacheType::Instruction : CacheType::Unified);
+        c.sharing = ((r.eax >> 14) & 0xfff) + 1;
+        c.line_size = (r.ebx & 0xfff) + 1;
+        uint32_t partitions = ((r.ebx >> 12) & 0x3ff) + 1;
+        c.ways = ((r.ebx >> 22) & 0x3ff) + 1;
+        c.sets = r.ecx + 1;
+        c.size = uint64_t(c.ways) * partitions * c.line_size * c.sets;
+        topo.caches.push_back(c);
+    }
+    sort_caches(topo.caches);
+
+    // SMT width and logical CPUs per package from the extended topology leaves
+    uint32_t smt = 0;
+    uint32_t per_package = 0;
+    for (uint32_t leaf : {0x1Fu, 0xBu}) {
+        if (basic < leaf || ((cpuid.query(leaf, 0).ecx >> 8) & 0xff) == 0)
+            continue;
+        for (uint32_t sub = 0; sub < 8; ++sub) {
+            CpuidRegisters r = cpuid.query(leaf, sub);
+            uint32_t level_type = (r.ecx >> 8) & 0xff;
+            if (level_type == 0)
+                break;
+            if (level_type == 1)
+                smt = r.ebx & 0xffff;
+            per_package = r.ebx & 0xffff; // The last level spans the package
+        }
+        break;
+    }
+    if (per_package == 0 && amd && extended >= 0x80000008) {
+        per_package = (cpuid.query(0x80000008).ecx & 0xff) + 1;
+        if (extended >= 0x8000001E)
+            smt = ((cpuid.query(0x8000001E).ebx >> 8) & 0xff) + 1;
+    }
+
+    topo.logical_cpus = std::thread::hardware_concurrency();
+    if (topo.logical_cpus == 0)
+        topo.logical_cpus = per_package;
+    topo.threads_per_core = std::max(smt, 1u);
+    topo.physical_cores = std::max(topo.logical_cpus / topo.threads_per_core, 1u);
+    topo.packages = per_package ? std::max(topo.logical_cpus / per_package, 1u) : 1;
+    count_instances(topo);
+    return topo;
+}
+
+#if defined(__linux__)
+namespace {
+
+// Contents of a small sysfs file without surrounding whitespace; empty if it is missing
+std::string read_sysfs(const std::string& path) {
+    char buffer[4096];
+    size_t size = 0;
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return {};
+    while (size < sizeof(buffer)) {
+        ssize_t n = ::read(fd, buffer + size, sizeof(buffer) - size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        size += static_cast<size_t>(n);
+    }
+    ::close(fd);
+    return std::string(trim(std::string_view(buffer, size)));
+}
+
+uint32_t read_sysfs_uint(const std::string& path) {
+    std::string value = read_sysfs(path);
+    uint32_t result = 0;
+    std::from_chars(value.data(), value.data() + value.size(), result);
+    return result;
+}
+
+// Cache sizes are written as "48K", "2048K" or "32M"
+uint64_t parse_cache_size(std::string_view s) {
+    uint64_t size = 0;
+    auto result = std::from_chars(s.data(), s.data() + s.size(), size);
+    std::string_view suffix(result.ptr, static_cast<size_t>(s.data() + s.size() - result.ptr));
+    if (suffix == "K")
+        size <<= 10;
+    else if (suffix == "M")
+        size <<= 20;
+    else if (suffix == "G")
+        size <<= 30;
+    return size;
+}
+
+} // anonymous namespace
+
+CpuTopology detect_topology_from_sysfs(std::string_view root) {
+    CpuTopology topo;
+    const std::string cpu_dir = std::string(root) + "/devices/system/cpu/";
+    std::vector<int> online = parse_cpu_list(read_sysfs(cpu_dir + "online"));
+    if (online.empty())
+        return topo;
+    topo.logical_cpus = static_cast<uint32_t>(online.size());
+
+    std::set<int> packages;
+    // First SMT sibling -> index into topo.cores
+    std::unordered_map<int, size_t> core_of_first;
+    // Cache instances already counted, as (level, type, first CPU served)
+    std::set<std::tuple<int, CacheType, int>> seen_caches;
+    for (int cpu : online) {
+        const std::string dir = cpu_dir + "cpu" + std::to_string(cpu) + "/";
+
+        std::string package = read_sysfs(dir + "topology/physical_package_id");
+        int package_id = 0;
+        parse_int(package, package_id);
+        packages.insert(package_id);
+
+        std::vector<int> siblings =
+            parse_cpu_list(read_sysfs(dir + "topology/thread_siblings_list"));
+        if (siblings.empty())
+            siblings.push_back(cpu);
+        if (core_of_first.emplace(siblings.front(), topo.cores.size()).second)
+            topo.cores.push_back(std::move(siblings));
+
+        for (int index = 0;; ++index) {
+            const std::string cache_dir = dir + "cache/index" + std::to_string(index) + "/";
+            std::string type = read_sysfs(cache_dir + "type");
+            if (type.empty())
+                break;
+            CacheInfo c;
+            c.level = static_cast<int>(read_sysfs_uint(cache_dir + "level"));
+            if (type == "Data")
+                c.type = CacheType::Data;
+            else if (type == "Instruction")
+                c.type = CacheType::Instruction;
+            else
+                c.type = CacheType::Unified;
+
+            std::vector<int> shared = parse_cpu_list(read_sysfs(cache_dir + "shared_cpu_list"));
+            if (shared.empty())
+                shared.push_back(cpu);
+            if (!seen_caches.emplace(c.level, c.type, shared.front()).second)
+                continue;
+
+            c.size = parse_cache_size(read_sysfs(cache_dir + "size"));
+            c.line_size = read_sysfs_uint(cache_dir + "coherency_line_size");
+            c.ways = read_sysfs_uint(cache_dir + "ways_of_associativity");
+            c.sets = read_sysfs_uint(cache_dir + "number_of_sets");
+            c.sharing = static_cast<uint32_t>(shared.size());
+            c.instances = 1;
+            auto it = std::find_if(topo.caches.begin(), topo.caches.end(),
+                                   [&](const CacheInfo& kind) { return same_kind(kind, c); });
+            if (it != topo.caches.end())
+                ++it->instances;
+            else
+                topo.caches.push_back(c);
+        }
+    }
+    sort_caches(topo.caches);
+
+    topo.packages = static_cast<uint32_t>(packages.size());
+    topo.physical_cores = static_cast<uint32_t>(topo.cores.size());
+    for (const auto& core : topo.cores)
+        topo.threads_per_core = std::max(topo.threads_per_core, uint32_t(core.size()));
+
+    const std::string node_dir = std::string(root) + "/devices/system/node/";
+    for (int node : parse_cpu_list(read_sysfs(node_dir + "online"))) {
+        std::vector<int> cpus =
+            parse_cpu_list(read_sysfs(node_dir + "node" + std::to_string(node) + "/cpulist"));
+        if (!cpus.empty())
+            topo.numa_nodes.push_back(std::move(cpus));
+    }
+    // Kernels built without NUMA support have no node directory
+    if (topo.numa_nodes.empty())
+        topo.numa_nodes.push_back(online);
+    return topo;
+}
+#endif
+
+#if defined(__APPLE__)
+namespace {
+
+uint64_t sysctl_u64(const char* name) {
+    uint64_t value = 0;
+    size_t size = sizeof(value);
+    if (sysctlbyname(name, &value, &size, nullptr, 0) != 0)
+        return 0;
+    // Some entries are 32-bit; the value was written to the low bytes on little-endian hosts
+    return size == sizeof(uint32_t) ? uint32_t(value) : value;
+}
+
+CpuTopology detect_topology_from_sysctl() {
+    CpuTopology topo;
+    topo.logical_cpus = uint32_t(sysctl_u64("hw.logicalcpu"));
+    topo.physical_cores = uint32_t(sysctl_u64("hw.physicalcpu"));
+    topo.packages = std::max(uint32_t(sysctl_u64("hw.packages")), 1u);
+    if (topo.physical_cores > 0)
+        topo.threads_per_core = std::max(topo.logical_cpus / topo.physical_cores, 1u);
+
+    // hw.cacheconfig[i] is the number of logical CPUs sharing a level-i cache (0 is memory)
+    uint64_t config[8] = {};
+    size_t config_size = sizeof(config);
+    if (sysctlbyname("hw.cacheconfig", config, &config_size, nullptr, 0) != 0)
+        config_size = 0;
+    auto sharing = [&](int level) {
+        return size_t(level) < config_size / sizeof(uint64_t) ? uint32_t(config[level]) : 0u;
+    };
+
+    uint32_t line = uint32_t(sysctl_u64("hw.cachelinesize"));
+    const struct {
+        const char* name;
+        int level;
+        CacheType type;
+    } levels[] = {
+        {"hw.l1dcachesize", 1, CacheType::Data},
+        {"hw.l1icachesize", 1, CacheType::Instruction},
+        {"hw.l2cachesize", 2, CacheType::Unified},
+        {"hw.l3cachesize", 3, CacheType::Unified},
+    };
+    for (const auto& entry : levels) {
+        CacheInfo c;
+        c.size = sysctl_u64(entry.name);
+        if (c.size == 0)
+            continue;
+        c.level = entry.level;
+        c.type = entry.type;
+        c.line_size = line;
+        c.sharing = sharing(entry.level);
+        topo.caches.push_back(c);
+    }
+    count_instances(topo);
+
+    std::vector<int> cpus;
+    for (uint32_t cpu = 0; cpu < topo.logical_cpus; ++cpu)
+        cpus.push_back(int(cpu));
+    topo.numa_nodes.push_back(std::move(cpus));
+    return topo;
+}
+
+} // anonymous namespace
+#endif
+
+CpuTopology detect_topology() {
+    CpuTopology topo;
+#if defined(__linux__)
+    topo = detect_topology_from_sysfs();
+    if (topo.logical_cpus > 0 && topo.caches.empty()) {
+        // Some virtual machines and older kernels expose no cache directories
+        topo.caches = detect_topology_from_cpuid().caches;
+        count_instances(topo);
+    }
+#elif defined(__APPLE__)
+    topo = detect_topology_from_sysctl();
+#endif
+    if (topo.logical_cpus == 0)
+        topo = detect_topology_from_cpuid();
+    if (topo.logical_cpus == 0) {
+        topo.logical_cpus = std::max(std::thread::hardware_concurrency(), 1u);
+        topo.physical_cores = topo.logical_cpus;
+        topo.packages = 1;
+        topo.threads_per_core = 1;
+    }
+    return topo;
+}
+
+namespace {
+
+std::once_flag g_topology_once;
+std::atomic<const CpuTopology*> g_topology{nullptr};
+
+// Every topology ever published is kept so references handed out earlier stay valid
+std::mutex g_topology_mutex;
+std::vector<std::unique_ptr<CpuTopology>> g_topologies;
+
+void publish_topology() {
+    auto topo = std::make_unique<CpuTopology>(detect_topology());
+    std::lock_guard<std::mutex> lock(g_topology_mutex);
+    g_topology.store(topo.get(), std::memory_order_release);
+    g_topologies.push_back(std::move(topo));
+}
+
+} // anonymous namespace
+
+const CpuTopology& topology_cached() {
+    std::call_once(g_topology_once, publish_topology);
+    return *g_topology.load(std::memory_order_acquire);
+}
+
+void refresh_topology() {
+    // Publish first so topology_cached() never observes a completed once_flag without a result
+    publish_topology();
+    std::call_once(g_topology_once, [] {});
+}
+
+} // namespace archspec
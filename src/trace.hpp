@@ -0,0 +1,74 @@
+// This file is a part of Julia. License is MIT: https://julialang.org/license
+//
+// Internal instrumentation hooks behind ARCHSPEC_TRACE. Without it ARCHSPEC_TRACE_SCOPE
+// expands to nothing, so instrumented functions pay no cost.
+
+#ifndef ARCHSPEC_TRACE_HPP
+#define ARCHSPEC_TRACE_HPP
+
+#if defined(ARCHSPEC_TRACE)
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace archspec {
+namespace trace {
+
+enum Counter {
+    LoadEmbeddedData,
+    DetectCpuInfo,
+    CompatibleMicroarchitectures,
+    Host,
+    OptimizationFlags,
+    CounterCount,
+};
+
+struct AtomicCounter {
+    std::atomic<uint64_t> calls{0};
+    std::atomic<uint64_t> total_ns{0};
+    std::atomic<uint64_t> max_ns{0};
+};
+
+extern AtomicCounter g_counters[CounterCount];
+
+// Adds the lifetime of the scope to a counter
+class Scope {
+  public:
+    explicit Scope(Counter counter)
+        : counter_(counter), start_(std::chrono::steady_clock::now()) {}
+
+    ~Scope() {
+        auto elapsed = std::chrono::steady_clock::now() - start_;
+        uint64_t ns = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+
+        AtomicCounter& c = g_counters[counter_];
+        c.calls.fetch_add(1, std::memory_order_relaxed);
+        c.total_ns.fetch_add(ns, std::memory_order_relaxed);
+        uint64_t max = c.max_ns.load(std::memory_order_relaxed);
+        while (ns > max && !c.max_ns.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {
+        }
+    }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+  private:
+    Counter counter_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+} // namespace trace
+} // namespace archspec
+
+#define ARCHSPEC_TRACE_SCOPE(counter)                                                              \
+    ::archspec::trace::Scope archspec_trace_scope_(::archspec::trace::counter)
+
+#else
+
+#define ARCHSPEC_TRACE_SCOPE(counter) static_cast<void>(0)
+
+#endif // ARCHSPEC_TRACE
+
+#endif // ARCHSPEC_TRACE_HPP
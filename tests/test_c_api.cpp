@@ -0,0 +1,283 @@
+// This file is a part of Julia. License is MIT: https://julialang.org/license
+//
+// Unit tests for the C API
+
+#include "test_common.hpp"
+#include <archspec/archspec.hpp>
+#include <archspec/archspec_c.h>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using namespace archspec;
+
+TEST(host_name) {
+    const char* name = archspec_host_name();
+    ASSERT(name != nullptr);
+    ASSERT_EQ(std::string(name), host_cached().name());
+    ASSERT(archspec_host_name() == name);
+    TEST_PASS();
+}
+
+TEST(target_names) {
+    size_t count = archspec_target_count();
+    ASSERT_EQ(count, MicroarchitectureDatabase::instance().all().size());
+    for (size_t i = 0; i < count; ++i) {
+        const char* name = archspec_target_name(i);
+        ASSERT(name != nullptr);
+        ASSERT(archspec_target_exists(name));
+    }
+    ASSERT(archspec_target_name(count) == nullptr);
+    TEST_PASS();
+}
+
+TEST(get_features) {
+    char* features = archspec_get_features("haswell");
+    ASSERT(features != nullptr);
+    ASSERT(std::strstr(features, "avx2") != nullptr);
+    archspec_free(features);
+    ASSERT(archspec_get_features("nonexistent_cpu_12345") == nullptr);
+    ASSERT(archspec_get_features(nullptr) == nullptr);
+    TEST_PASS();
+}
+
+TEST(static_strings) {
+    const char* features = archspec_get_features_static("haswell");
+    ASSERT(features != nullptr);
+    ASSERT(archspec_get_features_static("haswell") == features);
+
+    char* allocated = archspec_get_features("haswell");
+    ASSERT(allocated != nullptr);
+    ASSERT_EQ(std::string(features), std::string(allocated));
+    archspec_free(allocated);
+
+    const char* flags = archspec_get_flags_static("haswell", "gcc");
+    allocated = archspec_get_flags("haswell", "gcc");
+    ASSERT(flags != nullptr);
+    ASSERT(allocated != nullptr);
+    ASSERT_EQ(std::string(flags), std::string(allocated));
+    archspec_free(allocated);
+
+    ASSERT(archspec_get_features_static("nonexistent_cpu_12345") == nullptr);
+    ASSERT(archspec_get_flags_static("haswell", "nonexistent_compiler") == nullptr);
+
+    allocated = archspec_host_features();
+    ASSERT(allocated != nullptr);
+    ASSERT_EQ(std::string(archspec_host_features_static()), std::string(allocated));
+    archspec_free(allocated);
+    TEST_PASS();
+}
+
+TEST(into_buffers) {
+    const char* expected = archspec_get_features_static("haswell");
+    ASSERT(expected != nullptr);
+    size_t full = std::strlen(expected) + 1;
+
+    // Size query only
+    size_t needed = 0;
+    ASSERT_EQ(archspec_get_features_into("haswell", nullptr, 0, &needed), 0);
+    ASSERT_EQ(needed, full);
+
+    // Exact fit
+    std::vector<char> buf(full);
+    ASSERT_EQ(archspec_get_features_into("haswell", buf.data(), buf.size(), &needed), 1);
+    ASSERT_EQ(std::string(buf.data()), std::string(expected));
+
+    // Truncation keeps a NUL-terminated prefix
+    char small[8];
+    ASSERT_EQ(archspec_get_features_into("haswell", small, sizeof(small), &needed), 0);
+    ASSERT_EQ(std::strlen(small), sizeof(small) - 1);
+    ASSERT_EQ(needed, full);
+
+    // Missing target
+    ASSERT_EQ(archspec_get_features_into("nonexistent_cpu_12345", small, sizeof(small), &needed),
+              0);
+    ASSERT_EQ(needed, 0u);
+    ASSERT_EQ(small[0], '\0');
+
+    char flags[256];
+    ASSERT_EQ(archspec_get_flags_into("haswell", "gcc", flags, sizeof(flags), nullptr), 1);
+    ASSERT_EQ(std::string(flags), std::string(archspec_get_flags_static("haswell", "gcc")));
+
+    char host[4096];
+    ASSERT_EQ(archspec_host_features_into(host, sizeof(host), &needed), 1);
+    ASSERT_EQ(std::string(host), std::string(archspec_host_features_static()));
+    TEST_PASS();
+}
+
+// Loads into the database after first use must show through every variant
+TEST(strings_follow_loads) {
+    auto& db = archspec::MicroarchitectureDatabase::instance();
+    size_t count = archspec_target_count();
+    const char* haswell = archspec_get_features_static("haswell");
+    ASSERT(archspec_get_features_static("c_api_site") == nullptr);
+
+    ASSERT(db.load_from_string(R"({"microarchitectures": {
+        "c_api_site": {"from": ["haswell"], "vendor": "GenuineIntel",
+                       "features": ["avx2", "fma", "sitefeature"],
+                       "compilers": {"gcc": [{"versions": ":", "flags": "-march=site"}]}}
+    }})"));
+    ASSERT_EQ(archspec_target_count(), count + 1);
+    const char* before = archspec_get_features_static("c_api_site");
+    ASSERT(before != nullptr);
+    ASSERT_EQ(std::string(before), "avx2,fma,sitefeature");
+    ASSERT(archspec_get_features_static("haswell") == haswell); // unchanged entries are kept
+
+    // Replacing the target in place updates all of its strings
+    ASSERT(db.load_overlay(R"({"microarchitectures": {
+        "c_api_site": {"from": ["haswell"], "vendor": "GenuineIntel", "features": ["avx2"],
+                       "compilers": {"gcc": [{"versions": ":", "flags": "-march=site2"}]}}
+    }})"));
+    char* features = archspec_get_features("c_api_site");
+    ASSERT_EQ(std::string(features), "avx2");
+    archspec_free(features);
+    ASSERT_EQ(std::string(archspec_get_features_static("c_api_site")), "avx2");
+    char buf[64];
+    ASSERT_EQ(archspec_get_features_into("c_api_site", buf, sizeof(buf), nullptr), 1);
+    ASSERT_EQ(std::string(buf), "avx2");
+    char* flags = archspec_get_flags("c_api_site", "gcc");
+    ASSERT_EQ(std::string(flags), "-march=site2");
+    archspec_free(flags);
+    ASSERT_EQ(std::string(archspec_get_flags_static("c_api_site", "gcc")), "-march=site2");
+    ASSERT_EQ(archspec_get_flags_into("c_api_site", "gcc", buf, sizeof(buf), nullptr), 1);
+    ASSERT_EQ(std::string(buf), "-march=site2");
+
+    // Pointers handed out earlier stay valid with their old value
+    ASSERT_EQ(std::string(before), "avx2,fma,sitefeature");
+    TEST_PASS();
+}
+
+TEST(has_feature) {
+    ASSERT_EQ(archspec_has_feature("haswell", "avx2"), 1);
+    ASSERT_EQ(archspec_has_feature("haswell", "avx512f"), 0);
+    ASSERT_EQ(archspec_has_feature("nonexistent_cpu_12345", "avx2"), 0);
+    ASSERT_EQ(archspec_host_has_feature("nonexistent_feature_12345"), 0);
+    TEST_PASS();
+}
+
+TEST(feature_index) {
+    char* with = archspec_targets_with("avx2,fma");
+    ASSERT(with != nullptr);
+    std::string list = std::string(",") + with + ",";
+    ASSERT(list.find(",haswell,") != std::string::npos);
+    ASSERT(list.find(",ivybridge,") == std::string::npos);
+    archspec_free(with);
+
+    char* without = archspec_targets_without("avx512f");
+    list = std::string(",") + without + ",";
+    ASSERT(list.find(",haswell,") != std::string::npos);
+    ASSERT(list.find(",skylake_avx512,") == std::string::npos);
+    archspec_free(without);
+
+    char* minimal = archspec_minimal_target("avx2,,fma", "x86_64");
+    ASSERT_EQ(std::string(minimal), "x86_64_v3");
+    archspec_free(minimal);
+    ASSERT(archspec_minimal_target("avx2", "aarch64") == nullptr);
+
+    char* diff = archspec_feature_diff("haswell", "ivybridge");
+    ASSERT(diff != nullptr);
+    ASSERT(std::string(diff).find("avx2") != std::string::npos);
+    archspec_free(diff);
+    diff = archspec_feature_diff("ivybridge", "haswell");
+    ASSERT_EQ(std::string(diff), "");
+    archspec_free(diff);
+    ASSERT(archspec_feature_diff("haswell", "nonexistent_cpu_12345") == nullptr);
+    ASSERT(archspec_targets_with(nullptr) == nullptr);
+    TEST_PASS();
+}
+
+// Concurrent first use must not race; every thread sees the same static strings
+TEST(concurrent_queries) {
+    const size_t n = 8;
+    std::vector<const char*> names(n, nullptr);
+    std::vector<const char*> vendors(n, nullptr);
+    std::vector<size_t> counts(n, 0);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < n; ++i) {
+        threads.emplace_back([&, i] {
+            names[i] = archspec_host_name();
+            vendors[i] = archspec_host_vendor();
+            counts[i] = archspec_target_count();
+            for (int k = 0; k < 100; ++k)
+                archspec_host_has_feature("sse2");
+        });
+    }
+    for (auto& t : threads)
+        t.join();
+    for (size_t i = 1; i < n; ++i) {
+        ASSERT(names[i] == names[0]);
+        ASSERT(vendors[i] == vendors[0]);
+        ASSERT_EQ(counts[i], counts[0]);
+    }
+    TEST_PASS();
+}
+
+// Test that the C snapshot mirrors archspec::stats()
+TEST(get_stats) {
+    archspec_get_stats(nullptr); // Must not crash
+
+    archspec_stats c_stats;
+    std::memset(&c_stats, 0xff, sizeof(c_stats));
+    archspec_get_stats(&c_stats);
+    archspec::Stats s = archspec::stats();
+
+    ASSERT_EQ(c_stats.enabled, s.enabled ? 1 : 0);
+    ASSERT(c_stats.host.calls <= s.host.calls);
+    ASSERT(c_stats.detect_cpu_info.calls <= s.detect_cpu_info.calls);
+    if (!s.enabled) {
+        ASSERT_EQ(c_stats.host.calls, uint64_t(0));
+        ASSERT_EQ(c_stats.load_embedded_data.total_ns, uint64_t(0));
+    }
+    TEST_PASS();
+}
+
+// Test that the C topology mirrors archspec::topology_cached()
+TEST(host_topology) {
+    ASSERT_EQ(archspec_host_topology(nullptr), 0);
+
+    archspec_topology c_topo;
+    std::memset(&c_topo, 0xff, sizeof(c_topo));
+    ASSERT_EQ(archspec_host_topology(&c_topo), 1);
+    const archspec::CpuTopology& topo = archspec::topology_cached();
+    ASSERT_EQ(c_topo.logical_cpus, topo.logical_cpus);
+    ASSERT_EQ(c_topo.physical_cores, topo.physical_cores);
+    ASSERT_EQ(c_topo.threads_per_core, topo.threads_per_core);
+    ASSERT_EQ(size_t(c_topo.numa_nodes), topo.numa_nodes.size());
+    ASSERT(c_topo.cache_count <= ARCHSPEC_MAX_CACHES);
+    ASSERT(c_topo.cache_count == ARCHSPEC_MAX_CACHES || c_topo.cache_count == topo.caches.size());
+    for (uint32_t i = 0; i < c_topo.cache_count; ++i) {
+        ASSERT_EQ(c_topo.caches[i].level, topo.caches[i].level);
+        ASSERT_EQ(c_topo.caches[i].size, topo.caches[i].size);
+    }
+    for (uint32_t i = c_topo.cache_count; i < ARCHSPEC_MAX_CACHES; ++i)
+        ASSERT_EQ(c_topo.caches[i].size, uint64_t(0));
+
+    ASSERT_EQ(archspec_host_cache_size(2), topo.data_cache_size(2));
+    ASSERT_EQ(archspec_host_cache_size(0), uint64_t(0));
+    TEST_PASS();
+}
+
+int main() {
+    std::cout << "=== archspec_cpp C API Tests ===" << std::endl;
+    std::cout << std::endl;
+
+    // Run first so that it exercises concurrent initialization
+    RUN_TEST(concurrent_queries);
+    RUN_TEST(host_name);
+    RUN_TEST(target_names);
+    RUN_TEST(get_features);
+    RUN_TEST(static_strings);
+    RUN_TEST(into_buffers);
+    RUN_TEST(has_feature);
+    RUN_TEST(feature_index);
+    RUN_TEST(get_stats);
+    RUN_TEST(host_topology);
+    RUN_TEST(strings_follow_loads);
+
+    std::cout << std::endl;
+    std::cout << "=== Results ===" << std::endl;
+    std::cout << "Passed: " << g_tests_passed << std::endl;
+    std::cout << "Failed: " << g_tests_failed << std::endl;
+
+    return g_tests_failed > 0 ? 1 : 0;
+}
@@ -5,6 +5,7 @@
 #include "test_common.hpp"
 #include <archspec/cpuid.hpp>
 #include <archspec/detect.hpp>
+#include <algorithm>
 
 using namespace archspec;
 
@@ -166,6 +167,117 @@ TEST(feature_consistency) {
     TEST_PASS();
 }
 
+// Every feature an x86_64 target requires has a CPUID decoder
+TEST(known_features_cover_database) {
+    const auto& known = Cpuid::known_features();
+    for (const auto& [name, target] : MicroarchitectureDatabase::instance().all()) {
+        if (target.family() != ARCH_X86_64)
+            continue;
+        for (const auto& feature : target.features()) {
+            if (known.count(feature) == 0) {
+                std::cout << "(" << name << " needs " << feature << ") ";
+                ASSERT(false);
+            }
+        }
+    }
+    TEST_PASS();
+}
+
+// Feature masking for each XCR0 state component
+TEST(os_disabled_features) {
+    std::set<std::string> features = {"sse4_2", "gfni", "xsave", "xsaveopt", "avx", "avx2",
+                                      "fma", "vaes", "avx512f", "avx512bw", "avx512_bf16",
+                                      "amx_tile", "amx_int8"};
+    OsXsaveState state;
+    state.osxsave = true;
+    state.xcr0 = 0x600e7; // x87, SSE, AVX, AVX-512 and tile state
+    state.amx_permitted = true;
+    ASSERT(Cpuid::os_disabled(features, state).empty());
+
+    state.amx_permitted = false;
+    std::set<std::string> disabled = Cpuid::os_disabled(features, state);
+    ASSERT((disabled == std::set<std::string>{"amx_int8", "amx_tile"}));
+
+    state.xcr0 = 0x7; // No AVX-512 state, as under some hypervisors
+    disabled = Cpuid::os_disabled(features, state);
+    ASSERT_EQ(disabled.size(), 5u);
+    ASSERT(disabled.count("avx512bw") && disabled.count("avx512_bf16"));
+    ASSERT(!disabled.count("avx2"));
+
+    state.xcr0 = 0x3; // SSE only
+    disabled = Cpuid::os_disabled(features, state);
+    ASSERT(disabled.count("avx") && disabled.count("fma") && disabled.count("vaes"));
+    ASSERT(!disabled.count("gfni") && !disabled.count("xsave"));
+
+    state.osxsave = false;
+    state.xcr0 = 0x600e7; // Ignored without OSXSAVE
+    disabled = Cpuid::os_disabled(features, state);
+    ASSERT_EQ(disabled.size(), features.size() - 2);
+    ASSERT(!disabled.count("sse4_2") && !disabled.count("gfni"));
+    TEST_PASS();
+}
+
+// Usable features are the raw ones less what the host OS state masks
+TEST(usable_features) {
+    if (!Cpuid::is_supported()) {
+        std::cout << "(skipped - not x86) ";
+        TEST_PASS();
+    }
+
+    Cpuid cpuid;
+    const OsXsaveState& state = Cpuid::host_os_state();
+    ASSERT(&state == &Cpuid::host_os_state());
+    ASSERT_EQ(cpuid.os_state().xcr0, state.xcr0);
+    if (state.osxsave)
+        ASSERT((state.xcr0 & 0x3) == 0x3); // x87 and SSE state are always enabled
+
+    std::set<std::string> disabled = Cpuid::os_disabled(cpuid.raw_features(), state);
+    ASSERT_EQ(cpuid.features().size() + disabled.size(), cpuid.raw_features().size());
+    for (const auto& name : cpuid.features())
+        ASSERT(cpuid.raw_features().count(name) && !disabled.count(name));
+
+    DetectedCpuInfo info = detect_cpu_info(DetectionMethod::Cpuid);
+    ASSERT(info.disabled_features == disabled);
+    std::cout << "(XCR0 0x" << std::hex << state.xcr0 << std::dec << ", " << disabled.size()
+              << " masked) ";
+    TEST_PASS();
+}
+
+// CPUID and the operating system should agree on the host target
+TEST(detection_method_parity) {
+    if (!Cpuid::is_supported()) {
+        std::cout << "(skipped - not x86) ";
+        TEST_PASS();
+    }
+
+    DetectedCpuInfo os_info = detect_cpu_info(DetectionMethod::OperatingSystem);
+    DetectedCpuInfo cpuid_info = detect_cpu_info(DetectionMethod::Cpuid);
+    ASSERT_EQ(os_info.vendor, cpuid_info.vendor);
+
+    // Compare only the features the database knows about
+    FeatureMask os_mask = os_info.feature_mask();
+    FeatureMask cpuid_mask = cpuid_info.feature_mask();
+    const auto& db = MicroarchitectureDatabase::instance();
+    for (const auto& feature : Cpuid::known_features()) {
+        auto id = db.feature_id(feature);
+        if (id && os_mask.test(*id) != cpuid_mask.test(*id))
+            std::cout << "(" << feature << (os_mask.test(*id) ? " only in OS" : " only in CPUID")
+                      << ") ";
+    }
+
+    auto os_targets = compatible_microarchitectures(os_info);
+    auto cpuid_targets = compatible_microarchitectures(cpuid_info);
+    auto best = [](const std::vector<const Microarchitecture*>& candidates) {
+        return (*std::max_element(candidates.begin(), candidates.end(),
+                                  compare_microarch_specificity))
+            ->name();
+    };
+    ASSERT(!os_targets.empty() && !cpuid_targets.empty());
+    std::cout << "(OS: " << best(os_targets) << ", CPUID: " << best(cpuid_targets) << ") ";
+    ASSERT_EQ(best(os_targets), best(cpuid_targets));
+    TEST_PASS();
+}
+
 int main() {
     std::cout << "=== archspec_cpp CPUID Tests ===" << std::endl;
     std::cout << std::endl;
@@ -177,6 +289,10 @@ int main() {
     RUN_TEST(brand_string_cpuid);
     RUN_TEST(cpuid_query);
     RUN_TEST(feature_consistency);
+    RUN_TEST(known_features_cover_database);
+    RUN_TEST(os_disabled_features);
+    RUN_TEST(usable_features);
+    RUN_TEST(detection_method_parity);
 
     std::cout << std::endl;
     std::cout << "=== Results ===" << std::endl;
@@ -4,6 +4,10 @@
 
 #include "test_common.hpp"
 #include <archspec/archspec.hpp>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
 
 using namespace archspec;
 
@@ -36,6 +40,12 @@ TEST(detect_cpu_info) {
     else if (machine == ARCH_AARCH64) {
         std::cout << "(vendor: " << info.vendor << ") ";
     }
+
+    // Whatever the OS has not enabled is kept apart, never reported as usable
+    for (const auto& name : info.disabled_features)
+        ASSERT(!info.features.count(name));
+    if (machine != ARCH_X86_64)
+        ASSERT(info.disabled_features.empty());
     TEST_PASS();
 }
 
@@ -81,6 +91,61 @@ TEST(compatible_microarchitectures) {
     TEST_PASS();
 }
 
+// Test that the interned mask agrees with the detected feature names
+TEST(detected_feature_mask) {
+    DetectedCpuInfo info = detect_cpu_info();
+    const auto& db = MicroarchitectureDatabase::instance();
+    FeatureMask mask = info.feature_mask();
+
+    size_t known = 0;
+    for (const auto& f : info.features) {
+        if (auto id = db.feature_id(f)) {
+            ASSERT(mask.test(*id));
+            known++;
+        }
+    }
+    ASSERT_EQ(mask.count(), known);
+
+    // Mask-based checks must select the same targets as the string-based ones
+    for (const auto& [name, target] : db.all()) {
+        ASSERT_EQ(compatibility::check_x86_64(info, mask, target),
+                  compatibility::check_x86_64(info, target));
+    }
+    TEST_PASS();
+}
+
+// Test cached host detection
+TEST(host_cached) {
+    const Microarchitecture& cached = host_cached();
+    ASSERT(cached.valid());
+    ASSERT_EQ(cached.name(), host().name());
+    ASSERT(&cached == &host_cached());
+    ASSERT_EQ(host_cpu_info_cached().vendor, detect_cpu_info().vendor);
+
+    // Concurrent callers all observe the same snapshot
+    std::vector<const Microarchitecture*> seen(8, nullptr);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < seen.size(); ++i)
+        threads.emplace_back([&seen, i] { seen[i] = &host_cached(); });
+    for (auto& t : threads)
+        t.join();
+    for (const auto* p : seen)
+        ASSERT(p == &cached);
+    TEST_PASS();
+}
+
+TEST(refresh_host) {
+    const Microarchitecture& before = host_cached();
+    std::string name = before.name();
+    refresh_host();
+    const Microarchitecture& after = host_cached();
+
+    // The old reference stays valid; the new snapshot resolves to the same target
+    ASSERT_EQ(before.name(), name);
+    ASSERT_EQ(after.name(), name);
+    TEST_PASS();
+}
+
 // Test brand string (if available)
 TEST(brand_string) {
     auto brand = brand_string();
@@ -152,6 +217,145 @@ TEST(host_features) {
     TEST_PASS();
 }
 
+// Test per-cluster detection of the host
+TEST(cpu_clusters) {
+    auto clusters = detect_cpu_clusters();
+    ASSERT(!clusters.empty());
+
+    size_t cpus = 0;
+    for (const auto& cluster : clusters) {
+        ASSERT(!cluster.cpus.empty());
+        ASSERT(!cluster.target.name().empty());
+        cpus += cluster.cpus.size();
+    }
+    std::cout << "(" << clusters.size() << " clusters, " << cpus << " cpus) ";
+
+    // Every cluster can run the common target
+    Microarchitecture common = common_microarchitecture(clusters);
+    for (const auto& cluster : clusters)
+        ASSERT(cluster.target >= common);
+    if (clusters.size() == 1)
+        ASSERT_EQ(common.name(), clusters.front().target.name());
+    TEST_PASS();
+}
+
+// The columnar scan selects exactly what the per-target checkers select
+TEST(compatible_table_parity) {
+    const auto& db = MicroarchitectureDatabase::instance();
+    for (std::string_view arch : {ARCH_X86_64, ARCH_AARCH64, ARCH_PPC64LE}) {
+        bool (*check)(const DetectedCpuInfo&, const Microarchitecture&) = nullptr;
+        if (arch == ARCH_X86_64)
+            check = compatibility::check_x86_64;
+        else if (arch == ARCH_AARCH64)
+            check = compatibility::check_aarch64;
+        else
+            check = compatibility::check_ppc64;
+        for (const auto& [name, source] : db.all()) {
+            for (const char* vendor : {"", "GenuineIntel", "AuthenticAMD", "ARM", "generic"}) {
+                DetectedCpuInfo info;
+                info.vendor = *vendor ? vendor : source.vendor();
+                info.features = source.features();
+                info.generation = source.generation();
+
+                std::vector<const Microarchitecture*> expected;
+                for (const auto& [_, target] : db.all()) {
+                    if (check(info, target))
+                        expected.push_back(&target);
+                }
+                if (expected.empty()) {
+                    if (auto generic = db.get(arch))
+                        expected.push_back(&generic->get());
+                }
+                ASSERT(compatible_microarchitectures(info, arch) == expected);
+            }
+        }
+    }
+    TEST_PASS();
+}
+
+// best_match() is the selection host() makes
+TEST(best_match_host) {
+    const Microarchitecture* best = best_match(host_cpu_info_cached(), get_machine());
+    ASSERT(best != nullptr);
+    ASSERT_EQ(best->name(), host_cached().name());
+    ASSERT(best_match(DetectedCpuInfo{}, "no-such-arch") == nullptr);
+    TEST_PASS();
+}
+
+// Vendor targets that do not descend from the best generic one are dropped, even when that
+// leaves only the generic target (a virtual CPU that masks a niche feature)
+TEST(best_match_prefers_generic_lineage) {
+    const auto& db = MicroarchitectureDatabase::instance();
+    DetectedCpuInfo info;
+    info.vendor = "GenuineIntel";
+    info.features = db.get("x86_64_v3")->get().features();
+    const Microarchitecture* best = best_match(info, ARCH_X86_64);
+    ASSERT(best != nullptr);
+    ASSERT_EQ(best->name(), "x86_64_v3");
+
+    std::ifstream in("extern/archspec/archspec/json/tests/targets/linux-rhel7-x86_64_v3");
+    ASSERT(in.is_open());
+    std::stringstream content;
+    content << in.rdbuf();
+    best = best_match(parse_cpuinfo(content.str(), ARCH_X86_64), ARCH_X86_64);
+    ASSERT(best != nullptr);
+    ASSERT_EQ(best->name(), "x86_64_v3");
+
+    // A vendor target above the generic one still wins
+    info.features = db.get("haswell")->get().features();
+    ASSERT_EQ(best_match(info, ARCH_X86_64)->name(), "haswell");
+    TEST_PASS();
+}
+
+// Batches agree with best_match() record by record, with and without threads
+TEST(resolve_batch) {
+    const auto& db = MicroarchitectureDatabase::instance();
+    for (std::string_view arch : {ARCH_X86_64, ARCH_AARCH64}) {
+        std::vector<DetectedCpuInfo> infos;
+        for (int copy = 0; copy < 3; ++copy) {
+            for (const auto& [name, target] : db.all()) {
+                if (!target.has_ancestor(arch))
+                    continue;
+                DetectedCpuInfo info;
+                info.vendor = target.vendor();
+                info.features = target.features();
+                info.cpu_part = target.cpu_part();
+                infos.push_back(info);
+            }
+        }
+        infos.push_back(DetectedCpuInfo{});
+
+        auto serial = resolve_batch(infos, arch);
+        auto threaded = resolve_batch(infos, arch, 4);
+        ASSERT_EQ(serial.size(), infos.size());
+        ASSERT(serial == threaded);
+        for (size_t i = 0; i < infos.size(); ++i)
+            ASSERT(serial[i] == best_match(infos[i], arch));
+    }
+
+    ASSERT(resolve_batch(nullptr, 0, ARCH_X86_64).empty());
+    TEST_PASS();
+}
+
+TEST(host_tuning) {
+    uint32_t vl = sve_vector_length();
+    bool sve = host_cpu_info_cached().features.count("sve") > 0;
+#if defined(__linux__) && defined(__aarch64__)
+    ASSERT_EQ(vl != 0, sve);
+#else
+    ASSERT_EQ(vl, 0u);
+#endif
+    if (vl) {
+        ASSERT(vl >= 128 && vl <= 2048 && vl % 128 == 0);
+        ASSERT_EQ(host_tuning().sve_vector_length, vl);
+    }
+    TuningHints hints = host_tuning();
+    hints.sve_vector_length = host_cached().tuning().sve_vector_length;
+    ASSERT(hints == host_cached().tuning());
+    (void)sve;
+    TEST_PASS();
+}
+
 int main() {
     std::cout << "=== archspec_cpp Detection Tests ===" << std::endl;
     std::cout << std::endl;
@@ -160,10 +364,19 @@ int main() {
     RUN_TEST(detect_cpu_info);
     RUN_TEST(host_detection);
     RUN_TEST(compatible_microarchitectures);
+    RUN_TEST(detected_feature_mask);
     RUN_TEST(brand_string);
     RUN_TEST(host_is_compatible);
+    RUN_TEST(host_cached);
+    RUN_TEST(refresh_host);
     RUN_TEST(host_optimization_flags);
     RUN_TEST(host_features);
+    RUN_TEST(cpu_clusters);
+    RUN_TEST(compatible_table_parity);
+    RUN_TEST(best_match_host);
+    RUN_TEST(best_match_prefers_generic_lineage);
+    RUN_TEST(resolve_batch);
+    RUN_TEST(host_tuning);
 
     std::cout << std::endl;
     std::cout << "=== Results ===" << std::endl;
@@ -0,0 +1,98 @@
+// This file is a part of Julia. License is MIT: https://julialang.org/license
+//
+// Unit tests for the runtime feature dispatch header
+
+#include "test_common.hpp"
+#include <archspec/archspec.hpp>
+#include <archspec/dispatch.hpp>
+#include <cstdint>
+
+using namespace archspec;
+
+TEST(generated_ids_match_database) {
+    const auto& db = MicroarchitectureDatabase::instance();
+    for (FeatureId id = 0; id < feat::kCount; ++id) {
+        auto interned = db.feature_id(feat::kNames[id]);
+        ASSERT(interned.has_value());
+        ASSERT_EQ(*interned, id);
+    }
+    ASSERT_EQ(db.feature_name(feat::avx2), std::string("avx2"));
+    ASSERT_EQ(db.feature_name(feat::_3dnow), std::string("3dnow"));
+    ASSERT_EQ(db.feature_name(feat::sse4_2), std::string("sse4_2"));
+    TEST_PASS();
+}
+
+TEST(host_mask_matches_detection) {
+    const FeatureMask& mask = host_feature_mask();
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(&mask) % 64, 0u);
+    ASSERT(&mask == &host_feature_mask());
+    ASSERT(mask == host_cpu_info_cached().feature_mask());
+
+    const auto& features = host_cpu_info_cached().features;
+    ASSERT_EQ(host_has<feat::avx2>(), features.count("avx2") > 0);
+    ASSERT_EQ(host_has<feat::asimd>(), features.count("asimd") > 0);
+    ASSERT_EQ(host_has(feat::sse2), features.count("sse2") > 0);
+    ASSERT_EQ((host_has_all<feat::avx2, feat::fma>()),
+              features.count("avx2") > 0 && features.count("fma") > 0);
+    ASSERT(host_has_all<>());
+    TEST_PASS();
+}
+
+TEST(mask_of_is_constexpr) {
+    constexpr FeatureMask mask = mask_of<feat::avx, feat::avx2>();
+    static_assert(mask.test(feat::avx) && mask.test(feat::avx2) && !mask.test(feat::sse2),
+                  "mask_of sets exactly the listed ids");
+    ASSERT_EQ(mask.count(), 2u);
+    TEST_PASS();
+}
+
+static int variant_baseline() {
+    return 0;
+}
+static int variant_host() {
+    return 1;
+}
+static int variant_impossible() {
+    return 2;
+}
+
+TEST(select_variant_order) {
+    using Fn = int (*)();
+    FeatureMask everything; // Includes ids no target uses, so no host has them all
+    for (FeatureId id = 0; id < FeatureMask::kCapacity; ++id)
+        everything.set(id);
+
+    const Variant<Fn> variants[] = {
+        {everything, variant_impossible},
+        {host_feature_mask(), variant_host},
+        {FeatureMask(), variant_baseline},
+    };
+    ASSERT(select_variant(variants) == variant_host);
+
+    const Variant<Fn> baseline_only[] = {
+        {everything, variant_impossible},
+        {FeatureMask(), variant_baseline},
+    };
+    ASSERT(select_variant(baseline_only) == variant_baseline);
+
+    const Variant<Fn> none[] = {{everything, variant_impossible}};
+    ASSERT(select_variant(none) == nullptr);
+    TEST_PASS();
+}
+
+int main() {
+    std::cout << "=== archspec_cpp Dispatch Tests ===" << std::endl;
+    std::cout << std::endl;
+
+    RUN_TEST(generated_ids_match_database);
+    RUN_TEST(host_mask_matches_detection);
+    RUN_TEST(mask_of_is_constexpr);
+    RUN_TEST(select_variant_order);
+
+    std::cout << std::endl;
+    std::cout << "=== Results ===" << std::endl;
+    std::cout << "Passed: " << g_tests_passed << std::endl;
+    std::cout << "Failed: " << g_tests_failed << std::endl;
+
+    return g_tests_failed > 0 ? 1 : 0;
+}
@@ -1,180 +1,31 @@
 // This file is a part of Julia. License is MIT: https://julialang.org/license
 //
 // Test CPU detection using fake /proc/cpuinfo files from archspec test data
+//
+// Extra fixture directories may be passed as arguments: test_fake_cpuinfo DIR...
 
 #include "test_common.hpp"
 #include <archspec/archspec.hpp>
+#include <archspec/cpuid.hpp>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
 #include <cstdlib>
 #include <filesystem>
 #include <fstream>
-#include <map>
 #include <set>
 #include <sstream>
+#include <thread>
 
 using namespace archspec;
 
 namespace fs = std::filesystem;
 
-// Parse cpuinfo content (similar to detect_from_proc_cpuinfo but takes string input)
-DetectedCpuInfo parse_cpuinfo_content(const std::string& content, const std::string& arch) {
-    DetectedCpuInfo info;
-
-    std::map<std::string, std::string> data;
-    std::istringstream stream(content);
-    std::string line;
-
-    while (std::getline(stream, line)) {
-        size_t colon = line.find(':');
-        if (colon == std::string::npos) {
-            if (!data.empty())
-                break;
-            continue;
-        }
-
-        // Trim key
-        std::string key = line.substr(0, colon);
-        size_t start = key.find_first_not_of(" \t");
-        size_t end = key.find_last_not_of(" \t");
-        if (start != std::string::npos) {
-            key = key.substr(start, end - start + 1);
-        }
-
-        // Trim value
-        std::string value = line.substr(colon + 1);
-        start = value.find_first_not_of(" \t");
-        end = value.find_last_not_of(" \t\r\n");
-        if (start != std::string::npos) {
-            value = value.substr(start, end - start + 1);
-        } else {
-            value = "";
-        }
-
-        data[key] = value;
-    }
-
-    if (arch == "x86_64" || arch == "i686" || arch == "i386") {
-        info.vendor = data.count("vendor_id") ? data["vendor_id"] : "generic";
-
-        // Parse flags
-        if (data.count("flags")) {
-            std::istringstream flags_stream(data["flags"]);
-            std::string flag;
-            while (flags_stream >> flag) {
-                info.features.insert(flag);
-            }
-        }
-
-        // ssse3 implies sse3 (Linux reports sse3 as "pni")
-        if (info.features.count("ssse3")) {
-            info.features.insert("sse3");
-        }
-    } else if (arch == "aarch64") {
-        // Get vendor from CPU implementer
-        if (data.count("CPU implementer")) {
-            const auto& db = MicroarchitectureDatabase::instance();
-            const auto& vendors = db.arm_vendors();
-            auto it = vendors.find(data["CPU implementer"]);
-            if (it != vendors.end()) {
-                info.vendor = it->second;
-            } else {
-                info.vendor = data["CPU implementer"];
-            }
-        } else {
-            info.vendor = "generic";
-        }
-
-        // Parse features
-        if (data.count("Features")) {
-            std::istringstream feat_stream(data["Features"]);
-            std::string feat;
-            while (feat_stream >> feat) {
-                info.features.insert(feat);
-            }
-        }
-
-        info.cpu_part = data.count("CPU part") ? data["CPU part"] : "";
-    } else if (arch == "ppc64le" || arch == "ppc64") {
-        // Parse POWER generation
-        if (data.count("cpu")) {
-            std::string cpu_str = data["cpu"];
-            size_t pos = cpu_str.find("POWER");
-            if (pos != std::string::npos) {
-                pos += 5; // Skip "POWER"
-                std::string gen_str;
-                while (pos < cpu_str.size() && std::isdigit(cpu_str[pos])) {
-                    gen_str += cpu_str[pos++];
-                }
-                if (!gen_str.empty()) {
-                    char* end = nullptr;
-                    long val = std::strtol(gen_str.c_str(), &end, 10);
-                    if (end != gen_str.c_str()) {
-                        info.generation = static_cast<int>(val);
-                    }
-                }
-            }
-        }
-    }
-
-    return info;
-}
-
-// Detect host from cpuinfo content
+// Resolve cpuinfo content through the same selection host() applies
 std::string detect_from_content(const std::string& content, const std::string& arch) {
-    DetectedCpuInfo info = parse_cpuinfo_content(content, arch);
-    auto candidates = compatible_microarchitectures(info, arch);
-
-    if (candidates.empty()) {
-        return arch;
-    }
-
-    // Find best generic candidate
-    std::vector<const Microarchitecture*> generic_candidates;
-    for (const auto* c : candidates) {
-        if (c->vendor() == "generic") {
-            generic_candidates.push_back(c);
-        }
-    }
-
-    const Microarchitecture* best_generic = nullptr;
-    if (!generic_candidates.empty()) {
-        best_generic = *std::max_element(generic_candidates.begin(), generic_candidates.end(),
-                                         compare_microarch_specificity);
-    }
-
-    // Filter by CPU part for AArch64
-    if (!info.cpu_part.empty()) {
-        std::vector<const Microarchitecture*> cpu_part_matches;
-        for (const auto* c : candidates) {
-            if (c->cpu_part() == info.cpu_part) {
-                cpu_part_matches.push_back(c);
-            }
-        }
-        if (!cpu_part_matches.empty()) {
-            candidates = cpu_part_matches;
-        }
-    }
-
-    // Filter candidates to be descendants of best generic
-    if (best_generic) {
-        std::vector<const Microarchitecture*> filtered;
-        for (const auto* c : candidates) {
-            if (*c > *best_generic) {
-                filtered.push_back(c);
-            }
-        }
-        if (!filtered.empty()) {
-            candidates = filtered;
-        }
-    }
-
-    if (candidates.empty()) {
-        return best_generic ? best_generic->name() : arch;
-    }
-
-    const Microarchitecture* best =
-        *std::max_element(candidates.begin(), candidates.end(), compare_microarch_specificity);
-    return best->name();
+    const Microarchitecture* best = best_match(parse_cpuinfo(content, arch), arch);
+    return best ? best->name() : arch;
 }
 
 // Read file content
@@ -196,34 +47,106 @@ std::string extract_expected_target(const std::string& filename) {
     return "";
 }
 
-// Extract architecture from filename
-std::string extract_arch_from_filename(const std::string& filename) {
-    if (filename.find("linux-") == 0 || filename.find("bgq-") == 0) {
-        // Check for power
-        if (filename.find("power") != std::string::npos) {
-            if (filename.find("le") != std::string::npos)
-                return "ppc64le";
-            return "ppc64";
+// Fixture directories given on the command line, checked along with the bundled ones
+std::vector<std::string> g_fixture_dirs;
+
+// A captured cpuinfo file and the target it must resolve to
+struct Fixture {
+    std::string name;
+    std::string arch; // Family of the expected target
+    std::string expected;
+    std::string content;
+};
+
+// Bundled fixtures whose file name is not the target they resolve to
+const std::pair<const char*, const char*> kBundledGolden[] = {
+    // The VM's kernel predates AMX, so it reports none of the amx_* flags sapphirerapids needs
+    {"linux-amazon2-sapphirerapids", "icelake"},
+};
+
+// Load the fixtures of a directory, reporting unusable entries in errors
+// A golden.txt file with "<file> <target>" lines lists the fixtures and their expected
+// targets. Without one, every "linux-*" or "bgq-*" file is a fixture whose expected target
+// ends its name, as in archspec's test data.
+std::vector<Fixture> load_fixtures(const fs::path& dir, std::vector<std::string>& errors) {
+    std::vector<std::pair<std::string, std::string>> entries; // file, expected target
+    std::ifstream golden(dir / "golden.txt");
+    if (golden.is_open()) {
+        std::string line;
+        while (std::getline(golden, line)) {
+            std::istringstream fields(line);
+            std::string file, target;
+            if (fields >> file >> target && file[0] != '#')
+                entries.emplace_back(file, target);
         }
-        // Check for ARM
-        if (filename.find("cortex") != std::string::npos ||
-            filename.find("neoverse") != std::string::npos ||
-            filename.find("thunderx") != std::string::npos ||
-            filename.find("a64fx") != std::string::npos ||
-            filename.find("-m1") != std::string::npos ||
-            filename.find("-m2") != std::string::npos ||
-            filename.find("-m3") != std::string::npos ||
-            filename.find("-m4") != std::string::npos) {
-            return "aarch64";
+    } else {
+        std::error_code ec;
+        for (const auto& entry : fs::directory_iterator(dir, ec)) {
+            std::string file = entry.path().filename().string();
+            if (!entry.is_regular_file() || (file.find("linux-") != 0 && file.find("bgq-") != 0))
+                continue;
+            std::string target = extract_expected_target(file);
+            for (const auto& [name, golden] : kBundledGolden) {
+                if (file == name)
+                    target = golden;
+            }
+            entries.emplace_back(file, target);
         }
-        // Default to x86_64 for Linux
-        return "x86_64";
+        if (ec)
+            errors.push_back(dir.string() + ": " + ec.message());
+        std::sort(entries.begin(), entries.end());
     }
-    if (filename.find("darwin-") == 0) {
-        // macOS - skip these as they use sysctl not cpuinfo
-        return "skip";
+
+    const auto& db = MicroarchitectureDatabase::instance();
+    std::vector<Fixture> fixtures;
+    for (auto& [file, target] : entries) {
+        auto known = db.get(target);
+        std::string content = read_file_content((dir / file).string());
+        if (!known || content.empty()) {
+            errors.push_back(file + (known ? ": unreadable" : ": unknown target " + target));
+            continue;
+        }
+        fixtures.push_back({file, known->get().family(), std::move(target), std::move(content)});
     }
-    return "x86_64";
+    return fixtures;
+}
+
+struct FixtureResult {
+    std::string detected;
+    double micros = 0; // Time to parse and resolve the fixture
+};
+
+// Parse and resolve every fixture, spread over one thread per hardware thread
+std::vector<FixtureResult> resolve_fixtures(const std::vector<Fixture>& fixtures) {
+    std::vector<FixtureResult> results(fixtures.size());
+    std::atomic<size_t> next{0};
+    auto worker = [&] {
+        for (size_t i = next++; i < fixtures.size(); i = next++) {
+            auto start = std::chrono::steady_clock::now();
+            const Fixture& fixture = fixtures[i];
+            results[i].detected = detect_from_content(fixture.content, fixture.arch);
+            std::chrono::duration<double, std::micro> elapsed =
+                std::chrono::steady_clock::now() - start;
+            results[i].micros = elapsed.count();
+        }
+    };
+
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < std::min<size_t>(threads, fixtures.size()); ++t)
+        pool.emplace_back(worker);
+    worker();
+    for (auto& thread : pool)
+        thread.join();
+    return results;
+}
+
+// Nearest-rank percentile of already sorted values
+double percentile(const std::vector<double>& sorted, double fraction) {
+    if (sorted.empty())
+        return 0;
+    size_t rank = static_cast<size_t>(std::ceil(fraction * sorted.size()));
+    return sorted[std::max<size_t>(rank, 1) - 1];
 }
 
 TEST(fake_cpuinfo_zen3) {
@@ -329,7 +252,185 @@ TEST(fake_cpuinfo_zen5) {
     TEST_PASS();
 }
 
-int main() {
+// Non-x86 fields come from the same parser even when the host is x86
+TEST(parse_cpuinfo_power) {
+    std::string content =
+        read_file_content("extern/archspec/archspec/json/tests/targets/linux-rhel8-power9");
+    ASSERT(!content.empty());
+
+    DetectedCpuInfo info = parse_cpuinfo(content, "ppc64le");
+    ASSERT_EQ(info.generation, 9);
+    ASSERT(info.features.empty());
+    TEST_PASS();
+}
+
+TEST(parse_cpuinfo_aarch64) {
+    std::string content =
+        read_file_content("extern/archspec/archspec/json/tests/targets/linux-amazon-neoverse_n1");
+    ASSERT(!content.empty());
+
+    DetectedCpuInfo info = parse_cpuinfo(content, "aarch64");
+    ASSERT_EQ(info.vendor, "ARM");
+    ASSERT_EQ(info.cpu_part, "0xd0c");
+    ASSERT(info.features.count("asimd"));
+
+    std::string detected = detect_from_content(content, "aarch64");
+    std::cout << "(detected: " << detected << ", expected: neoverse_n1) ";
+    ASSERT_EQ(detected, "neoverse_n1");
+    TEST_PASS();
+}
+
+TEST(parse_cpuinfo_riscv64) {
+    std::string content =
+        read_file_content("extern/archspec/archspec/json/tests/targets/linux-sifive-u74mc");
+    ASSERT(!content.empty());
+
+    DetectedCpuInfo info = parse_cpuinfo(content, "riscv64");
+    ASSERT_EQ(info.name, "u74mc");
+    ASSERT_EQ(parse_cpuinfo("processor : 0\n", "riscv64").name, "riscv64");
+    TEST_PASS();
+}
+
+TEST(parse_cpuinfo_first_block_only) {
+    std::string content = "processor\t: 0\nvendor_id\t: GenuineIntel\nflags\t\t: sse sse2\n\n"
+                          "processor\t: 1\nvendor_id\t: AuthenticAMD\nflags\t\t: avx2\n";
+    DetectedCpuInfo info = parse_cpuinfo(content, "x86_64");
+    ASSERT_EQ(info.vendor, "GenuineIntel");
+    ASSERT_EQ(info.features, (std::set<std::string>{"sse", "sse2"}));
+
+    DetectedCpuInfo empty = parse_cpuinfo("", "x86_64");
+    ASSERT_EQ(empty.vendor, "generic");
+    ASSERT(empty.features.empty());
+    TEST_PASS();
+}
+
+// Rebuild a single processor block of an AArch64 fixture under another processor number
+std::string aarch64_block(const DetectedCpuInfo& info, const std::string& implementer, int cpu) {
+    std::string block = "processor\t: " + std::to_string(cpu) + "\nFeatures\t:";
+    for (const auto& feature : info.features)
+        block += " " + feature;
+    block += "\nCPU implementer\t: " + implementer + "\nCPU part\t: " + info.cpu_part + "\n\n";
+    return block;
+}
+
+// Two Neoverse N1 cores followed by two Cortex-A72 cores
+TEST(parse_cpu_clusters_hybrid) {
+    std::string dir = "extern/archspec/archspec/json/tests/targets/";
+    std::string big = read_file_content(dir + "linux-amazon-neoverse_n1");
+    std::string little = read_file_content(dir + "linux-amazon-cortex_a72");
+    ASSERT(!big.empty() && !little.empty());
+
+    DetectedCpuInfo big_info = parse_cpuinfo(big, "aarch64");
+    DetectedCpuInfo little_info = parse_cpuinfo(little, "aarch64");
+    std::string content = aarch64_block(big_info, "0x41", 0) + aarch64_block(big_info, "0x41", 1) +
+                          aarch64_block(little_info, "0x41", 2) +
+                          aarch64_block(little_info, "0x41", 3);
+
+    auto clusters = parse_cpu_clusters(content, "aarch64");
+    ASSERT_EQ(clusters.size(), size_t(2));
+    ASSERT_EQ(clusters[0].cpus, (std::vector<int>{0, 1}));
+    ASSERT_EQ(clusters[1].cpus, (std::vector<int>{2, 3}));
+    ASSERT_EQ(clusters[0].target.name(), "neoverse_n1");
+    ASSERT_EQ(clusters[1].target.name(), "cortex_a72");
+
+    // Only the little cores' features are common to both clusters
+    Microarchitecture common = common_microarchitecture(clusters, "aarch64");
+    std::cout << "(common: " << common.name() << ") ";
+    ASSERT_EQ(common.name(), "cortex_a72");
+
+    // A homogeneous machine is one cluster whose target is also the common one
+    auto same = parse_cpu_clusters(aarch64_block(big_info, "0x41", 0) +
+                                       aarch64_block(big_info, "0x41", 1),
+                                   "aarch64");
+    ASSERT_EQ(same.size(), size_t(1));
+    ASSERT_EQ(common_microarchitecture(same, "aarch64").name(), "neoverse_n1");
+    ASSERT(parse_cpu_clusters("", "aarch64").empty());
+    TEST_PASS();
+}
+
+// Every x86_64 target feature a fixture reports must also be decodable from CPUID, so that
+// DetectionMethod::Cpuid resolves the same target as the /proc/cpuinfo path
+TEST(fake_cpuinfo_cpuid_coverage) {
+    const char* fixtures[] = {"linux-rhel7-haswell",       "linux-rhel7-broadwell",
+                              "linux-rhel7-skylake_avx512", "linux-centos7-cascadelake",
+                              "linux-rhel6-piledriver",     "linux-rhel7-zen",
+                              "linux-ubuntu20.04-zen3",     "linux-rocky8.5-zen4",
+                              "linux-rocky9-zen5"};
+    std::set<std::string> required;
+    for (const auto& [name, target] : MicroarchitectureDatabase::instance().all()) {
+        if (target.family() == ARCH_X86_64)
+            required.insert(target.features().begin(), target.features().end());
+    }
+    const auto& known = Cpuid::known_features();
+
+    int checked = 0;
+    for (const char* fixture : fixtures) {
+        std::string path = std::string("extern/archspec/archspec/json/tests/targets/") + fixture;
+        std::string content = read_file_content(path);
+        if (content.empty())
+            continue;
+
+        DetectedCpuInfo info = parse_cpuinfo(content, "x86_64");
+        for (const auto& feature : info.features) {
+            if (required.count(feature) && known.count(feature) == 0) {
+                std::cout << "(" << fixture << ": " << feature << " not decoded) ";
+                ASSERT(false);
+            }
+        }
+        checked++;
+    }
+    ASSERT(checked > 0);
+    std::cout << "(" << checked << " fixtures) ";
+    TEST_PASS();
+}
+
+// Every bundled fixture, and those of any directory given on the command line, resolves to
+// its golden target
+TEST(fixture_corpus) {
+    std::vector<std::string> dirs = {"extern/archspec/archspec/json/tests/targets"};
+    dirs.insert(dirs.end(), g_fixture_dirs.begin(), g_fixture_dirs.end());
+
+    // POWER compatibility compares target families with get_machine(), so those fixtures
+    // only resolve on a POWER host of the same endianness
+    std::vector<Fixture> fixtures;
+    std::vector<std::string> errors;
+    size_t skipped = 0;
+    for (const auto& dir : dirs) {
+        for (auto& fixture : load_fixtures(dir, errors)) {
+            bool power = fixture.arch == ARCH_PPC64 || fixture.arch == ARCH_PPC64LE;
+            if (power && fixture.arch != get_machine())
+                skipped++;
+            else
+                fixtures.push_back(std::move(fixture));
+        }
+    }
+    ASSERT(!fixtures.empty());
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<FixtureResult> results = resolve_fixtures(fixtures);
+    std::chrono::duration<double, std::milli> wall = std::chrono::steady_clock::now() - start;
+
+    std::vector<double> latencies;
+    for (size_t i = 0; i < fixtures.size(); ++i) {
+        latencies.push_back(results[i].micros);
+        if (results[i].detected != fixtures[i].expected)
+            errors.push_back(fixtures[i].name + ": detected " + results[i].detected);
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    for (const auto& error : errors)
+        std::cout << "(" << error << ") ";
+    std::cout << "(" << fixtures.size() << " fixtures, " << skipped << " skipped, in "
+              << wall.count() << " ms, p50 "
+              << percentile(latencies, 0.5) << " us, p99 " << percentile(latencies, 0.99)
+              << " us) ";
+    ASSERT(errors.empty());
+    TEST_PASS();
+}
+
+int main(int argc, char** argv) {
+    g_fixture_dirs.assign(argv + 1, argv + argc);
+
     std::cout << "=== archspec_cpp Fake cpuinfo Tests ===" << std::endl;
     std::cout << std::endl;
 
@@ -356,6 +457,14 @@ int main() {
     RUN_TEST(fake_cpuinfo_zen4);
     RUN_TEST(fake_cpuinfo_zen5);
 
+    RUN_TEST(parse_cpuinfo_power);
+    RUN_TEST(parse_cpuinfo_aarch64);
+    RUN_TEST(parse_cpuinfo_riscv64);
+    RUN_TEST(parse_cpuinfo_first_block_only);
+    RUN_TEST(parse_cpu_clusters_hybrid);
+    RUN_TEST(fake_cpuinfo_cpuid_coverage);
+    RUN_TEST(fixture_corpus);
+
     std::cout << std::endl;
     std::cout << "=== Results ===" << std::endl;
     std::cout << "Passed: " << g_tests_passed << std::endl;
@@ -0,0 +1,160 @@
+// This file is a part of Julia. License is MIT: https://julialang.org/license
+//
+// Unit tests for the on-disk host detection cache
+
+#include "test_common.hpp"
+#include <archspec/archspec.hpp>
+#include <archspec/host_cache.hpp>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+
+using namespace archspec;
+
+namespace fs = std::filesystem;
+
+static HostCacheEntry host_entry() {
+    return make_host_cache_entry(host_cpu_info_cached(), host_cached());
+}
+
+TEST(database_content_hash) {
+    const auto& db = MicroarchitectureDatabase::instance();
+    ASSERT(db.content_hash() != 0);
+    ASSERT_EQ(MicroarchitectureDatabase::instance_content_hash(), db.content_hash());
+
+    // Same data, same hash; any overlay changes it
+    DatabaseSnapshot plain = MicroarchitectureDatabase::make_snapshot();
+    ASSERT_EQ(plain->content_hash(), db.content_hash());
+    const char* overlay = R"({"microarchitectures": {"site": {"from": ["x86_64"],
+                             "vendor": "generic", "features": []}}})";
+    DatabaseSnapshot site = MicroarchitectureDatabase::make_snapshot({overlay});
+    ASSERT(site->content_hash() != db.content_hash());
+    ASSERT_EQ(MicroarchitectureDatabase::make_snapshot({overlay})->content_hash(),
+              site->content_hash());
+    TEST_PASS();
+}
+
+TEST(cache_key) {
+    std::string key = host_cache_key();
+#if defined(__linux__) || defined(__APPLE__)
+    ASSERT(!key.empty());
+    ASSERT(key.find("boot=") == 0);
+    ASSERT(key.find(" db=") != std::string::npos);
+    ASSERT_EQ(host_cache_key(), key);
+#else
+    ASSERT(key.empty());
+#endif
+    TEST_PASS();
+}
+
+TEST(entry_matches_host) {
+    HostCacheEntry entry = host_entry();
+    const Microarchitecture& target = host_cached();
+    ASSERT_EQ(entry.target, target.name());
+    ASSERT(entry.info.features == host_cpu_info_cached().features);
+    ASSERT_EQ(entry.target_features.empty(), target.features().empty());
+    for (size_t i = 1; i < entry.flags.size(); ++i)
+        ASSERT(entry.flags[i - 1].first < entry.flags[i].first);
+    for (const auto& [compiler, flags] : entry.flags)
+        ASSERT_EQ(flags, target.optimization_flags(compiler, ""));
+    TEST_PASS();
+}
+
+#if !defined(_WIN32) && !defined(_WIN64)
+TEST(write_and_read) {
+    fs::path dir = "build/test_host_cache";
+    fs::remove_all(dir);
+    std::string path = (dir / "nested/host").string();
+
+    HostCacheEntry entry = host_entry();
+    entry.info.cpu_part = "0xd0c";
+    entry.info.generation = 9;
+    entry.flags.emplace_back("zcc", "-O2 -mcpu=some thing");
+    ASSERT(write_host_cache(path, "key 1", entry));
+
+    auto read = read_host_cache(path, "key 1");
+    ASSERT(read.has_value());
+    ASSERT_EQ(read->target, entry.target);
+    ASSERT_EQ(read->info.vendor, entry.info.vendor);
+    ASSERT_EQ(read->info.cpu_part, "0xd0c");
+    ASSERT_EQ(read->info.generation, 9);
+    ASSERT(read->info.features == entry.info.features);
+    ASSERT(read->info.disabled_features == entry.info.disabled_features);
+    ASSERT_EQ(read->target_features, entry.target_features);
+    ASSERT(read->flags == entry.flags);
+
+    // Another boot, CPU or database invalidates it
+    ASSERT(!read_host_cache(path, "key 2").has_value());
+    ASSERT(!read_host_cache(path, "").has_value());
+    ASSERT(!read_host_cache((dir / "missing").string(), "key 1").has_value());
+    TEST_PASS();
+}
+
+TEST(rejects_bad_files) {
+    fs::path dir = "build/test_host_cache";
+    std::string path = (dir / "host").string();
+    HostCacheEntry entry = host_entry();
+    ASSERT(write_host_cache(path, "key", entry));
+
+    // A file cut short loses its end marker
+    std::string content;
+    {
+        std::ifstream in(path);
+        std::getline(in, content, '\0');
+    }
+    std::ofstream(path) << content.substr(0, content.size() / 2);
+    ASSERT(!read_host_cache(path, "key").has_value());
+    std::ofstream(path) << "archspec-host-cache 0\nkey\tkey\ntarget\tx86_64\nend\n";
+    ASSERT(!read_host_cache(path, "key").has_value());
+
+    // Values that would break the line format are refused
+    entry.flags.emplace_back("zcc", "-O2\n-march=native");
+    ASSERT(!write_host_cache(path, "key", entry));
+    ASSERT(!write_host_cache(path, "", host_entry()));
+    fs::remove_all(dir);
+    TEST_PASS();
+}
+
+// load_host_cache() only answers when the library is built with ARCHSPEC_HOST_CACHE=1
+TEST(load_and_store) {
+    fs::path dir = fs::absolute("build/test_host_cache_xdg");
+    fs::remove_all(dir);
+    setenv("XDG_CACHE_HOME", dir.c_str(), 1);
+    ASSERT_EQ(host_cache_path(), (dir / "archspec/host").string());
+    ASSERT(!load_host_cache().has_value());
+
+    HostCacheEntry entry = host_entry();
+    store_host_cache(entry);
+    bool enabled = fs::exists(dir / "archspec/host");
+    auto loaded = load_host_cache();
+    ASSERT_EQ(loaded.has_value(), enabled && !host_cache_key().empty());
+    if (loaded)
+        ASSERT_EQ(loaded->target, entry.target);
+    std::cout << "(" << (enabled ? "enabled" : "disabled in this build") << ") ";
+
+    unsetenv("XDG_CACHE_HOME");
+    fs::remove_all(dir);
+    TEST_PASS();
+}
+#endif
+
+int main() {
+    std::cout << "=== archspec_cpp Host Cache Tests ===" << std::endl;
+    std::cout << std::endl;
+
+    RUN_TEST(database_content_hash);
+    RUN_TEST(cache_key);
+    RUN_TEST(entry_matches_host);
+#if !defined(_WIN32) && !defined(_WIN64)
+    RUN_TEST(write_and_read);
+    RUN_TEST(rejects_bad_files);
+    RUN_TEST(load_and_store);
+#endif
+
+    std::cout << std::endl;
+    std::cout << "=== Results ===" << std::endl;
+    std::cout << "Passed: " << g_tests_passed << std::endl;
+    std::cout << "Failed: " << g_tests_failed << std::endl;
+
+    return g_tests_failed > 0 ? 1 : 0;
+}
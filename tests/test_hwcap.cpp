@@ -0,0 +1,111 @@
+// This file is a part of Julia. License is MIT: https://julialang.org/license
+//
+// Unit tests for AArch64 HWCAP and MIDR decoding
+
+#include "test_common.hpp"
+#include <archspec/detect.hpp>
+#include <archspec/hwcap.hpp>
+#include <fstream>
+#include <sstream>
+
+using namespace archspec;
+
+std::string read_file_content(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open())
+        return "";
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+// Test individual bits of both words
+TEST(decode_bits) {
+    ASSERT(hwcap::decode(0, 0).empty());
+    ASSERT_EQ(hwcap::decode(0x3, 0), (std::set<std::string>{"fp", "asimd"}));
+    ASSERT_EQ(hwcap::decode(uint64_t(1) << 8, 0), (std::set<std::string>{"atomics"}));
+    ASSERT_EQ(hwcap::decode(uint64_t(1) << 22, 0), (std::set<std::string>{"sve"}));
+    ASSERT_EQ(hwcap::decode(0, uint64_t(1) << 1), (std::set<std::string>{"sve2"}));
+    ASSERT_EQ(hwcap::decode(0, (uint64_t(1) << 13) | (uint64_t(1) << 14)),
+              (std::set<std::string>{"i8mm", "bf16"}));
+
+    // Bits the kernel may define later are ignored
+    ASSERT(hwcap::decode(uint64_t(1) << 63, uint64_t(1) << 63).empty());
+    TEST_PASS();
+}
+
+// Test MIDR_EL1 field extraction
+TEST(midr_fields) {
+    // Neoverse N1 r3p1
+    ASSERT_EQ(hwcap::midr_implementer(0x413fd0c1), "0x41");
+    ASSERT_EQ(hwcap::midr_part(0x413fd0c1), "0xd0c");
+
+    // A64FX, with the sysfs 64-bit register width
+    ASSERT_EQ(hwcap::midr_implementer(0x00000000461f0010), "0x46");
+    ASSERT_EQ(hwcap::midr_part(0x00000000461f0010), "0x001");
+    TEST_PASS();
+}
+
+// Every feature the kernel printed in the fixtures must map to a HWCAP bit
+TEST(fixture_features_decodable) {
+    const char* fixtures[] = {"linux-amazon-cortex_a72",      "linux-amazon-neoverse_n1",
+                              "linux-amazon-neoverse_v1",     "linux-centos7-thunderx2",
+                              "linux-rocky8-a64fx",           "linux-ubuntu22.04-neoverse_v2",
+                              "linux-asahi-m1",               "linux-asahi-m2"};
+    const auto& known = hwcap::known_features();
+
+    int checked = 0;
+    for (const char* fixture : fixtures) {
+        std::string path = std::string("extern/archspec/archspec/json/tests/targets/") + fixture;
+        std::string content = read_file_content(path);
+        if (content.empty())
+            continue;
+
+        DetectedCpuInfo info = parse_cpuinfo(content, "aarch64");
+        ASSERT(!info.features.empty());
+        for (const auto& feature : info.features) {
+            if (known.count(feature) == 0) {
+                std::cout << "(" << fixture << ": " << feature << " not decoded) ";
+                ASSERT(false);
+            }
+        }
+        checked++;
+    }
+    ASSERT(checked > 0);
+    std::cout << "(" << checked << " fixtures) ";
+    TEST_PASS();
+}
+
+// The auxiliary vector and /proc/cpuinfo should describe the host identically
+TEST(hwcap_detection_parity) {
+    DetectedCpuInfo info = detect_from_hwcaps();
+#if defined(__linux__) && defined(__aarch64__)
+    DetectedCpuInfo os_info = detect_cpu_info(DetectionMethod::OperatingSystem);
+    ASSERT_EQ(info.vendor, os_info.vendor);
+    ASSERT_EQ(info.cpu_part, os_info.cpu_part);
+    ASSERT_EQ(info.features, os_info.features);
+    std::cout << "(" << info.features.size() << " features) ";
+#else
+    ASSERT(info.vendor.empty());
+    ASSERT(info.features.empty());
+    std::cout << "(skipped - not Linux AArch64) ";
+#endif
+    TEST_PASS();
+}
+
+int main() {
+    std::cout << "=== archspec_cpp HWCAP Tests ===" << std::endl;
+    std::cout << std::endl;
+
+    RUN_TEST(decode_bits);
+    RUN_TEST(midr_fields);
+    RUN_TEST(fixture_features_decodable);
+    RUN_TEST(hwcap_detection_parity);
+
+    std::cout << std::endl;
+    std::cout << "=== Results ===" << std::endl;
+    std::cout << "Passed: " << g_tests_passed << std::endl;
+    std::cout << "Failed: " << g_tests_failed << std::endl;
+
+    return g_tests_failed > 0 ? 1 : 0;
+}
@@ -294,6 +294,14 @@ void test_features_for_cpu() {
     assert(haswell_features.find("+avx2") != std::string::npos ||
            haswell_features.find("avx2") != std::string::npos);
 
+    // Case-insensitive and normalized lookups reach the same targets
+    assert(archspec::get_llvm_features_for_cpu("Haswell", "x86_64") == haswell_features);
+    assert(archspec::get_llvm_features_for_cpu("znver3", "x86_64") ==
+           archspec::get_llvm_features_for_cpu("zen3", "x86_64"));
+    assert(archspec::get_llvm_features_for_cpu("neoverse-n1", "aarch64") ==
+           archspec::get_llvm_features_for_cpu("neoverse_n1", "aarch64"));
+    assert(archspec::get_llvm_features_for_cpu("no-such-cpu", "x86_64").empty());
+
     // Test generic returns empty
     std::string generic_features = archspec::get_llvm_features_for_cpu("generic", "x86_64");
     assert(generic_features.empty());
@@ -301,6 +309,38 @@ void test_features_for_cpu() {
     printf("  PASS: features lookup by CPU name\n");
 }
 
+void test_cached_llvm_names() {
+    printf("Testing cached LLVM names...\n");
+
+    const auto& db = archspec::MicroarchitectureDatabase::instance();
+    for (const auto& [name, target] : db.all()) {
+        // Same storage on every call, and the same text as a fresh join
+        assert(&target.llvm_features() == &target.llvm_features());
+        assert(&target.llvm_cpu_name() == &target.llvm_cpu_name());
+
+        std::string joined;
+        for (const auto& f : archspec::get_llvm_features(target))
+            joined += (joined.empty() ? "+" : ",+") + f;
+        assert(target.llvm_features() == joined);
+        assert(archspec::get_llvm_features_string(target) == joined);
+        assert(archspec::get_llvm_cpu_name(target) == target.llvm_cpu_name());
+
+        // Standalone copies compute the same values on first use
+        archspec::Microarchitecture copy(target.name(), target.parent_names(), target.vendor(),
+                                         target.features(), target.compilers(),
+                                         target.generation(), target.cpu_part());
+        assert(copy.llvm_features() == target.llvm_features());
+        assert(copy.llvm_cpu_name() == target.llvm_cpu_name());
+    }
+
+    assert(db.get("zen3")->get().llvm_cpu_name() == "znver3");
+    const auto& host = archspec::host_cached();
+    if (auto target = db.get(host.name()))
+        assert(host.llvm_features() == target->get().llvm_features());
+
+    printf("  PASS: cached LLVM names\n");
+}
+
 int main() {
     printf("=== LLVM Compatibility Tests ===\n\n");
 
@@ -312,6 +352,7 @@ int main() {
     test_host_llvm_features();
     test_cpu_name_normalization();
     test_features_for_cpu();
+    test_cached_llvm_names();
 
     printf("\n=== All LLVM compatibility tests passed! ===\n");
     return 0;
@@ -4,7 +4,13 @@
 
 #include "test_common.hpp"
 #include <archspec/microarchitecture.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
 #include <cstring>
+#include <fstream>
+#include <iterator>
+#include <set>
 
 using namespace archspec;
 
@@ -67,6 +73,25 @@ TEST(get_nonexistent) {
     TEST_PASS();
 }
 
+// Lookups go through the hash index and accept views that are not NUL-terminated
+TEST(get_by_view) {
+    const auto& db = MicroarchitectureDatabase::instance();
+    for (const auto& [name, target] : db.all()) {
+        auto found = db.get(name);
+        ASSERT(found.has_value());
+        ASSERT(&found->get() == &target);
+        ASSERT(db.exists(name));
+    }
+
+    std::string buffer = "haswellXYZ";
+    std::string_view view(buffer.data(), 7);
+    ASSERT(db.exists(view));
+    ASSERT_EQ(db.get(view)->get().name(), std::string("haswell"));
+    ASSERT(!db.exists(std::string_view(buffer.data(), 6)));
+    ASSERT(!db.exists(""));
+    TEST_PASS();
+}
+
 // Test ancestry
 TEST(ancestors_haswell) {
     auto target = get_target("haswell");
@@ -105,6 +130,55 @@ TEST(ancestors_zen4) {
     TEST_PASS();
 }
 
+TEST(topological_order) {
+    const auto& db = MicroarchitectureDatabase::instance();
+    const auto& order = db.topological_order();
+    ASSERT_EQ(order.size(), db.all().size());
+
+    // Every parent appears before its children
+    std::set<std::string> seen;
+    for (const auto* target : order) {
+        for (const auto& parent : target->parent_names()) {
+            ASSERT(seen.count(parent) > 0);
+        }
+        seen.insert(target->name());
+    }
+    TEST_PASS();
+}
+
+TEST(has_ancestor) {
+    auto zen4 = get_target("zen4");
+    ASSERT(zen4.has_value());
+    ASSERT(zen4->get().has_ancestor("zen4"));
+    ASSERT(zen4->get().has_ancestor("zen3"));
+    ASSERT(zen4->get().has_ancestor("x86_64"));
+    ASSERT(!zen4->get().has_ancestor("haswell"));
+    ASSERT(!zen4->get().has_ancestor("aarch64"));
+    ASSERT_EQ(zen4->get().depth(), zen4->get().ancestors().size());
+    TEST_PASS();
+}
+
+// Standalone targets resolve their lineage through the database on first use
+TEST(standalone_lineage) {
+    auto haswell = get_target("haswell");
+    ASSERT(haswell.has_value());
+    const auto& h = haswell->get();
+
+    Microarchitecture copy(h.name(), h.parent_names(), h.vendor(), h.features(), h.compilers(),
+                           h.generation(), h.cpu_part());
+    ASSERT(copy.database() == nullptr);
+    ASSERT(copy.ancestors() == h.ancestors());
+    ASSERT_EQ(copy.family(), h.family());
+    ASSERT_EQ(copy.generic(), h.generic());
+    ASSERT(copy.has_ancestor("x86_64"));
+
+    auto x86_64 = get_target("x86_64");
+    ASSERT(x86_64.has_value());
+    ASSERT(x86_64->get() < copy);
+    ASSERT(!(copy < x86_64->get()));
+    TEST_PASS();
+}
+
 // Test family
 TEST(family_haswell) {
     auto target = get_target("haswell");
@@ -205,6 +279,53 @@ TEST(optimization_flags_clang) {
     TEST_PASS();
 }
 
+// Version ranges and ancestor fallback resolve to the target that supplies the flags
+TEST(optimization_flags_source) {
+    auto zen4 = get_target("zen4");
+    ASSERT(zen4.has_value());
+    const auto& z = zen4->get();
+
+    ASSERT_EQ(z.optimization_flags("gcc", "13.1"), std::string("-march=znver4 -mtune=znver4"));
+    ASSERT_EQ(z.optimization_flags_source("gcc", "13.1"), std::string("zen4"));
+    ASSERT(z.optimization_flags("gcc", "11.2").find("-mavx512f") != std::string::npos);
+    ASSERT_EQ(z.optimization_flags_source("gcc", "10.3.0"), std::string("zen4"));
+
+    // GCC 9 predates znver3, so an older ancestor answers
+    std::string source = z.optimization_flags_source("gcc", "9.2");
+    ASSERT(!source.empty() && source != "zen4");
+    ASSERT(z.has_ancestor(source));
+    auto ancestor = get_target(source);
+    ASSERT(ancestor.has_value());
+    ASSERT_EQ(z.optimization_flags("gcc", "9.2"), ancestor->get().optimization_flags("gcc", "9.2"));
+
+    ASSERT(z.optimization_flags("no-such-compiler", "1.0").empty());
+    ASSERT(z.optimization_flags_source("no-such-compiler", "1.0").empty());
+    TEST_PASS();
+}
+
+// Memoized results match a standalone copy that resolves its own entries uncached
+TEST(optimization_flags_memoized) {
+    const char* compilers[] = {"gcc", "clang", "apple-clang", "aocc", "intel", "oneapi", "nvhpc"};
+    const char* versions[] = {"", "4.8", "4.8.5", "4.9", "5.3", "8.1", "9.0", "10.3", "11.0",
+                              "11.1", "12.2", "12.3", "13.1", "14.0.6", "16.0", "2023.1"};
+    const auto& db = MicroarchitectureDatabase::instance();
+    for (const auto& [name, target] : db.all()) {
+        Microarchitecture copy(target.name(), target.parent_names(), target.vendor(),
+                               target.features(), target.compilers(), target.generation(),
+                               target.cpu_part());
+        for (const char* compiler : compilers) {
+            for (const char* version : versions) {
+                std::string first = target.optimization_flags(compiler, version);
+                ASSERT_EQ(target.optimization_flags(compiler, version), first);
+                ASSERT_EQ(copy.optimization_flags(compiler, version), first);
+                ASSERT_EQ(copy.optimization_flags_source(compiler, version),
+                          target.optimization_flags_source(compiler, version));
+            }
+        }
+    }
+    TEST_PASS();
+}
+
 // Test generic microarchitecture creation
 TEST(generic_microarchitecture) {
     auto generic = generic_microarchitecture("test_arch");
@@ -249,6 +370,618 @@ TEST(arm_cpu_part) {
     TEST_PASS();
 }
 
+// Test feature interning
+TEST(feature_ids) {
+    const auto& db = MicroarchitectureDatabase::instance();
+    ASSERT(db.feature_count() > 0);
+    ASSERT(db.masks_exact());
+
+    auto id = db.feature_id("avx2");
+    ASSERT(id.has_value());
+    ASSERT_EQ(db.feature_name(*id), "avx2");
+    ASSERT(!db.feature_id("nonexistent_feature_12345").has_value());
+    TEST_PASS();
+}
+
+TEST(feature_mask_matches_features) {
+    const auto& db = MicroarchitectureDatabase::instance();
+    for (const auto& [name, target] : db.all()) {
+        ASSERT_EQ(target.feature_mask().count(), target.features().size());
+        ASSERT(target.feature_mask() == db.feature_mask(target.features()));
+        for (const auto& f : target.features()) {
+            ASSERT(target.feature_mask().test(*db.feature_id(f)));
+        }
+    }
+    TEST_PASS();
+}
+
+TEST(feature_mask_subset) {
+    auto haswell = get_target("haswell");
+    auto skylake = get_target("skylake");
+    auto zen = get_target("zen");
+    ASSERT(haswell.has_value());
+    ASSERT(skylake.has_value());
+    ASSERT(zen.has_value());
+
+    const auto& h = haswell->get().feature_mask();
+    const auto& s = skylake->get().feature_mask();
+    ASSERT(h.is_subset_of(s));
+    ASSERT(!s.is_subset_of(h));
+    ASSERT((s - h).any());
+    ASSERT((s & h) == h);
+    ASSERT(h.intersects(zen->get().feature_mask()));
+    TEST_PASS();
+}
+
+// Vector and scalar subset kernels agree, including on row counts that leave a remainder
+TEST(subset_scan_kernels) {
+    const auto& db = MicroarchitectureDatabase::instance();
+    const auto& table = db.target_table();
+    std::cout << "(" << subset_scan_kernel() << ") ";
+
+    std::vector<FeatureMask> masks = table.masks;
+    uint64_t state = 0x2545f4914f6cdd1dULL;
+    for (int i = 0; i < 37; ++i) {
+        FeatureMask m;
+        for (FeatureId id = 0; id < FeatureMask::kCapacity; ++id) {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            if (state % 5 == 0)
+                m.set(id);
+        }
+        masks.push_back(m);
+    }
+
+    for (const auto& available : masks) {
+        for (size_t count : {size_t(0), size_t(1), size_t(3), size_t(5), masks.size()}) {
+            std::vector<uint8_t> fast(count, 2), slow(count, 2);
+            subset_scan(masks.data(), count, available, fast.data());
+            subset_scan_scalar(masks.data(), count, available, slow.data());
+            ASSERT(fast == slow);
+            for (size_t i = 0; i < count; ++i)
+                ASSERT_EQ(slow[i] == 1, masks[i].is_subset_of(available));
+        }
+    }
+    TEST_PASS();
+}
+
+// The columnar table mirrors all()
+TEST(target_table) {
+    const auto& db = MicroarchitectureDatabase::instance();
+    const auto& table = db.target_table();
+    ASSERT_EQ(table.size(), db.all().size());
+    size_t i = 0;
+    for (const auto& [name, target] : db.all()) {
+        ASSERT(table.targets[i] == &target);
+        ASSERT(table.masks[i] == target.feature_mask());
+        ASSERT_EQ(table.vendor_names[table.vendors[i]], target.vendor());
+        ASSERT_EQ(table.family_names[table.families[i]], target.family());
+        ASSERT_EQ(table.generations[i], target.generation());
+        ++i;
+    }
+    ASSERT(table.vendor_id("generic") >= 0);
+    ASSERT_EQ(table.vendor_id("no-such-vendor"), -1);
+    ASSERT_EQ(table.family_id("no-such-family"), -1);
+    TEST_PASS();
+}
+
+// Index queries must agree with has_feature() on every target
+TEST(feature_index) {
+    const auto& db = MicroarchitectureDatabase::instance();
+    std::vector<std::string> names;
+    for (FeatureId id = 0; id < db.feature_count(); ++id)
+        names.push_back(db.feature_name(id));
+    for (const auto& [alias, _] : db.feature_aliases())
+        names.push_back(alias);
+    for (const auto& [alias, _] : db.family_features())
+        names.push_back(alias);
+    names.push_back("no-such-feature");
+
+    auto contains = [](const std::vector<const Microarchitecture*>& targets,
+                       const Microarchitecture& target) {
+        return std::find(targets.begin(), targets.end(), &target) != targets.end();
+    };
+    for (const auto& name : names) {
+        auto with = db.targets_with({name});
+        auto without = db.targets_without({name});
+        ASSERT_EQ(with.size() + without.size(), db.all().size());
+        for (const auto& [_, target] : db.all()) {
+            ASSERT_EQ(contains(with, target), target.has_feature(name));
+            ASSERT_EQ(contains(without, target), !target.has_feature(name));
+        }
+    }
+
+    auto both = db.targets_with({"avx2", "fma"});
+    ASSERT(!both.empty());
+    for (size_t i = 1; i < both.size(); ++i)
+        ASSERT(both[i - 1]->name() < both[i]->name());
+    for (const auto* target : both)
+        ASSERT(target->has_feature("avx2") && target->has_feature("fma"));
+    ASSERT(contains(both, db.get("haswell")->get()));
+    ASSERT(!contains(both, db.get("ivybridge")->get()));
+    ASSERT_EQ(db.targets_with({}).size(), db.all().size());
+    ASSERT(db.targets_with({"avx2", "no-such-feature"}).empty());
+    ASSERT(contains(db.targets_without({"avx512f"}), db.get("haswell")->get()));
+    TEST_PASS();
+}
+
+TEST(minimal_target) {
+    const auto& db = MicroarchitectureDatabase::instance();
+    const auto* target = db.minimal_target({"avx2", "fma"}, "x86_64");
+    ASSERT(target != nullptr);
+    ASSERT_EQ(target->name(), "x86_64_v3");
+    ASSERT_EQ(db.minimal_target({"avx512f"}, "x86_64")->name(), "x86_64_v4");
+    ASSERT_EQ(db.minimal_target({}, "x86_64")->name(), "x86_64");
+    ASSERT_EQ(db.minimal_target({"avx2"})->name(), "x86_64_v3");
+    ASSERT(db.minimal_target({"avx2"}, "aarch64") == nullptr);
+    ASSERT(db.minimal_target({"avx2"}, "no-such-family") == nullptr);
+    ASSERT(db.minimal_target({"no-such-feature"}) == nullptr);
+    TEST_PASS();
+}
+
+TEST(feature_diff) {
+    const auto& db = MicroarchitectureDatabase::instance();
+    const auto& haswell = db.get("haswell")->get();
+    const auto& ivybridge = db.get("ivybridge")->get();
+    auto diff = db.feature_diff(haswell, ivybridge);
+    std::vector<std::string> expected;
+    std::set_difference(haswell.features().begin(), haswell.features().end(),
+                        ivybridge.features().begin(), ivybridge.features().end(),
+                        std::back_inserter(expected));
+    ASSERT(diff == expected);
+    ASSERT(std::find(diff.begin(), diff.end(), "avx2") != diff.end());
+    ASSERT(db.feature_diff(ivybridge, haswell).empty());
+    ASSERT(db.feature_diff(haswell, haswell).empty());
+
+    // Standalone targets fall back to the feature sets
+    Microarchitecture site("site", {}, "generic", {"avx2", "sitefeature"}, {});
+    ASSERT(db.feature_diff(site, haswell) == std::vector<std::string>{"sitefeature"});
+    TEST_PASS();
+}
+
+// has_feature answers from the mask; it must agree with a plain string lookup
+TEST(has_feature_mask_parity) {
+    const auto& db = MicroarchitectureDatabase::instance();
+    auto standalone_has = [&](const Microarchitecture& t, const std::string& f) {
+        if (t.features().count(f))
+            return true;
+        if (auto it = db.feature_aliases().find(f); it != db.feature_aliases().end()) {
+            for (const auto& aliased : it->second) {
+                if (t.features().count(aliased))
+                    return true;
+            }
+        }
+        if (auto it = db.family_features().find(f); it != db.family_features().end())
+            return it->second.count(t.family()) > 0;
+        return false;
+    };
+
+    std::vector<std::string> names;
+    for (FeatureId id = 0; id < db.feature_count(); ++id)
+        names.push_back(db.feature_name(id));
+    for (const auto& [alias, _] : db.feature_aliases())
+        names.push_back(alias);
+    for (const auto& [alias, _] : db.family_features())
+        names.push_back(alias);
+    names.push_back("nonexistent_feature_12345");
+
+    for (const auto& [name, target] : db.all()) {
+        for (const auto& f : names) {
+            ASSERT_EQ(target.has_feature(f), standalone_has(target, f));
+        }
+    }
+    TEST_PASS();
+}
+
+// Overlays add targets from a file; targets already loaded are kept as they are
+// (runs last: it changes the database for every later test)
+TEST(load_overlay_file) {
+    auto& db = MicroarchitectureDatabase::instance();
+    size_t before = db.all().size();
+    std::string haswell_vendor = db.get("haswell")->get().vendor();
+
+    const char* path = "build/test_overlay.json";
+    {
+        std::ofstream out(path, std::ios::binary);
+        ASSERT(out.is_open());
+        out << R"({"microarchitectures": {
+            "overlay_v3": {"from": ["x86_64_v3"], "vendor": "generic", "features": ["avx2"],
+                           "compilers": {"gcc": [{"versions": "11.1:", "name": "x86-64-v3",
+                                                  "flags": "-march={name} -mtune=generic"}]}},
+            "haswell": {"from": [], "vendor": "overridden", "features": []}
+        }})";
+    }
+    ASSERT(db.load_from_file(path));
+
+    // The decoded target reads from the mapping, which saving to the same path leaves intact
+    ASSERT(db.save_binary(path));
+    std::remove(path);
+
+    ASSERT_EQ(db.all().size(), before + 1);
+    auto overlay = db.get("overlay_v3");
+    ASSERT(overlay.has_value());
+    ASSERT(overlay->get().has_ancestor("x86_64"));
+    ASSERT_EQ(overlay->get().optimization_flags("gcc", "12.1"),
+              std::string("-march=x86-64-v3 -mtune=generic"));
+    ASSERT_EQ(db.get("haswell")->get().vendor(), haswell_vendor);
+
+    ASSERT(!db.load_from_file("build/no_such_overlay.json"));
+    TEST_PASS();
+}
+
+TEST(arena_interning) {
+    Arena arena;
+    std::string first = "avx512f";
+    std::string_view a = arena.intern(first);
+    std::string_view b = arena.intern(std::string("avx512f"));
+    ASSERT(a == "avx512f");
+    ASSERT(a.data() == b.data());
+    ASSERT(a.data() != first.data());
+    ASSERT(arena.intern("").empty());
+
+    std::vector<std::string_view> items = {a, arena.intern("sse4_2")};
+    Span<std::string_view> span = arena.copy(items);
+    ASSERT_EQ(span.size(), 2u);
+    ASSERT(span[1] == "sse4_2");
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(span.data()) % alignof(std::string_view), 0u);
+    ASSERT(arena.copy(std::vector<std::string_view>()).empty());
+
+    // Larger than a block: stored on its own without disturbing earlier data
+    std::string big(64 * 1024, 'x');
+    ASSERT(arena.intern(big) == big);
+    ASSERT(span[0] == "avx512f");
+    ASSERT(arena.used() <= arena.reserved());
+
+    // ...and small strings keep filling the block that was current before it
+    size_t reserved = arena.reserved();
+    ASSERT(arena.intern("sse4_1") == "sse4_1");
+    ASSERT_EQ(arena.reserved(), reserved);
+    TEST_PASS();
+}
+
+TEST(target_views) {
+    const auto& db = MicroarchitectureDatabase::instance();
+    for (const auto& [name, target] : db.all()) {
+        ASSERT(target.name_view() == target.name());
+        ASSERT(target.vendor_view() == target.vendor());
+        ASSERT(target.cpu_part_view() == target.cpu_part());
+        ASSERT_EQ(target.parent_views().size(), target.parent_names().size());
+        for (size_t i = 0; i < target.parent_views().size(); ++i)
+            ASSERT(target.parent_views()[i] == target.parent_names()[i]);
+        ASSERT(std::equal(target.feature_views().begin(), target.feature_views().end(),
+                          target.features().begin(), target.features().end()));
+    }
+
+    // Interned once per database, so equal names share storage
+    const auto& haswell = db.get("haswell")->get();
+    const auto& broadwell = db.get("broadwell")->get();
+    ASSERT(haswell.vendor_view().data() == broadwell.vendor_view().data());
+    ASSERT(broadwell.parent_views()[0].data() == haswell.name_view().data());
+
+    // Copies keep pointing at the database arena; standalone targets get their own
+    Microarchitecture copy = haswell;
+    ASSERT(copy.feature_views().data() == haswell.feature_views().data());
+
+    // Database targets keep only the views and build features() on first use, copies included
+    auto snapshot = MicroarchitectureDatabase::make_snapshot();
+    ASSERT(snapshot);
+    Microarchitecture lazy = snapshot->get("haswell")->get();
+    ASSERT(lazy == haswell);
+    ASSERT(lazy.has_feature("avx2"));
+    ASSERT(lazy.features() == haswell.features());
+    ASSERT(&lazy.features() == &lazy.features());
+
+    Microarchitecture standalone("standalone", {"x86_64"}, "generic", {"sse2", "avx"}, {});
+    ASSERT(standalone.name_view() == "standalone");
+    ASSERT_EQ(standalone.feature_views().size(), 2u);
+    ASSERT(standalone.feature_views()[0] == "avx");
+    ASSERT(standalone.parent_views()[0] == "x86_64");
+    TEST_PASS();
+}
+
+// Read a whole file into a string
+TEST(tuning_hints) {
+    const auto& db = MicroarchitectureDatabase::instance();
+    auto tuning = [&](const char* name) { return db.get(name)->get().tuning(); };
+    auto width = [&](const char* name) { return db.get(name)->get().preferred_vector_width(); };
+
+    // Built-in rows, and their descendants inheriting them
+    ASSERT_EQ(tuning("haswell").vector_width, 256u);
+    ASSERT_EQ(tuning("haswell").fma_units, 2u);
+    ASSERT(tuning("skylake") == tuning("haswell"));
+    ASSERT(db.get("skylake")->get().declared_tuning() == TuningHints());
+    ASSERT(tuning("skylake_avx512").prefer_256 == std::optional<bool>(true));
+    ASSERT(tuning("sapphirerapids").prefer_256 == std::optional<bool>(true));
+    ASSERT_EQ(tuning("zen4").vector_width, 256u);
+    ASSERT(tuning("zen4").prefer_256 == std::optional<bool>(false));
+    ASSERT_EQ(tuning("neoverse_v1").sve_vector_length, 256u);
+    ASSERT(!tuning("x86_64_v4").prefer_256.has_value());
+
+    ASSERT_EQ(width("x86_64_v2"), 128u);
+    ASSERT_EQ(width("zen3"), 256u);
+    ASSERT_EQ(width("cascadelake"), 256u);
+    ASSERT_EQ(width("zen4"), 512u);
+    ASSERT_EQ(width("x86_64_v4"), 512u);
+    ASSERT_EQ(width("neoverse_n1"), 128u);
+    ASSERT_EQ(width("neoverse_v1"), 256u);
+    ASSERT_EQ(width("a64fx"), 512u);
+    ASSERT_EQ(width("riscv64"), 0u);
+
+    // Standalone targets resolve the same way
+    Microarchitecture standalone("skylake", {"broadwell"}, "GenuineIntel", {"avx2"}, {});
+    ASSERT(standalone.tuning() == tuning("skylake"));
+    TEST_PASS();
+}
+
+static std::string read_file(const char* path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+static bool write_file(const char* path, const std::string& data) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(data.data(), static_cast<std::streamsize>(data.size()));
+    return static_cast<bool>(out);
+}
+
+TEST(binary_round_trip) {
+    auto& db = MicroarchitectureDatabase::instance();
+    const char* path = "build/test_db.bin";
+    ASSERT(db.save_binary(path));
+    std::string image = read_file(path);
+    ASSERT(image.compare(0, 8, "ARCHSPDB") == 0);
+
+    // Every target is already present, so reloading changes nothing
+    size_t before = db.all().size();
+    ASSERT(db.load_binary(path));
+    ASSERT_EQ(db.all().size(), before);
+    ASSERT(db.save_binary(path));
+    ASSERT(read_file(path) == image);
+
+    // Rename one target in the string table so the reload has to decode it
+    size_t pos = image.find("cascadelake");
+    ASSERT(pos != std::string::npos);
+    image.replace(pos, 11, "CASCADELAKE");
+    ASSERT(write_file(path, image));
+    ASSERT(db.load_from_file(path));
+
+    // The decoded target reads from the mapping, which saving to the same path leaves intact
+    ASSERT(db.save_binary(path));
+    std::remove(path);
+
+    ASSERT_EQ(db.all().size(), before + 1);
+    const auto& original = db.get("cascadelake")->get();
+    auto decoded = db.get("CASCADELAKE");
+    ASSERT(decoded.has_value());
+    ASSERT(decoded->get().name_view() == "CASCADELAKE");
+    ASSERT(decoded->get().vendor_view() == original.vendor());
+    ASSERT(std::equal(decoded->get().feature_views().begin(), decoded->get().feature_views().end(),
+                      original.feature_views().begin(), original.feature_views().end()));
+    ASSERT(decoded->get().has_feature("avx512f"));
+    ASSERT(decoded->get().features() == original.features());
+    ASSERT(decoded->get().parent_names() == original.parent_names());
+    ASSERT_EQ(decoded->get().vendor(), original.vendor());
+    ASSERT_EQ(decoded->get().generation(), original.generation());
+    ASSERT(decoded->get().compilers().size() == original.compilers().size());
+    ASSERT(decoded->get().has_ancestor("x86_64_v4"));
+    TEST_PASS();
+}
+
+TEST(binary_rejects_corrupt_files) {
+    auto& db = MicroarchitectureDatabase::instance();
+    const char* path = "build/test_db_corrupt.bin";
+    ASSERT(db.save_binary(path));
+    std::string image = read_file(path);
+    size_t before = db.all().size();
+
+    ASSERT(write_file(path, image.substr(0, image.size() / 2)));
+    ASSERT(!db.load_binary(path));
+    ASSERT(write_file(path, image.substr(0, 40)));
+    ASSERT(!db.load_binary(path));
+
+    std::string bad_version = image;
+    bad_version[8] = 1; // Version 1 records predate the tuning hints
+    ASSERT(write_file(path, bad_version));
+    ASSERT(!db.load_binary(path));
+
+    // Point the first target's name past the end of the string table
+    std::string bad_string = image;
+    uint32_t targets = 0;
+    std::memcpy(&targets, bad_string.data() + 16 + 3 * 8, 4);
+    bad_string[targets + 3] = '\x7f';
+    ASSERT(write_file(path, bad_string));
+    ASSERT(!db.load_binary(path));
+
+    // A huge parent count on a target the database does not have yet must fail cleanly
+    DatabaseSnapshot site = MicroarchitectureDatabase::make_snapshot(
+        {R"({"microarchitectures": {"binary_site": {"from": ["x86_64"], "vendor": "generic",
+                                                    "features": []}}})"});
+    ASSERT(site && site->save_binary(path));
+    std::string bad_count = read_file(path);
+    uint32_t strings = 0, target_count = 0;
+    std::memcpy(&strings, bad_count.data() + 16, 4);
+    std::memcpy(&targets, bad_count.data() + 16 + 3 * 8, 4);
+    std::memcpy(&target_count, bad_count.data() + 20 + 3 * 8, 4);
+    bool patched = false;
+    for (uint32_t t = 0; t < target_count && !patched; ++t) {
+        char* rec = &bad_count[targets + t * 64];
+        uint32_t offset = 0, length = 0;
+        std::memcpy(&offset, rec, 4);
+        std::memcpy(&length, rec + 4, 4);
+        if (bad_count.compare(strings + offset, length, "binary_site") != 0)
+            continue;
+        uint32_t huge = 0xF0000000u;
+        std::memcpy(rec + 32, &huge, 4);
+        patched = true;
+    }
+    ASSERT(patched);
+    ASSERT(write_file(path, bad_count));
+    ASSERT(!db.load_binary(path));
+    ASSERT(!db.exists("binary_site"));
+    std::remove(path);
+
+    ASSERT_EQ(db.all().size(), before);
+    ASSERT(!db.load_binary("build/no_such_db.bin"));
+    TEST_PASS();
+}
+
+// Ancestors, lookups and the table agree with the parent lists after incremental loads
+static bool database_consistent(const MicroarchitectureDatabase& db) {
+    for (const auto& [name, target] : db.all()) {
+        std::set<std::string> expected;
+        std::vector<std::string> pending(target.parent_names().begin(),
+                                         target.parent_names().end());
+        while (!pending.empty()) {
+            std::string parent = pending.back();
+            pending.pop_back();
+            if (!expected.insert(parent).second)
+                continue;
+            auto found = db.get(parent);
+            if (!found)
+                continue;
+            for (const auto& p : found->get().parent_names())
+                pending.push_back(p);
+        }
+        const auto& ancestors = target.ancestors();
+        if (std::set<std::string>(ancestors.begin(), ancestors.end()) != expected)
+            return false;
+        if (!db.get(name) || &db.get(name)->get() != &target)
+            return false;
+    }
+    return db.target_table().size() == db.all().size();
+}
+
+TEST(load_overlay_replaces_targets) {
+    auto& db = MicroarchitectureDatabase::instance();
+    size_t before = db.all().size();
+    const auto& zen4 = db.get("zen4")->get();
+    const auto& zen5 = db.get("zen5")->get();
+    std::string zen4_flags = zen4.optimization_flags("gcc", "13.1");
+    ASSERT(!zen4_flags.empty());
+    ASSERT(zen5.optimization_flags("sitecc", "1.0").empty()); // memoized as unsupported
+
+    ASSERT(db.load_overlay(R"({"microarchitectures": {
+        "zen4": {"from": ["zen3", "x86_64_v4"], "vendor": "AuthenticAMD",
+                 "features": ["avx512f", "avx2", "sitefeature"],
+                 "compilers": {"sitecc": [{"versions": ":", "flags": "-march=site-zen4"}]}},
+        "zen4_site": {"from": ["zen4"], "vendor": "AuthenticAMD",
+                      "features": ["avx512f", "avx2", "sitefeature"]}
+    }})"));
+
+    ASSERT_EQ(db.all().size(), before + 1);
+    ASSERT(&db.get("zen4")->get() == &zen4); // replaced in place
+    ASSERT(zen4.has_feature("sitefeature"));
+    ASSERT(!zen4.has_feature("avx512bw"));
+    ASSERT(zen4.optimization_flags("gcc", "13.1") != zen4_flags);
+    ASSERT_EQ(zen4.optimization_flags("sitecc", "1.0"), std::string("-march=site-zen4"));
+
+    // Descendants see the new entry through their memoized fallbacks
+    ASSERT_EQ(zen5.optimization_flags("sitecc", "1.0"), std::string("-march=site-zen4"));
+    ASSERT_EQ(zen5.optimization_flags_source("sitecc", "1.0"), std::string("zen4"));
+    auto site = db.get("zen4_site");
+    ASSERT(site.has_value());
+    ASSERT(site->get().has_ancestor("zen3"));
+    ASSERT(zen4 < site->get());
+    auto with_site = db.targets_with({"sitefeature"});
+    ASSERT_EQ(with_site.size(), size_t(2));
+    ASSERT(with_site[0] == &zen4 && with_site[1] == &site->get());
+    ASSERT_EQ(site->get().llvm_cpu_name(), std::string("zen4_site"));
+    ASSERT(database_consistent(db));
+
+    // load_from_string() still keeps what is there
+    ASSERT(db.load_from_string(R"({"microarchitectures": {
+        "zen4": {"from": [], "vendor": "generic", "features": []}}})"));
+    ASSERT(zen4.has_ancestor("zen3"));
+    TEST_PASS();
+}
+
+TEST(load_overlay_reorders_when_needed) {
+    auto& db = MicroarchitectureDatabase::instance();
+    const auto& haswell = db.get("haswell")->get();
+    ASSERT(!haswell.has_ancestor("site_base"));
+
+    // x86_64_v3 gains a parent that is new, so it can no longer keep its position
+    ASSERT(db.load_overlay(R"({"microarchitectures": {
+        "site_base": {"from": ["x86_64_v2"], "vendor": "generic", "features": ["avx"]},
+        "x86_64_v3": {"from": ["site_base"], "vendor": "generic",
+                      "features": ["avx", "avx2", "fma", "bmi1", "bmi2"]}
+    }})"));
+    ASSERT(haswell.has_ancestor("site_base"));
+    ASSERT(db.get("site_base")->get() < haswell);
+    ASSERT(database_consistent(db));
+
+    // Missing parents are ignored, as in load_from_string()
+    ASSERT(db.load_overlay(R"({"microarchitectures": {
+        "orphan": {"from": ["no_such_parent"], "vendor": "generic", "features": []}}})"));
+    ASSERT_EQ(db.get("orphan")->get().family(), std::string("orphan"));
+    ASSERT(!db.load_overlay("{not json"));
+    ASSERT(!db.load_overlay_file("build/no_such_overlay.json"));
+    ASSERT(database_consistent(db));
+    TEST_PASS();
+}
+
+// Copies keep answering for their own lineage after a load renumbers the database
+TEST(copies_survive_reindexing) {
+    auto& db = MicroarchitectureDatabase::instance();
+    Microarchitecture zen3 = db.get("zen3")->get();
+    ASSERT(db.get("x86_64_v3")->get() < zen3);
+
+    ASSERT(db.load_overlay(R"({"microarchitectures": {
+        "aaa_new": {"from": ["x86_64"], "vendor": "generic", "features": []},
+        "haswell": {"from": ["ivybridge", "x86_64_v3", "aaa_new"], "vendor": "GenuineIntel",
+                    "features": ["avx2", "fma"]}
+    }})"));
+    ASSERT(database_consistent(db));
+
+    const auto& live = db.get("zen3")->get();
+    ASSERT(db.get("x86_64_v3")->get() < zen3);
+    ASSERT(!(zen3 < db.get("x86_64_v3")->get()));
+    for (const auto& [name, target] : db.all())
+        ASSERT_EQ(zen3.has_ancestor(name), live.has_ancestor(name));
+    TEST_PASS();
+}
+
+TEST(tuning_from_json) {
+    auto& db = MicroarchitectureDatabase::instance();
+    ASSERT(db.load_overlay(R"({"microarchitectures": {
+        "tuned_spr": {"from": ["sapphirerapids"], "vendor": "GenuineIntel",
+                      "features": ["avx512f", "avx2"],
+                      "tuning": {"prefer_256": false, "fma_units": 1, "vector_width": "wide"}},
+        "tuned_kid": {"from": ["tuned_spr"], "vendor": "GenuineIntel",
+                      "features": ["avx512f", "avx2"]}
+    }})"));
+    const auto& spr = db.get("tuned_spr")->get();
+    ASSERT_EQ(spr.declared_tuning().fma_units, 1u);
+    ASSERT_EQ(spr.declared_tuning().vector_width, 0u); // Wrong type, ignored
+    ASSERT_EQ(spr.tuning().vector_width, 512u);        // From skylake_avx512
+    ASSERT_EQ(spr.preferred_vector_width(), 512u);
+    ASSERT_EQ(db.get("tuned_kid")->get().preferred_vector_width(), 512u);
+
+    // A "tuning" section merges into existing targets and reaches their descendants
+    ASSERT(db.load_overlay(R"({"tuning": {"tuned_spr": {"vector_width": 384},
+                                          "no_such_target": {"vector_width": 1}}})"));
+    ASSERT_EQ(spr.declared_tuning().vector_width, 384u);
+    ASSERT_EQ(spr.declared_tuning().fma_units, 1u);
+    ASSERT_EQ(db.get("tuned_kid")->get().tuning().vector_width, 384u);
+    ASSERT(database_consistent(db));
+
+    // The binary format keeps declared hints
+    const char* path = "build/test_db_tuning.bin";
+    ASSERT(db.save_binary(path));
+    std::string image = read_file(path);
+    size_t pos = image.find("tuned_spr");
+    ASSERT(pos != std::string::npos);
+    image.replace(pos, 9, "TUNED_SPR");
+    ASSERT(write_file(path, image));
+    ASSERT(db.load_binary(path));
+    auto copy = db.get("TUNED_SPR");
+    ASSERT(copy.has_value());
+    ASSERT(copy->get().declared_tuning() == spr.declared_tuning());
+    ASSERT(copy->get().tuning() == spr.tuning());
+    TEST_PASS();
+}
+
 int main() {
     std::cout << "=== archspec_cpp Microarchitecture Tests ===" << std::endl;
     std::cout << std::endl;
@@ -261,10 +994,14 @@ int main() {
     RUN_TEST(get_aarch64);
     RUN_TEST(get_apple_m1);
     RUN_TEST(get_nonexistent);
+    RUN_TEST(get_by_view);
 
     // Ancestry tests
     RUN_TEST(ancestors_haswell);
     RUN_TEST(ancestors_zen4);
+    RUN_TEST(topological_order);
+    RUN_TEST(has_ancestor);
+    RUN_TEST(standalone_lineage);
 
     // Family tests
     RUN_TEST(family_haswell);
@@ -277,6 +1014,15 @@ int main() {
     // Feature tests
     RUN_TEST(has_feature_avx2);
     RUN_TEST(has_feature_alias);
+    RUN_TEST(feature_ids);
+    RUN_TEST(feature_mask_matches_features);
+    RUN_TEST(feature_mask_subset);
+    RUN_TEST(has_feature_mask_parity);
+    RUN_TEST(subset_scan_kernels);
+    RUN_TEST(target_table);
+    RUN_TEST(feature_index);
+    RUN_TEST(minimal_target);
+    RUN_TEST(feature_diff);
 
     // Comparison tests
     RUN_TEST(comparison_subset);
@@ -285,12 +1031,24 @@ int main() {
     // Compiler flags tests
     RUN_TEST(optimization_flags_gcc);
     RUN_TEST(optimization_flags_clang);
+    RUN_TEST(optimization_flags_source);
+    RUN_TEST(optimization_flags_memoized);
 
     // Other tests
     RUN_TEST(generic_microarchitecture);
     RUN_TEST(iterate_all_targets);
     RUN_TEST(power_generation);
     RUN_TEST(arm_cpu_part);
+    RUN_TEST(arena_interning);
+    RUN_TEST(target_views);
+    RUN_TEST(load_overlay_file);
+    RUN_TEST(tuning_hints);
+    RUN_TEST(binary_round_trip);
+    RUN_TEST(binary_rejects_corrupt_files);
+    RUN_TEST(load_overlay_replaces_targets);
+    RUN_TEST(load_overlay_reorders_when_needed);
+    RUN_TEST(copies_survive_reindexing);
+    RUN_TEST(tuning_from_json);
 
     std::cout << std::endl;
     std::cout << "=== Results ===" << std::endl;
@@ -0,0 +1,108 @@
+// This file is a part of Julia. License is MIT: https://julialang.org/license
+//
+// Unit tests for the multiversioning planner
+
+#include "test_common.hpp"
+#include <archspec/archspec.hpp>
+#include <archspec/multiversion.hpp>
+#include <algorithm>
+
+using namespace archspec;
+
+static const std::vector<std::string> kSysimageTargets = {
+    "zen4", "x86_64_v2", "skylake_avx512", "haswell", "x86_64_v2", "no_such_target"};
+
+static size_t index_of(const ClonePlan& plan, const std::string& name) {
+    for (size_t i = 0; i < plan.clones.size(); ++i) {
+        if (plan.clones[i].target->name() == name)
+            return i;
+    }
+    return plan.clones.size();
+}
+
+TEST(plan_orders_and_dedups) {
+    ClonePlan plan = plan_clones(kSysimageTargets, "gcc", "13.1");
+    ASSERT_EQ(plan.clones.size(), 4u);
+    ASSERT_EQ(plan.skipped, std::vector<std::string>{"no_such_target"});
+
+    // Every clone comes after each clone whose features it includes
+    for (size_t i = 0; i < plan.clones.size(); ++i) {
+        for (size_t j = i + 1; j < plan.clones.size(); ++j)
+            ASSERT(!(plan.clones[j].mask.is_subset_of(plan.clones[i].mask)));
+    }
+    ASSERT_EQ(plan.clones[0].target->name(), std::string("x86_64_v2"));
+    ASSERT(index_of(plan, "haswell") < index_of(plan, "skylake_avx512"));
+    TEST_PASS();
+}
+
+TEST(plan_bases_and_deltas) {
+    ClonePlan plan = plan_clones(kSysimageTargets, "gcc", "13.1");
+    const Clone& base = plan.clones[0];
+    ASSERT_EQ(base.base, Clone::kNoBase);
+    ASSERT_EQ(base.added.size(), base.target->features().size());
+
+    const Clone& haswell = plan.clones[index_of(plan, "haswell")];
+    ASSERT_EQ(haswell.base, 0u);
+    ASSERT(std::find(haswell.added.begin(), haswell.added.end(), "avx2") != haswell.added.end());
+    ASSERT(std::find(haswell.added.begin(), haswell.added.end(), "sse4_2") == haswell.added.end());
+    ASSERT_EQ(haswell.flags, haswell.target->optimization_flags("gcc", "13.1"));
+    ASSERT_EQ(haswell.llvm_cpu, std::string("haswell"));
+    ASSERT_EQ(haswell.llvm_features, haswell.target->llvm_features());
+
+    // skylake_avx512 builds on haswell, the closest clone below it
+    const Clone& skx = plan.clones[index_of(plan, "skylake_avx512")];
+    ASSERT_EQ(skx.base, static_cast<uint32_t>(index_of(plan, "haswell")));
+    ASSERT(std::find(skx.added.begin(), skx.added.end(), "avx512f") != skx.added.end());
+    TEST_PASS();
+}
+
+TEST(select_clone_priority) {
+    const auto& db = MicroarchitectureDatabase::instance();
+    ClonePlan plan = plan_clones(kSysimageTargets, "gcc", "13.1");
+    ASSERT_EQ(plan.dispatch.masks.size(), plan.clones.size());
+
+    // A host exactly matching a clone picks it; a more capable one picks the best below it
+    for (size_t i = 0; i < plan.clones.size(); ++i)
+        ASSERT_EQ(select_clone(plan, plan.clones[i].mask), i);
+    FeatureMask icelake = db.get("icelake")->get().feature_mask();
+    ASSERT_EQ(select_clone(plan, icelake),
+              static_cast<uint32_t>(index_of(plan, "skylake_avx512")));
+
+    // Nothing runs on a host below the base clone
+    FeatureMask old_host = db.get("x86_64")->get().feature_mask();
+    ASSERT_EQ(select_clone(plan, old_host), DispatchTable::kNoClone);
+
+    // The host itself can always run something when the base is generic enough
+    ClonePlan host_plan = plan_clones({"x86_64", host_cached().name()}, "gcc", "13.1");
+    if (!host_plan.clones.empty())
+        ASSERT(select_clone(host_plan, host_cpu_info_cached().feature_mask()) !=
+               DispatchTable::kNoClone);
+    TEST_PASS();
+}
+
+TEST(plan_skips_unsupported_compilers) {
+    // Neither these targets nor their ancestors have flags for this compiler
+    ClonePlan plan = plan_clones({"x86_64_v2", "zen4"}, "no_such_compiler", "1.0");
+    ASSERT_EQ(plan.skipped, (std::vector<std::string>{"x86_64_v2", "zen4"}));
+    ASSERT(plan.clones.empty());
+    ASSERT_EQ(select_clone(plan, FeatureMask()), DispatchTable::kNoClone);
+    ASSERT(plan_clones({}, "gcc", "13.1").clones.empty());
+    TEST_PASS();
+}
+
+int main() {
+    std::cout << "=== archspec_cpp Multiversioning Tests ===" << std::endl;
+    std::cout << std::endl;
+
+    RUN_TEST(plan_orders_and_dedups);
+    RUN_TEST(plan_bases_and_deltas);
+    RUN_TEST(select_clone_priority);
+    RUN_TEST(plan_skips_unsupported_compilers);
+
+    std::cout << std::endl;
+    std::cout << "=== Results ===" << std::endl;
+    std::cout << "Passed: " << g_tests_passed << std::endl;
+    std::cout << "Failed: " << g_tests_failed << std::endl;
+
+    return g_tests_failed > 0 ? 1 : 0;
+}
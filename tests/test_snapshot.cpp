@@ -0,0 +1,173 @@
+// This file is a part of Julia. License is MIT: https://julialang.org/license
+//
+// Unit tests for database snapshots and AtomicSnapshot
+
+#include "test_common.hpp"
+#include <archspec/archspec.hpp>
+#include <archspec/snapshot.hpp>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace archspec;
+
+static const char* kSiteOverlay = R"({"microarchitectures": {
+    "zen4": {"from": ["zen3", "x86_64_v4"], "vendor": "AuthenticAMD",
+             "features": ["avx512f", "avx2", "sitefeature"],
+             "compilers": {"sitecc": [{"versions": ":", "flags": "-march=site-zen4"}]}},
+    "zen4_site": {"from": ["zen4"], "vendor": "AuthenticAMD",
+                  "features": ["avx512f", "avx2", "sitefeature"]}
+}})";
+
+TEST(snapshot_is_independent_of_instance) {
+    const auto& global = MicroarchitectureDatabase::instance();
+    DatabaseSnapshot snapshot = MicroarchitectureDatabase::make_snapshot({kSiteOverlay});
+    ASSERT(snapshot != nullptr);
+    ASSERT(snapshot.get() != &global);
+
+    ASSERT_EQ(snapshot->all().size(), global.all().size() + 1);
+    ASSERT(snapshot->get("zen4_site").has_value());
+    ASSERT(!global.get("zen4_site").has_value());
+    ASSERT(snapshot->get("zen4")->get().has_feature("sitefeature"));
+    ASSERT(!global.get("zen4")->get().has_feature("sitefeature"));
+
+    DatabaseSnapshot plain = MicroarchitectureDatabase::make_snapshot();
+    ASSERT(plain != nullptr);
+    ASSERT_EQ(plain->all().size(), global.all().size());
+    TEST_PASS();
+}
+
+TEST(snapshot_targets_resolve_against_snapshot) {
+    DatabaseSnapshot snapshot = MicroarchitectureDatabase::make_snapshot({kSiteOverlay});
+    ASSERT(snapshot != nullptr);
+    const auto& site = snapshot->get("zen4_site")->get();
+    ASSERT(site.has_ancestor("zen3"));
+    ASSERT_EQ(site.optimization_flags("sitecc", "1.0"), std::string("-march=site-zen4"));
+    ASSERT_EQ(site.optimization_flags_source("sitecc", "1.0"), std::string("zen4"));
+
+    // The singleton's zen5 descends from its own zen4, which knows nothing of sitecc
+    const auto& zen5 = MicroarchitectureDatabase::instance().get("zen5")->get();
+    ASSERT(zen5.optimization_flags("sitecc", "1.0").empty());
+    TEST_PASS();
+}
+
+// A copied target keeps its snapshot alive; targets inside the snapshot do not
+TEST(snapshot_outlived_by_copies) {
+    DatabaseSnapshot snapshot = MicroarchitectureDatabase::make_snapshot({kSiteOverlay});
+    ASSERT(snapshot != nullptr);
+    std::weak_ptr<const MicroarchitectureDatabase> weak = snapshot;
+    {
+        Microarchitecture site = snapshot->get("zen4_site")->get();
+        Microarchitecture haswell = snapshot->get("haswell")->get();
+        snapshot.reset();
+        ASSERT(!weak.expired());
+        ASSERT(haswell.has_feature("avx2"));
+        ASSERT(site.has_feature("sitefeature"));
+        ASSERT(site.has_ancestor("zen3"));
+        ASSERT(site.feature_views().size() == site.features().size());
+        ASSERT_EQ(site.optimization_flags("sitecc", "1.0"), std::string("-march=site-zen4"));
+
+        Microarchitecture copy = site;
+        site = Microarchitecture();
+        ASSERT(copy.has_feature("sitefeature"));
+    }
+    ASSERT(weak.expired());
+    TEST_PASS();
+}
+
+// Detected features are compared in the id space of the target's own database
+TEST(snapshot_compatibility_checks) {
+    DatabaseSnapshot snapshot = MicroarchitectureDatabase::make_snapshot(
+        {R"({"microarchitectures": {"brandnew_site": {"from": ["x86_64"], "vendor": "generic",
+                                                      "features": ["brandnewfeat"]}}})"});
+    ASSERT(snapshot != nullptr);
+    const auto& site = snapshot->get("brandnew_site")->get();
+
+    DetectedCpuInfo info;
+    info.vendor = "GenuineIntel";
+    info.features = {"brandnewfeat"};
+    ASSERT(site.has_feature("brandnewfeat"));
+    ASSERT(compatibility::check_x86_64(info, site));
+    ASSERT(compatibility::check_x86_64(info, info.feature_mask(), site));
+    ASSERT(info.feature_mask(*snapshot).test(*snapshot->feature_id("brandnewfeat")));
+
+    info.features.clear();
+    ASSERT(!compatibility::check_x86_64(info, site));
+    TEST_PASS();
+}
+
+TEST(snapshot_rejects_bad_overlay) {
+    ASSERT(MicroarchitectureDatabase::make_snapshot({"{not json"}) == nullptr);
+    const char* truncated = R"({"microarchitectures": )";
+    ASSERT(MicroarchitectureDatabase::make_snapshot({kSiteOverlay, truncated}) == nullptr);
+    TEST_PASS();
+}
+
+TEST(atomic_snapshot_swap) {
+    DatabaseSnapshot first = MicroarchitectureDatabase::make_snapshot();
+    DatabaseSnapshot second = MicroarchitectureDatabase::make_snapshot({kSiteOverlay});
+    AtomicSnapshot current(first);
+    ASSERT(current.load() == first);
+
+    DatabaseSnapshot held = current.load();
+    current.store(second);
+    ASSERT(current.load() == second);
+    ASSERT_EQ(current.reclaim(), 0u);
+    ASSERT(held == first); // Readers keep what they loaded
+    ASSERT(held->get("zen4").has_value());
+    TEST_PASS();
+}
+
+TEST(atomic_snapshot_concurrent_readers) {
+    DatabaseSnapshot snapshots[] = {
+        MicroarchitectureDatabase::make_snapshot(),
+        MicroarchitectureDatabase::make_snapshot({kSiteOverlay}),
+    };
+    AtomicSnapshot current(snapshots[0]);
+    std::atomic<bool> done{false};
+    std::atomic<int> failures{0};
+
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t) {
+        readers.emplace_back([&] {
+            while (!done.load()) {
+                DatabaseSnapshot db = current.load();
+                auto zen4 = db->get("zen4");
+                bool site = db->get("zen4_site").has_value();
+                // Each snapshot must be seen whole: the overlay adds both changes together
+                if (!zen4 || zen4->get().has_feature("sitefeature") != site)
+                    failures.fetch_add(1);
+            }
+        });
+    }
+    for (int i = 0; i < 2000; ++i)
+        current.store(snapshots[i % 2]);
+    done.store(true);
+    for (auto& reader : readers)
+        reader.join();
+
+    ASSERT_EQ(failures.load(), 0);
+    ASSERT_EQ(current.reclaim(), 0u);
+    TEST_PASS();
+}
+
+int main() {
+    std::cout << "=== archspec_cpp Snapshot Tests ===" << std::endl;
+    std::cout << std::endl;
+
+    RUN_TEST(snapshot_is_independent_of_instance);
+    RUN_TEST(snapshot_targets_resolve_against_snapshot);
+    RUN_TEST(snapshot_outlived_by_copies);
+    RUN_TEST(snapshot_compatibility_checks);
+    RUN_TEST(snapshot_rejects_bad_overlay);
+    RUN_TEST(atomic_snapshot_swap);
+    RUN_TEST(atomic_snapshot_concurrent_readers);
+
+    std::cout << std::endl;
+    std::cout << "=== Results ===" << std::endl;
+    std::cout << "Passed: " << g_tests_passed << std::endl;
+    std::cout << "Failed: " << g_tests_failed << std::endl;
+
+    return g_tests_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,67 @@
+// This file is a part of Julia. License is MIT: https://julialang.org/license
+//
+// Unit tests for the ARCHSPEC_TRACE instrumentation counters
+
+#include "test_common.hpp"
+#include <archspec/archspec.hpp>
+
+using namespace archspec;
+
+// Test that instrumented calls are counted (or that nothing is counted when disabled)
+TEST(counts_calls) {
+    // Loading the database is counted once, by whichever call comes first
+    MicroarchitectureDatabase::instance();
+    reset_stats();
+
+    Microarchitecture target = host();
+    target.optimization_flags("gcc", "13.2.0");
+    target.optimization_flags("clang", "17.0.0");
+
+    Stats s = stats();
+    std::cout << "(" << (s.enabled ? "enabled" : "disabled") << ") ";
+    if (!s.enabled) {
+        ASSERT_EQ(s.host.calls, uint64_t(0));
+        ASSERT_EQ(s.detect_cpu_info.calls, uint64_t(0));
+        ASSERT_EQ(s.optimization_flags.calls, uint64_t(0));
+        TEST_PASS();
+    }
+
+    ASSERT_EQ(s.host.calls, uint64_t(1));
+    ASSERT_EQ(s.detect_cpu_info.calls, uint64_t(1));
+    ASSERT_EQ(s.compatible_microarchitectures.calls, uint64_t(1));
+    ASSERT_EQ(s.optimization_flags.calls, uint64_t(2));
+    ASSERT_EQ(s.load_embedded_data.calls, uint64_t(0));
+
+    // host() includes detection, so it can only take longer
+    ASSERT(s.host.total_ns >= s.detect_cpu_info.total_ns);
+    ASSERT(s.optimization_flags.max_ns <= s.optimization_flags.total_ns);
+    TEST_PASS();
+}
+
+// Test that reset_stats() clears every counter
+TEST(reset) {
+    host();
+    reset_stats();
+
+    Stats s = stats();
+    ASSERT_EQ(s.host.calls, uint64_t(0));
+    ASSERT_EQ(s.host.total_ns, uint64_t(0));
+    ASSERT_EQ(s.host.max_ns, uint64_t(0));
+    ASSERT_EQ(s.detect_cpu_info.calls, uint64_t(0));
+    TEST_PASS();
+}
+
+int main() {
+    std::cout << "=== archspec_cpp Stats Tests ===" << std::endl;
+    std::cout << std::endl;
+
+    RUN_TEST(counts_calls);
+    RUN_TEST(reset);
+
+    std::cout << std::endl;
+    std::cout << "=== Results ===" << std::endl;
+    std::cout << "Passed: " << g_tests_passed << std::endl;
+    std::cout << "Failed: " << g_tests_failed << std::endl;
+
+    return g_tests_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,182 @@
+// This file is a part of Julia. License is MIT: https://julialang.org/license
+//
+// Unit tests for topology and cache detection
+
+#include "test_common.hpp"
+#include <archspec/archspec.hpp>
+#include <archspec/topology.hpp>
+#include <filesystem>
+#include <fstream>
+
+using namespace archspec;
+
+namespace fs = std::filesystem;
+
+TEST(cpu_lists) {
+    ASSERT(parse_cpu_list("") == std::vector<int>{});
+    ASSERT(parse_cpu_list("0\n") == std::vector<int>{0});
+    ASSERT((parse_cpu_list("0-3,8,10-11") == std::vector<int>{0, 1, 2, 3, 8, 10, 11}));
+    ASSERT((parse_cpu_list("6,2-3,3") == std::vector<int>{2, 3, 6}));
+    ASSERT((parse_cpu_list("x,4-2,5") == std::vector<int>{5}));
+    TEST_PASS();
+}
+
+#if defined(__linux__)
+static void write_file(const fs::path& path, const std::string& content) {
+    fs::create_directories(path.parent_path());
+    std::ofstream(path) << content << "\n";
+}
+
+static void write_cache(const fs::path& cpu, int index, int level, const char* type,
+                        const char* size, const char* shared) {
+    fs::path dir = cpu / "cache" / ("index" + std::to_string(index));
+    write_file(dir / "level", std::to_string(level));
+    write_file(dir / "type", type);
+    write_file(dir / "size", size);
+    write_file(dir / "coherency_line_size", "64");
+    write_file(dir / "ways_of_associativity", level == 3 ? "16" : "8");
+    write_file(dir / "number_of_sets", "64");
+    write_file(dir / "shared_cpu_list", shared);
+}
+
+// Two SMT cores on node 0 and a core without SMT on node 1, with CPU 5 offline
+static fs::path make_sysfs_tree() {
+    fs::path root = "build/test_sysfs";
+    fs::remove_all(root);
+    fs::path cpus = root / "devices/system/cpu";
+    write_file(cpus / "online", "0-4");
+    const char* siblings[] = {"0,2", "1,3", "0,2", "1,3", "4", "5"};
+    for (int cpu = 0; cpu <= 5; ++cpu) {
+        fs::path dir = cpus / ("cpu" + std::to_string(cpu));
+        write_file(dir / "topology/physical_package_id", cpu == 4 ? "1" : "0");
+        write_file(dir / "topology/thread_siblings_list", siblings[cpu]);
+        bool big = cpu != 4;
+        write_cache(dir, 0, 1, "Data", big ? "48K" : "32K", siblings[cpu]);
+        write_cache(dir, 1, 1, "Instruction", "32K", siblings[cpu]);
+        write_cache(dir, 2, 2, "Unified", big ? "2048K" : "1024K", siblings[cpu]);
+        write_cache(dir, 3, 3, "Unified", "32M", cpu == 4 ? "4" : "0-3");
+    }
+    fs::path nodes = root / "devices/system/node";
+    write_file(nodes / "online", "0-1");
+    write_file(nodes / "node0/cpulist", "0-3");
+    write_file(nodes / "node1/cpulist", "4");
+    return root;
+}
+
+TEST(sysfs_topology) {
+    fs::path root = make_sysfs_tree();
+    CpuTopology topo = detect_topology_from_sysfs(root.string());
+
+    ASSERT_EQ(topo.logical_cpus, 5u);
+    ASSERT_EQ(topo.physical_cores, 3u);
+    ASSERT_EQ(topo.packages, 2u);
+    ASSERT_EQ(topo.threads_per_core, 2u);
+    ASSERT((topo.cores == std::vector<std::vector<int>>{{0, 2}, {1, 3}, {4}}));
+    ASSERT((topo.numa_nodes == std::vector<std::vector<int>>{{0, 1, 2, 3}, {4}}));
+
+    // The core without SMT has caches that serve fewer CPUs, so every level has two kinds
+    ASSERT_EQ(topo.caches.size(), 8u);
+    const CacheInfo* l1d = topo.cache(1, CacheType::Data);
+    ASSERT(l1d != nullptr);
+    ASSERT_EQ(l1d->size, uint64_t(48) << 10);
+    ASSERT_EQ(l1d->line_size, 64u);
+    ASSERT_EQ(l1d->ways, 8u);
+    ASSERT_EQ(l1d->sets, 64u);
+    ASSERT_EQ(l1d->sharing, 2u);
+    ASSERT_EQ(l1d->instances, 2u);
+    ASSERT_EQ(topo.caches[1].size, uint64_t(32) << 10);
+    ASSERT_EQ(topo.caches[1].sharing, 1u);
+
+    const CacheInfo* l1i = topo.cache(1, CacheType::Instruction);
+    ASSERT(l1i != nullptr);
+    ASSERT_EQ(l1i->sharing, 2u);
+    ASSERT_EQ(l1i->instances, 2u);
+    ASSERT(topo.cache(1, CacheType::Unified) == nullptr);
+
+    ASSERT_EQ(topo.data_cache_size(2), uint64_t(2048) << 10);
+    const CacheInfo* l3 = topo.cache(3);
+    ASSERT(l3 != nullptr);
+    ASSERT_EQ(l3->size, uint64_t(32) << 20);
+    ASSERT_EQ(l3->sharing, 4u);
+    ASSERT_EQ(l3->instances, 1u);
+    ASSERT_EQ(topo.caches[7].sharing, 1u); // Package 1's L3
+    ASSERT_EQ(topo.data_cache_size(4), 0u);
+    TEST_PASS();
+}
+
+TEST(sysfs_without_optional_files) {
+    fs::path root = "build/test_sysfs";
+    fs::remove_all(root);
+    write_file(root / "devices/system/cpu/online", "0-1");
+    CpuTopology topo = detect_topology_from_sysfs(root.string());
+    ASSERT_EQ(topo.logical_cpus, 2u);
+    ASSERT_EQ(topo.physical_cores, 2u);
+    ASSERT_EQ(topo.packages, 1u);
+    ASSERT_EQ(topo.threads_per_core, 1u);
+    ASSERT((topo.numa_nodes == std::vector<std::vector<int>>{{0, 1}}));
+    ASSERT(topo.caches.empty());
+
+    fs::remove_all(root);
+    ASSERT_EQ(detect_topology_from_sysfs(root.string()).logical_cpus, 0u);
+    TEST_PASS();
+}
+#endif
+
+TEST(host_topology) {
+    const CpuTopology& topo = topology_cached();
+    ASSERT(&topo == &topology_cached());
+    ASSERT(topo.logical_cpus > 0);
+    ASSERT(topo.physical_cores > 0);
+    ASSERT(topo.packages > 0);
+    ASSERT(topo.threads_per_core > 0);
+    ASSERT(topo.physical_cores * topo.threads_per_core >= topo.logical_cpus);
+    ASSERT(topo.physical_cores <= topo.logical_cpus);
+    for (size_t i = 0; i < topo.caches.size(); ++i) {
+        ASSERT(topo.caches[i].level > 0);
+        ASSERT(topo.caches[i].size > 0);
+        if (i > 0)
+            ASSERT(topo.caches[i - 1].level <= topo.caches[i].level);
+    }
+    std::cout << "(" << topo.logical_cpus << " CPUs, " << topo.physical_cores << " cores, L2 "
+              << (topo.data_cache_size(2) >> 10) << "K) ";
+
+    refresh_topology();
+    ASSERT(&topo != &topology_cached());
+    ASSERT_EQ(topology_cached().logical_cpus, topo.logical_cpus);
+    TEST_PASS();
+}
+
+TEST(cpuid_topology) {
+    CpuTopology topo = detect_topology_from_cpuid();
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    ASSERT(topo.logical_cpus > 0);
+    ASSERT(topo.threads_per_core > 0);
+    if (const CacheInfo* l1d = topo.cache(1, CacheType::Data)) {
+        ASSERT(l1d->line_size >= 32);
+        ASSERT(l1d->size >= uint64_t(l1d->ways) * l1d->sets * l1d->line_size); // x partitions
+    }
+#else
+    ASSERT_EQ(topo.logical_cpus, 0u);
+#endif
+    TEST_PASS();
+}
+
+int main() {
+    std::cout << "=== archspec_cpp Topology Tests ===" << std::endl;
+    std::cout << std::endl;
+
+    RUN_TEST(cpu_lists);
+#if defined(__linux__)
+    RUN_TEST(sysfs_topology);
+    RUN_TEST(sysfs_without_optional_files);
+#endif
+    RUN_TEST(host_topology);
+    RUN_TEST(cpuid_topology);
+
+    std::cout << std::endl;
+    std::cout << "=== Results ===" << std::endl;
+    std::cout << "Passed: " << g_tests_passed << std::endl;
+    std::cout << "Failed: " << g_tests_failed << std::endl;
+
+    return g_tests_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,236 @@
+// This file is a part of Julia. License is MIT: https://julialang.org/license
+//
+// Tool: Generate constexpr microarchitecture tables from microarchitectures.json
+//
+// The output is consumed by src/microarchitecture.cpp when the library is built with
+// ARCHSPEC_STATIC_DATA=1, so the database can be populated without parsing JSON at startup.
+//
+// Usage: generate_tables <microarchitectures.json> <output.inc> [feature_ids.inc]
+//
+// The optional third output lists every target feature, sorted, as ARCHSPEC_FEATURE(id, name)
+// entries. The database interns features in that order first, so include/archspec/dispatch.hpp
+// can expose their ids as constants.
+
+#include <nlohmann/json.hpp>
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Range {
+    size_t begin = 0;
+    size_t count = 0;
+};
+
+// Flat tables that the generated records index into
+struct Tables {
+    std::vector<std::string> names;
+    std::vector<std::string> compilers;
+    std::vector<std::string> targets;
+    std::vector<std::string> aliases;
+    std::vector<std::string> darwin_flags;
+    std::vector<std::string> arm_vendors;
+};
+
+std::string quote(const std::string& s) {
+    std::string result = "\"";
+    for (char c : s) {
+        switch (c) {
+        case '"':
+            result += "\\\"";
+            break;
+        case '\\':
+            result += "\\\\";
+            break;
+        case '\n':
+            result += "\\n";
+            break;
+        case '\t':
+            result += "\\t";
+            break;
+        default:
+            result += c;
+        }
+    }
+    result += "\"";
+    return result;
+}
+
+std::string range(const Range& r) {
+    return "{" + std::to_string(r.begin) + ", " + std::to_string(r.count) + "}";
+}
+
+Range add_names(Tables& tables, const nlohmann::json& data, const char* key) {
+    Range r;
+    r.begin = tables.names.size();
+    if (data.contains(key)) {
+        for (const auto& item : data[key]) {
+            tables.names.push_back(quote(item.get<std::string>()));
+            r.count++;
+        }
+    }
+    return r;
+}
+
+void add_target(Tables& tables, const std::string& name, const nlohmann::json& data) {
+    Range parents = add_names(tables, data, "from");
+    Range features = add_names(tables, data, "features");
+
+    Range compilers;
+    compilers.begin = tables.compilers.size();
+    if (data.contains("compilers")) {
+        for (auto it = data["compilers"].begin(); it != data["compilers"].end(); ++it) {
+            for (const auto& entry : it.value()) {
+                tables.compilers.push_back(
+                    "{" + quote(it.key()) + ", " + quote(entry.value("versions", ":")) + ", " +
+                    quote(entry.value("name", "")) + ", " + quote(entry.value("flags", "")) +
+                    ", " + quote(entry.value("warnings", "")) + "}");
+                compilers.count++;
+            }
+        }
+    }
+
+    tables.targets.push_back("{" + quote(name) + ", " + quote(data.value("vendor", "generic")) +
+                             ", " + std::to_string(data.value("generation", 0)) + ", " +
+                             quote(data.value("cpupart", "")) + ", " + range(parents) + ", " +
+                             range(features) + ", " + range(compilers) + "}");
+}
+
+void add_alias(Tables& tables, const std::string& name, const nlohmann::json& data) {
+    Range any_of = add_names(tables, data, "any_of");
+    Range families = add_names(tables, data, "families");
+    tables.aliases.push_back("{" + quote(name) + ", " + range(any_of) + ", " + range(families) +
+                             "}");
+}
+
+void add_pairs(std::vector<std::string>& out, const nlohmann::json& data) {
+    for (auto it = data.begin(); it != data.end(); ++it)
+        out.push_back("{" + quote(it.key()) + ", " + quote(it.value().get<std::string>()) + "}");
+}
+
+// Emit one table plus its element count. Empty tables get a single zero-initialized
+// placeholder so the array stays well-formed; loaders iterate up to the count.
+void emit_table(std::ostream& out, const char* type, const char* name,
+                const std::vector<std::string>& rows) {
+    out << "constexpr size_t " << name << "Count = " << rows.size() << ";\n";
+    out << "constexpr " << type << " " << name << "[] = {\n";
+    for (const auto& row : rows)
+        out << "    " << row << ",\n";
+    if (rows.empty())
+        out << "    {},\n";
+    out << "};\n\n";
+}
+
+// C++ identifier for a feature name; names starting with a digit ("3dnow") get a leading '_'
+std::string feature_identifier(const std::string& name) {
+    std::string id = std::isdigit(static_cast<unsigned char>(name[0])) ? "_" + name : name;
+    for (char& c : id) {
+        if (!std::isalnum(static_cast<unsigned char>(c)))
+            c = '_';
+    }
+    return id;
+}
+
+bool write_feature_ids(const char* json_path, const char* path, const nlohmann::json& j) {
+    std::set<std::string> features;
+    if (j.contains("microarchitectures")) {
+        for (const auto& [name, data] : j["microarchitectures"].items()) {
+            if (data.contains("features")) {
+                for (const auto& f : data["features"])
+                    features.insert(f.get<std::string>());
+            }
+        }
+    }
+
+    std::ofstream out(path);
+    if (!out.is_open())
+        return false;
+    out << "// Auto-generated feature ids - DO NOT EDIT\n";
+    out << "// Generated from " << json_path << "\n";
+    out << "//\n";
+    out << "// To regenerate: make regenerate-data\n";
+    out << "//\n";
+    out << "// One ARCHSPEC_FEATURE(identifier, name) per target feature; the position of an\n";
+    out << "// entry is its FeatureId. No include guard: define ARCHSPEC_FEATURE before each\n";
+    out << "// inclusion.\n\n";
+    for (const auto& f : features)
+        out << "ARCHSPEC_FEATURE(" << feature_identifier(f) << ", " << quote(f) << ")\n";
+    return static_cast<bool>(out);
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    if (argc != 3 && argc != 4) {
+        std::cerr << "Usage: " << argv[0]
+                  << " <microarchitectures.json> <output.inc> [feature_ids.inc]" << std::endl;
+        return 1;
+    }
+
+    std::ifstream in(argv[1]);
+    if (!in.is_open()) {
+        std::cerr << "Cannot open " << argv[1] << std::endl;
+        return 1;
+    }
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+
+    nlohmann::json j = nlohmann::json::parse(buffer.str(), nullptr, false);
+    if (j.is_discarded()) {
+        std::cerr << "Invalid JSON in " << argv[1] << std::endl;
+        return 1;
+    }
+
+    Tables tables;
+    if (j.contains("microarchitectures")) {
+        for (auto it = j["microarchitectures"].begin(); it != j["microarchitectures"].end(); ++it)
+            add_target(tables, it.key(), it.value());
+    }
+    if (j.contains("feature_aliases")) {
+        for (auto it = j["feature_aliases"].begin(); it != j["feature_aliases"].end(); ++it)
+            add_alias(tables, it.key(), it.value());
+    }
+    if (j.contains("conversions")) {
+        const auto& conv = j["conversions"];
+        if (conv.contains("darwin_flags"))
+            add_pairs(tables.darwin_flags, conv["darwin_flags"]);
+        if (conv.contains("arm_vendors"))
+            add_pairs(tables.arm_vendors, conv["arm_vendors"]);
+    }
+
+    std::ofstream out(argv[2]);
+    if (!out.is_open()) {
+        std::cerr << "Cannot write " << argv[2] << std::endl;
+        return 1;
+    }
+
+    out << "// Auto-generated microarchitecture tables - DO NOT EDIT\n";
+    out << "// Generated from " << argv[1] << "\n";
+    out << "//\n";
+    out << "// To regenerate: make regenerate-data\n\n";
+    out << "#ifndef ARCHSPEC_MICROARCHITECTURES_TABLES_INC\n";
+    out << "#define ARCHSPEC_MICROARCHITECTURES_TABLES_INC\n\n";
+    out << "namespace archspec {\n";
+    out << "namespace tables {\n\n";
+    emit_table(out, "std::string_view", "kNames", tables.names);
+    emit_table(out, "CompilerRecord", "kCompilers", tables.compilers);
+    emit_table(out, "TargetRecord", "kTargets", tables.targets);
+    emit_table(out, "FeatureAliasRecord", "kFeatureAliases", tables.aliases);
+    emit_table(out, "StringPairRecord", "kDarwinFlags", tables.darwin_flags);
+    emit_table(out, "StringPairRecord", "kArmVendors", tables.arm_vendors);
+    out << "} // namespace tables\n";
+    out << "} // namespace archspec\n\n";
+    out << "#endif // ARCHSPEC_MICROARCHITECTURES_TABLES_INC\n";
+
+    if (argc == 4 && !write_feature_ids(argv[1], argv[3], j)) {
+        std::cerr << "Cannot write " << argv[3] << std::endl;
+        return 1;
+    }
+
+    return 0;
+}